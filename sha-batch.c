@@ -0,0 +1,247 @@
+/* sha-batch.c - Hash arrays of independent messages */
+/*   Written and placed in public domain           */
+
+/* A job manager refills a lane as soon as its message finishes, */
+/* but the order of the messages still matters. A long message   */
+/* submitted last runs alone in the final kernel calls while the */
+/* other lanes sit idle. Submitting the longest messages first   */
+/* leaves the short ones for the end, where they fill the lanes  */
+/* around the last long messages. Neighbours in the sorted order */
+/* also have similar lengths, which keeps both streams of the    */
+/* SHA-NI x2 kernel busy.                                        */
+
+/* The manager holds at most one job per lane, so a pool of one job */
+/* more than the lanes is enough: each submit returns at most one   */
+/* finished job, and it is reused for the next message.             */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* Build the multi-buffer objects as shown in sha1-mb.c and sha256-mb.c */
+/* gcc -DTEST_MAIN sha-batch.c sha1-mb.o sha1-mb-avx2.o sha1-mb-avx512.o \ */
+/*     sha256-mb.o sha256-mb-avx2.o sha256-mb-avx512.o sha-short.o \       */
+/*     sha-short-x86.o sha-ctx.o sha-dispatch.o <ISA objects> \            */
+/*     -o sha-batch.exe                                                    */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha-batch.h"
+#include "sha1-mb.h"
+#include "sha256-mb.h"
+#include "sha-short.h"
+
+#define BATCH_BUCKETS 256
+
+static const uint8_t s_empty[1] = { 0 };
+
+/* Messages are bucketed by the number of padded blocks, which is */
+/*  what the lanes spend time on. Up to 191 blocks each count has */
+/*  its own bucket. Longer messages share a bucket per power of   */
+/*  two; their order within a bucket matters little.              */
+static unsigned int bucket_of(size_t length)
+{
+    const size_t blocks = length / 64 + ((length % 64) < 56 ? 1 : 2);
+    unsigned int bits = 0;
+
+    if (blocks < 192)
+        return (unsigned int)blocks;
+
+    while ((blocks >> bits) > 1)
+        bits++;
+    return (bits - 7 + 192 < BATCH_BUCKETS) ? bits - 7 + 192 : BATCH_BUCKETS - 1;
+}
+
+/* Submission order, longest bucket first and in the caller's order  */
+/*  within a bucket. This is a counting sort, so it costs two passes */
+/*  over the lengths instead of a comparison sort. Returns NULL if   */
+/*  the order cannot be allocated; the caller then submits in its    */
+/*  own order.                                                       */
+static size_t* sort_by_length(const size_t lens[], size_t n)
+{
+    size_t start[BATCH_BUCKETS];
+    size_t* order;
+    size_t i, total = 0;
+    int b;
+
+    if (n > SIZE_MAX / sizeof(size_t))
+        return NULL;
+    if ((order = (size_t*)malloc(n * sizeof(size_t))) == NULL)
+        return NULL;
+
+    memset(start, 0x00, sizeof(start));
+    for (i = 0; i < n; ++i)
+        start[bucket_of(lens[i])]++;
+
+    for (b = BATCH_BUCKETS - 1; b >= 0; --b)
+    {
+        const size_t count = start[b];
+        start[b] = total;
+        total += count;
+    }
+
+    for (i = 0; i < n; ++i)
+        order[start[bucket_of(lens[i])]++] = i;
+
+    return order;
+}
+
+void sha1_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[20], size_t n)
+{
+    sha1_mb_job jobs[SHA1_MB_MAX_LANES + 1];
+    sha1_mb_job* pool[SHA1_MB_MAX_LANES + 1];
+    sha1_mb_job* done;
+    sha1_mb_mgr mgr;
+    size_t i, free_jobs = 0;
+
+    if (n == 1)
+    {
+        sha1_short(out[0], msgs[0] ? msgs[0] : s_empty, lens[0]);
+        return;
+    }
+    if (n == 0 || sha1_mb_init(&mgr, SHA1_MB_AUTO) != 0)
+        return;
+
+    for (i = 0; i <= SHA1_MB_MAX_LANES; ++i)
+        pool[free_jobs++] = &jobs[i];
+
+    size_t* order = sort_by_length(lens, n);
+    for (i = 0; i < n; ++i)
+    {
+        const size_t k = order ? order[i] : i;
+        sha1_mb_job* job = pool[--free_jobs];
+        job->data = msgs[k] ? msgs[k] : s_empty;
+        job->length = lens[k];
+        job->user = out[k];
+
+        if ((done = sha1_mb_submit(&mgr, job)) != NULL)
+        {
+            memcpy(done->user, done->digest, 20);
+            pool[free_jobs++] = done;
+        }
+    }
+    while ((done = sha1_mb_flush(&mgr)) != NULL)
+        memcpy(done->user, done->digest, 20);
+
+    free(order);
+}
+
+void sha256_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[32], size_t n)
+{
+    sha256_mb_job jobs[SHA256_MB_MAX_LANES + 1];
+    sha256_mb_job* pool[SHA256_MB_MAX_LANES + 1];
+    sha256_mb_job* done;
+    sha256_mb_mgr mgr;
+    size_t i, free_jobs = 0;
+
+    if (n == 1)
+    {
+        sha256_short(out[0], msgs[0] ? msgs[0] : s_empty, lens[0]);
+        return;
+    }
+    if (n == 0 || sha256_mb_init(&mgr, SHA256_MB_AUTO) != 0)
+        return;
+
+    for (i = 0; i <= SHA256_MB_MAX_LANES; ++i)
+        pool[free_jobs++] = &jobs[i];
+
+    size_t* order = sort_by_length(lens, n);
+    for (i = 0; i < n; ++i)
+    {
+        const size_t k = order ? order[i] : i;
+        sha256_mb_job* job = pool[--free_jobs];
+        job->data = msgs[k] ? msgs[k] : s_empty;
+        job->length = lens[k];
+        job->prefix = -1;
+        job->user = out[k];
+
+        if ((done = sha256_mb_submit(&mgr, job)) != NULL)
+        {
+            memcpy(done->user, done->digest, 32);
+            pool[free_jobs++] = done;
+        }
+    }
+    while ((done = sha256_mb_flush(&mgr)) != NULL)
+        memcpy(done->user, done->digest, 32);
+
+    free(order);
+}
+
+void sha512_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[64], size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; ++i)
+        sha512_short(out[i], msgs[i] ? msgs[i] : s_empty, lens[i]);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include "sha-ctx.h"
+
+int main(int argc, char* argv[])
+{
+    enum { COUNT = 300, BIG = 5000 };
+    static uint8_t buffer[BIG + COUNT];
+    static const uint8_t* msgs[COUNT];
+    static size_t lens[COUNT];
+    static uint8_t out1[COUNT][20], out256[COUNT][32], out512[COUNT][64];
+    uint8_t expected[64];
+    size_t i, n;
+    int success = 1;
+
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(i * 41 + 7);
+
+    /* Skewed lengths: mostly short, a few long, some empty */
+    for (i = 0; i < COUNT; ++i)
+    {
+        msgs[i] = buffer + i;
+        lens[i] = (i % 37 == 0) ? BIG - (i % 5) * 700 : (i * 13) % 150;
+    }
+    msgs[5] = NULL;
+    lens[5] = 0;
+
+    for (n = 0; n <= COUNT; n += (n < 20 ? 1 : 140))
+    {
+        memset(out1, 0x00, sizeof(out1));
+        memset(out256, 0x00, sizeof(out256));
+        memset(out512, 0x00, sizeof(out512));
+        sha1_batch(msgs, lens, out1, n);
+        sha256_batch(msgs, lens, out256, n);
+        sha512_batch(msgs, lens, out512, n);
+
+        for (i = 0; i < n; ++i)
+        {
+            sha1_ctx c1;
+            sha1_init(&c1);
+            sha1_update(&c1, msgs[i] ? msgs[i] : buffer, lens[i]);
+            sha1_final(&c1, expected);
+            success &= (memcmp(out1[i], expected, 20) == 0);
+
+            sha256_ctx c256;
+            sha256_init(&c256);
+            sha256_update(&c256, msgs[i] ? msgs[i] : buffer, lens[i]);
+            sha256_final(&c256, expected);
+            success &= (memcmp(out256[i], expected, 32) == 0);
+
+            sha512_ctx c512;
+            sha512_init(&c512);
+            sha512_update(&c512, msgs[i] ? msgs[i] : buffer, lens[i]);
+            sha512_final(&c512, expected);
+            success &= (memcmp(out512[i], expected, 64) == 0);
+        }
+        /* Digests past n are untouched */
+        static const uint8_t zero[64];
+        if (n < COUNT)
+            success &= (memcmp(out256[n], zero, 32) == 0 && memcmp(out1[n], zero, 20) == 0);
+    }
+    printf("Batches of mixed lengths: %s\n", success ? "pass" : "fail");
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,32 @@
+/* sha-batch.h - Hash arrays of independent messages */
+/*   Written and placed in public domain           */
+
+/* The batch functions hash n messages of any lengths into n       */
+/* digests. SHA-1 and SHA-256 go through the multi-buffer job      */
+/* managers with SHA1_MB_AUTO and SHA256_MB_AUTO. The messages are */
+/* submitted longest first, so lanes that finish early are refilled */
+/* with shorter messages and the lanes drain together at the end.  */
+/* SHA-512 has no multi-buffer kernel and hashes one message at a  */
+/* time.                                                           */
+
+#ifndef SHA_BATCH_H
+#define SHA_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* msgs[i] and lens[i] describe message i, and out[i] receives its */
+/*  digest. A message of length 0 may have a NULL pointer.         */
+void sha1_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[20], size_t n);
+void sha256_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[32], size_t n);
+void sha512_batch(const uint8_t* const msgs[], const size_t lens[], uint8_t (*out)[64], size_t n);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_BATCH_H */
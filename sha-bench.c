@@ -0,0 +1,533 @@
+/* sha-bench.c - Cycles per byte for every compress function on the host */
+/*   Written and placed in public domain                                 */
+
+/* Each kernel available on the host is timed over a range of message  */
+/* sizes. A kernel is warmed up first, then each size is sampled       */
+/* several times and the median is reported. The x86 build counts     */
+/* cycles with rdtsc, which ticks at the reference clock, not the core */
+/* clock. Other platforms derive cycles from --ghz.                    */
+
+/* Multi-lane kernels hash the same buffer in every lane and count the */
+/* bytes of all lanes, so large sizes measure the rounds rather than   */
+/* memory bandwidth. The per-block latency is the time for one block   */
+/* in one lane.                                                        */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -c -mavx2 sha1-mb-avx2.c sha256-mb-avx2.c                       */
+/* gcc -c -mavx512f -mavx512bw sha1-mb-avx512.c sha256-mb-avx512.c     */
+/* gcc -O2 sha-bench.c sha-dispatch.o sha1-mb-avx2.o sha256-mb-avx2.o \ */
+/*     sha1-mb-avx512.o sha256-mb-avx512.o <ISA objects> -lm \         */
+/*     -o sha-bench.exe                                                */
+
+/* ./sha-bench.exe --max 16M --reps 7 --json > bench.json */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "sha-dispatch.h"
+
+#if defined(SHA_DISPATCH_X86)
+# include "sha1-mb.h"
+# include "sha256-mb.h"
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+#endif
+
+#if defined(_WIN32)
+# include <windows.h>
+#else
+# include <time.h>
+#endif
+
+#if defined(__linux__)
+# include <sched.h>
+#endif
+
+/* Hash length bytes of data in every lane. Length is a multiple */
+/*  of the kernel's block size.                                  */
+typedef void (*bench_fn)(const uint8_t* data, size_t length);
+
+typedef struct bench_kernel
+{
+    const char* name;
+    unsigned int features;   /* required SHA_CPU_* bits */
+    unsigned int lanes;
+    size_t block;
+    bench_fn run;
+} bench_kernel;
+
+/* Kernels run in place on these states. The values never matter. */
+static uint32_t s_state1[2][5];
+static uint32_t s_state256[2][8];
+static uint64_t s_state512[8];
+
+static void run_sha1(const uint8_t* data, size_t length)
+{
+    sha1_process(s_state1[0], data, (uint32_t)length);
+}
+
+static void run_sha256(const uint8_t* data, size_t length)
+{
+    sha256_process(s_state256[0], data, (uint32_t)length);
+}
+
+static void run_sha512(const uint8_t* data, size_t length)
+{
+    sha512_process(s_state512, data, length);
+}
+
+#if defined(SHA_DISPATCH_X86)
+static void run_sha1_x86(const uint8_t* data, size_t length)
+{
+    sha1_process_x86(s_state1[0], data, (uint32_t)length);
+}
+
+static void run_sha256_x86(const uint8_t* data, size_t length)
+{
+    sha256_process_x86(s_state256[0], data, (uint32_t)length);
+}
+
+static void run_sha1_x86_x2(const uint8_t* data, size_t length)
+{
+    sha1_process_x86_x2(s_state1[0], s_state1[1], data, data, (uint32_t)length);
+}
+
+static void run_sha256_x86_x2(const uint8_t* data, size_t length)
+{
+    sha256_process_x86_x2(s_state256[0], s_state256[1], data, data, (uint32_t)length);
+}
+
+static void run_sha512_avx2(const uint8_t* data, size_t length)
+{
+    sha512_process_avx2(s_state512, data, length);
+}
+
+static void run_sha256_bmi2(const uint8_t* data, size_t length)
+{
+    sha256_process_bmi2(s_state256[0], data, (uint32_t)length);
+}
+
+static sha1_mb_args s_args1;
+static sha256_mb_args s_args256;
+
+static void run_sha1_mb(sha1_mb_fn kernel, unsigned int lanes, const uint8_t* data, size_t length)
+{
+    unsigned int i;
+    for (i = 0; i < lanes; ++i)
+        s_args1.data[i] = data;
+    kernel(&s_args1, (uint32_t)((1ULL << lanes) - 1), length / 64);
+}
+
+static void run_sha256_mb(sha256_mb_fn kernel, unsigned int lanes, const uint8_t* data, size_t length)
+{
+    unsigned int i;
+    for (i = 0; i < lanes; ++i)
+        s_args256.data[i] = data;
+    kernel(&s_args256, (uint32_t)((1ULL << lanes) - 1), length / 64);
+}
+
+static void run_sha1_mb_avx2(const uint8_t* data, size_t length)
+{
+    run_sha1_mb(sha1_mb_avx2, 8, data, length);
+}
+
+static void run_sha1_mb_avx512(const uint8_t* data, size_t length)
+{
+    run_sha1_mb(sha1_mb_avx512, 16, data, length);
+}
+
+static void run_sha256_mb_avx2(const uint8_t* data, size_t length)
+{
+    run_sha256_mb(sha256_mb_avx2, 8, data, length);
+}
+
+static void run_sha256_mb_avx512(const uint8_t* data, size_t length)
+{
+    run_sha256_mb(sha256_mb_avx512, 16, data, length);
+}
+#endif
+
+#if defined(SHA_DISPATCH_ARM)
+static void run_sha1_arm(const uint8_t* data, size_t length)
+{
+    sha1_process_arm(s_state1[0], data, (uint32_t)length);
+}
+
+static void run_sha256_arm(const uint8_t* data, size_t length)
+{
+    sha256_process_arm(s_state256[0], data, (uint32_t)length);
+}
+#endif
+
+#if defined(SHA_DISPATCH_P8)
+static void run_sha256_p8(const uint8_t* data, size_t length)
+{
+    sha256_process_p8(s_state256[0], data, (uint32_t)length);
+}
+
+static void run_sha512_p8(const uint8_t* data, size_t length)
+{
+    sha512_process_p8(s_state512, data, length);
+}
+#endif
+
+static const bench_kernel KERNELS[] =
+{
+    {"sha1_process", 0, 1, 64, run_sha1},
+    {"sha256_process", 0, 1, 64, run_sha256},
+    {"sha512_process", 0, 1, 128, run_sha512},
+#if defined(SHA_DISPATCH_X86)
+    {"sha1_process_x86", SHA_CPU_X86_SHA, 1, 64, run_sha1_x86},
+    {"sha1_process_x86_x2", SHA_CPU_X86_SHA, 2, 64, run_sha1_x86_x2},
+    {"sha256_process_x86", SHA_CPU_X86_SHA, 1, 64, run_sha256_x86},
+    {"sha256_process_x86_x2", SHA_CPU_X86_SHA, 2, 64, run_sha256_x86_x2},
+    {"sha256_process_bmi2", SHA_CPU_X86_BMI2, 1, 64, run_sha256_bmi2},
+    {"sha512_process_avx2", SHA_CPU_X86_AVX2 | SHA_CPU_X86_BMI2, 1, 128, run_sha512_avx2},
+    {"sha1_mb_avx2", SHA_CPU_X86_AVX2, 8, 64, run_sha1_mb_avx2},
+    {"sha1_mb_avx512", SHA_CPU_X86_AVX512, 16, 64, run_sha1_mb_avx512},
+    {"sha256_mb_avx2", SHA_CPU_X86_AVX2, 8, 64, run_sha256_mb_avx2},
+    {"sha256_mb_avx512", SHA_CPU_X86_AVX512, 16, 64, run_sha256_mb_avx512},
+#endif
+#if defined(SHA_DISPATCH_ARM)
+    {"sha1_process_arm", SHA_CPU_ARM_SHA1, 1, 64, run_sha1_arm},
+    {"sha256_process_arm", SHA_CPU_ARM_SHA2, 1, 64, run_sha256_arm},
+#endif
+#if defined(SHA_DISPATCH_P8)
+    {"sha256_process_p8", SHA_CPU_P8_CRYPTO, 1, 64, run_sha256_p8},
+    {"sha512_process_p8", SHA_CPU_P8_CRYPTO, 1, 128, run_sha512_p8},
+#endif
+};
+
+typedef struct bench_options
+{
+    size_t min_size;
+    size_t max_size;
+    unsigned int reps;
+    unsigned int msec;        /* target time of one sample */
+    unsigned int warmup;      /* warmup time per kernel, in ms */
+    int cpu;                  /* -1 to leave the thread unpinned */
+    double ghz;               /* cycle rate when rdtsc is not used */
+    int json;
+    const char* filter;
+} bench_options;
+
+static double now_ns(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+static uint64_t now_cycles(void)
+{
+#if defined(SHA_DISPATCH_X86)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void pin_thread(int cpu)
+{
+    if (cpu < 0)
+        return;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        fprintf(stderr, "sha-bench: could not pin to CPU %d\n", cpu);
+#elif defined(_WIN32)
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0)
+        fprintf(stderr, "sha-bench: could not pin to CPU %d\n", cpu);
+#endif
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Parse a size like 4096, 64K, 16M or 1G */
+static int parse_size(const char* str, size_t* size)
+{
+    char* end;
+    unsigned long long value = strtoull(str, &end, 10);
+    switch (*end)
+    {
+    case 'G': case 'g': value <<= 10; /* fall through */
+    case 'M': case 'm': value <<= 10; /* fall through */
+    case 'K': case 'k': value <<= 10; ++end; break;
+    default: break;
+    }
+    if (end == str || *end != '\0' || value == 0)
+        return -1;
+    *size = (size_t)value;
+    return 0;
+}
+
+static void format_size(char* buf, size_t len, size_t size)
+{
+    if (size >= (1 << 30) && size % (1 << 30) == 0)
+        snprintf(buf, len, "%uG", (unsigned int)(size >> 30));
+    else if (size >= (1 << 20) && size % (1 << 20) == 0)
+        snprintf(buf, len, "%uM", (unsigned int)(size >> 20));
+    else if (size >= (1 << 10) && size % (1 << 10) == 0)
+        snprintf(buf, len, "%uK", (unsigned int)(size >> 10));
+    else
+        snprintf(buf, len, "%u", (unsigned int)size);
+}
+
+typedef struct bench_result
+{
+    double cpb_median;
+    double cpb_min;
+    double mib_per_sec;
+    double ns_per_block;
+    double cycles_per_block;
+    double stddev_pct;        /* of the per-sample time */
+    unsigned long long iterations;
+} bench_result;
+
+static void bench_size(const bench_kernel* k, const bench_options* opt,
+                       const uint8_t* data, size_t size, bench_result* res)
+{
+    double ns[64], cycles[64];
+    const unsigned int reps = opt->reps;
+    unsigned long long i, iters = 1;
+    unsigned int r;
+
+    /* Calibrate the iteration count so one sample lasts opt->msec */
+    for (;;)
+    {
+        const double t0 = now_ns();
+        for (i = 0; i < iters; ++i)
+            k->run(data, size);
+        const double t = now_ns() - t0;
+        if (t >= opt->msec * 1e6 / 4 || iters >= (1ULL << 40))
+        {
+            const double scale = (opt->msec * 1e6) / (t > 1 ? t : 1);
+            iters = (unsigned long long)(iters * scale);
+            if (iters == 0) iters = 1;
+            break;
+        }
+        iters *= 4;
+    }
+
+    for (r = 0; r < reps; ++r)
+    {
+        const double t0 = now_ns();
+        const uint64_t c0 = now_cycles();
+        for (i = 0; i < iters; ++i)
+            k->run(data, size);
+        const uint64_t c1 = now_cycles();
+        const double t1 = now_ns();
+
+        ns[r] = (t1 - t0) / (double)iters;
+        cycles[r] = (c1 != c0) ? (double)(c1 - c0) / (double)iters : ns[r] * opt->ghz;
+    }
+
+    double mean = 0, var = 0;
+    for (r = 0; r < reps; ++r)
+        mean += ns[r];
+    mean /= reps;
+    for (r = 0; r < reps; ++r)
+        var += (ns[r] - mean) * (ns[r] - mean);
+    var /= reps;
+
+    qsort(ns, reps, sizeof(ns[0]), compare_double);
+    qsort(cycles, reps, sizeof(cycles[0]), compare_double);
+
+    const double bytes = (double)size * k->lanes;
+    const double blocks = (double)(size / k->block);
+    const double ns_med = ns[reps / 2];
+    const double cyc_med = cycles[reps / 2];
+
+    res->cpb_median = cyc_med / bytes;
+    res->cpb_min = cycles[0] / bytes;
+    res->mib_per_sec = bytes / ns_med * 1e9 / (1024.0 * 1024.0);
+    res->ns_per_block = ns_med / blocks;
+    res->cycles_per_block = cyc_med / blocks;
+    res->stddev_pct = (mean > 0) ? 100.0 * sqrt(var) / mean : 0;
+    res->iterations = iters;
+}
+
+static void usage(void)
+{
+    printf("Usage: sha-bench [options]\n");
+    printf("  --min SIZE     smallest message size, default 64\n");
+    printf("  --max SIZE     largest message size, default 1G\n");
+    printf("  --reps N       samples per size, default 5, at most 64\n");
+    printf("  --msec N       target time of one sample, default 100\n");
+    printf("  --warmup N     warmup time per kernel in ms, default 200\n");
+    printf("  --cpu N        pin to CPU N, default 0, -1 to not pin\n");
+    printf("  --ghz F        clock rate for cycles when rdtsc is not available\n");
+    printf("  --kernel NAME  only kernels whose name contains NAME\n");
+    printf("  --json         print the results as JSON\n");
+    printf("Sizes take a K, M or G suffix. Sizes step by a factor of 4.\n");
+}
+
+int main(int argc, char* argv[])
+{
+    bench_options opt;
+    int i;
+
+    opt.min_size = 64;
+    opt.max_size = (size_t)1 << 30;
+    opt.reps = 5;
+    opt.msec = 100;
+    opt.warmup = 200;
+    opt.cpu = 0;
+    opt.ghz = 0;
+    opt.json = 0;
+    opt.filter = NULL;
+
+    for (i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int bad = 0;
+
+        if (strcmp(arg, "--json") == 0)
+            opt.json = 1;
+        else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+        {
+            usage();
+            return 0;
+        }
+        else if (val == NULL)
+            bad = 1;
+        else if (strcmp(arg, "--min") == 0)
+            bad = parse_size(val, &opt.min_size), ++i;
+        else if (strcmp(arg, "--max") == 0)
+            bad = parse_size(val, &opt.max_size), ++i;
+        else if (strcmp(arg, "--reps") == 0)
+            opt.reps = (unsigned int)atoi(val), ++i;
+        else if (strcmp(arg, "--msec") == 0)
+            opt.msec = (unsigned int)atoi(val), ++i;
+        else if (strcmp(arg, "--warmup") == 0)
+            opt.warmup = (unsigned int)atoi(val), ++i;
+        else if (strcmp(arg, "--cpu") == 0)
+            opt.cpu = atoi(val), ++i;
+        else if (strcmp(arg, "--ghz") == 0)
+            opt.ghz = atof(val), ++i;
+        else if (strcmp(arg, "--kernel") == 0)
+            opt.filter = val, ++i;
+        else
+            bad = 1;
+
+        if (bad)
+        {
+            fprintf(stderr, "sha-bench: bad option %s\n", arg);
+            usage();
+            return 1;
+        }
+    }
+
+    if (opt.reps == 0 || opt.reps > 64 || opt.msec == 0 || opt.min_size > opt.max_size)
+    {
+        fprintf(stderr, "sha-bench: bad options\n");
+        return 1;
+    }
+
+    /* The kernels take a 32-bit length */
+    if (opt.max_size > 0xFFFFFF80)
+        opt.max_size = 0xFFFFFF80;
+
+    uint8_t* data = (uint8_t*)malloc(opt.max_size);
+    if (data == NULL)
+    {
+        fprintf(stderr, "sha-bench: could not allocate %lu bytes\n", (unsigned long)opt.max_size);
+        return 1;
+    }
+    for (size_t j = 0; j < opt.max_size; ++j)
+        data[j] = (uint8_t)(j * 131 + 7);
+
+    pin_thread(opt.cpu);
+
+    const unsigned int features = sha_cpu_features();
+    const size_t count = sizeof(KERNELS) / sizeof(KERNELS[0]);
+    int first = 1;
+    size_t k;
+
+    if (opt.json)
+        printf("{\n  \"features\": %u,\n  \"cycles\": \"%s\",\n  \"results\": [\n",
+            features, (now_cycles() != 0) ? "rdtsc" : (opt.ghz > 0 ? "ghz" : "none"));
+    else
+        printf("%-24s %6s %5s %9s %9s %10s %10s %7s\n", "kernel", "size", "lanes",
+            "cpb", "cpb min", "MiB/s", "ns/block", "stddev");
+
+    for (k = 0; k < count; ++k)
+    {
+        const bench_kernel* kern = &KERNELS[k];
+        if ((features & kern->features) != kern->features)
+            continue;
+        if (opt.filter && strstr(kern->name, opt.filter) == NULL)
+            continue;
+
+        /* Let the clock ramp up before the first sample */
+        const double until = now_ns() + opt.warmup * 1e6;
+        while (now_ns() < until)
+            kern->run(data, (opt.max_size < 65536 ? opt.max_size : 65536) / kern->block * kern->block);
+
+        size_t size;
+        for (size = opt.min_size; size <= opt.max_size; size *= 4)
+        {
+            const size_t len = size / kern->block * kern->block;
+            bench_result res;
+            char label[16];
+
+            if (len == 0)
+                continue;
+
+            bench_size(kern, &opt, data, len, &res);
+            format_size(label, sizeof(label), len);
+
+            if (opt.json)
+            {
+                printf("%s    {\"kernel\": \"%s\", \"size\": %lu, \"lanes\": %u, \"reps\": %u, "
+                    "\"iterations\": %llu, \"cpb_median\": %.4f, \"cpb_min\": %.4f, "
+                    "\"mib_per_sec\": %.2f, \"ns_per_block\": %.3f, \"cycles_per_block\": %.2f, "
+                    "\"stddev_pct\": %.2f}",
+                    first ? "" : ",\n", kern->name, (unsigned long)len, kern->lanes, opt.reps,
+                    res.iterations, res.cpb_median, res.cpb_min, res.mib_per_sec,
+                    res.ns_per_block, res.cycles_per_block, res.stddev_pct);
+                first = 0;
+            }
+            else
+            {
+                printf("%-24s %6s %5u %9.2f %9.2f %10.1f %10.1f %6.1f%%\n", kern->name, label,
+                    kern->lanes, res.cpb_median, res.cpb_min, res.mib_per_sec,
+                    res.ns_per_block, res.stddev_pct);
+            }
+            fflush(stdout);
+
+            if (size > opt.max_size / 4)
+                break;
+        }
+    }
+
+    if (opt.json)
+        printf("\n  ]\n}\n");
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* sha-constexpr.cxx - Tests for the constexpr SHA functions */
+/*   Written and placed in public domain                    */
+
+/* The known answers are static_asserts, so they are checked by the */
+/* compiler. The sample program then compares the constexpr code,   */
+/* run on data the compiler cannot see, with the streaming API.     */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* g++ -std=c++14 -DTEST_MAIN sha-constexpr.cxx sha-ctx.o \            */
+/*     sha-dispatch.o <ISA objects> -o sha-constexpr.exe               */
+
+#include "sha-constexpr.hxx"
+
+using sha_constexpr::from_hex;
+
+// FIPS 180-2 known answers
+static_assert(sha_constexpr::sha1("abc") ==
+    from_hex<20>("a9993e364706816aba3e25717850c26c9cd0d89d"), "SHA-1 abc");
+static_assert(sha_constexpr::sha1("") ==
+    from_hex<20>("da39a3ee5e6b4b0d3255bfef95601890afd80709"), "SHA-1 empty");
+static_assert(sha_constexpr::sha1("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+    from_hex<20>("84983e441c3bd26ebaae4aa1f95129e5e54670f1"), "SHA-1 two blocks");
+
+static_assert(sha_constexpr::sha256("abc") ==
+    from_hex<32>("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), "SHA-256 abc");
+static_assert(sha_constexpr::sha256("") ==
+    from_hex<32>("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"), "SHA-256 empty");
+static_assert(sha_constexpr::sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+    from_hex<32>("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"), "SHA-256 two blocks");
+
+static_assert(sha_constexpr::sha512("abc") ==
+    from_hex<64>("ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+                 "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"), "SHA-512 abc");
+static_assert(sha_constexpr::sha512("") ==
+    from_hex<64>("cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
+                 "47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e"), "SHA-512 empty");
+
+// A tag folded into a constant, and a byte array argument
+static constexpr uint8_t s_bytes[3] = { 'a', 'b', 'c' };
+static constexpr auto s_tag = sha_constexpr::sha256(s_bytes, sizeof(s_bytes));
+static_assert(s_tag == sha_constexpr::sha256("abc") && s_tag[0] == 0xba && s_tag.size() == 32, "byte array");
+static_assert(sha_constexpr::sha256("abd") != s_tag, "different input");
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+#include "sha-ctx.h"
+
+int main(int argc, char* argv[])
+{
+    uint8_t buffer[300], expected[64];
+    bool success = true;
+
+    // argc keeps the data out of the compiler's view
+    for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = static_cast<uint8_t>(i * 7 + argc);
+
+    // Every length up to the padding edges of two blocks
+    for (size_t n = 0; n <= sizeof(buffer); ++n)
+    {
+        sha1_ctx c1;
+        sha1_init(&c1);
+        sha1_update(&c1, buffer, n);
+        sha1_final(&c1, expected);
+        success &= sha_constexpr::sha1(buffer, n).equals(expected);
+
+        sha256_ctx c256;
+        sha256_init(&c256);
+        sha256_update(&c256, buffer, n);
+        sha256_final(&c256, expected);
+        success &= sha_constexpr::sha256(buffer, n).equals(expected);
+
+        sha512_ctx c512;
+        sha512_init(&c512);
+        sha512_update(&c512, buffer, n);
+        sha512_final(&c512, expected);
+        success &= sha_constexpr::sha512(buffer, n).equals(expected);
+    }
+    printf("Run time against sha-ctx: %s\n", success ? "pass" : "fail");
+
+    // The constant needs no code to compute
+    constexpr auto pinned = sha_constexpr::sha256("sha-constexpr pinned tag");
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, "sha-constexpr pinned tag", 24);
+    sha256_final(&ctx, expected);
+    success &= pinned.equals(expected);
+    printf("Compile-time constant: %s\n", success ? "pass" : "fail");
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,314 @@
+/* sha-constexpr.hxx - SHA-1, SHA-256 and SHA-512 as C++14 constexpr */
+/*   Written and placed in public domain                            */
+
+/* Digests of fixed strings, like protocol identifiers, domain tags  */
+/* and pinned hashes, can be computed by the compiler. The result is */
+/* a literal type, so it can initialize a constexpr variable, appear */
+/* in a static_assert, or be compared with another constant without  */
+/* any code at run time. The functions also work at run time, but    */
+/* they are plain scalar code; use the streaming API there.          */
+
+/*   constexpr auto tag = sha_constexpr::sha256("example.org/v1"); */
+/*   static_assert(tag == sha_constexpr::from_hex<32>("..."), ""); */
+
+/* The implementation follows FIPS 180-4 directly. Each byte of the  */
+/* padded message is produced on demand, so no padded copy is built. */
+/* Long inputs can reach the compiler's constexpr step limit, which  */
+/* is -fconstexpr-ops-limit with GCC and -fconstexpr-steps with      */
+/* Clang.                                                            */
+
+#ifndef SHA_CONSTEXPR_HXX
+#define SHA_CONSTEXPR_HXX
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(__cplusplus) || (__cplusplus < 201402L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201402L))
+# error "sha-constexpr.hxx requires C++14"
+#endif
+
+namespace sha_constexpr {
+
+template <size_t N>
+struct digest
+{
+    uint8_t bytes[N];
+
+    static constexpr size_t size() { return N; }
+    constexpr const uint8_t& operator[](size_t i) const { return bytes[i]; }
+    constexpr const uint8_t* data() const { return bytes; }
+
+    // Compare with a digest computed at run time
+    constexpr bool equals(const uint8_t* other) const
+    {
+        uint8_t diff = 0;
+        for (size_t i = 0; i < N; ++i)
+            diff |= bytes[i] ^ other[i];
+        return diff == 0;
+    }
+};
+
+template <size_t N>
+constexpr bool operator==(const digest<N>& a, const digest<N>& b)
+{
+    return a.equals(b.bytes);
+}
+
+template <size_t N>
+constexpr bool operator!=(const digest<N>& a, const digest<N>& b)
+{
+    return !a.equals(b.bytes);
+}
+
+namespace detail {
+
+// The round constants, shared by every instantiation. A static
+//   member of a class template may be defined in a header.
+template <class T = void>
+struct tables
+{
+    static constexpr uint32_t K256[64] =
+    {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+        0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+        0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+        0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+        0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+        0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+        0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+        0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+        0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+    };
+
+    static constexpr uint64_t K512[80] =
+    {
+        0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
+        0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
+        0xd807aa98a3030242, 0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+        0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235, 0xc19bf174cf692694,
+        0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+        0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+        0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4,
+        0xc6e00bf33da88fc2, 0xd5a79147930aa725, 0x06ca6351e003826f, 0x142929670a0e6e70,
+        0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+        0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+        0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30,
+        0xd192e819d6ef5218, 0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+        0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8,
+        0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3,
+        0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+        0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b,
+        0xca273eceea26619c, 0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178,
+        0x06f067aa72176fba, 0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+        0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
+        0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+    };
+};
+
+template <class T> constexpr uint32_t tables<T>::K256[64];
+template <class T> constexpr uint64_t tables<T>::K512[80];
+
+constexpr uint32_t rotr32(uint32_t x, unsigned int n) { return (x >> n) | (x << (32 - n)); }
+constexpr uint32_t rotl32(uint32_t x, unsigned int n) { return (x << n) | (x >> (32 - n)); }
+constexpr uint64_t rotr64(uint64_t x, unsigned int n) { return (x >> n) | (x << (64 - n)); }
+
+// Byte i of the padded message, which is padded bytes in total.
+//   Only the last 8 bytes of the length field can be non-zero,
+//   including for the 16-byte field of SHA-512.
+template <class Byte>
+constexpr uint8_t padded_byte(const Byte* data, size_t length, size_t padded, size_t i)
+{
+    if (i < length)
+        return static_cast<uint8_t>(data[i]);
+    if (i == length)
+        return 0x80;
+    if (i + 8 >= padded)
+    {
+        const unsigned int shift = static_cast<unsigned int>(8 * (padded - 1 - i));
+        return static_cast<uint8_t>((static_cast<uint64_t>(length) << 3) >> shift);
+    }
+    return 0x00;
+}
+
+constexpr size_t padded_size(size_t length, size_t block, size_t W)
+{
+    return (length + 1 + W + block - 1) / block * block;
+}
+
+template <class Byte>
+constexpr digest<20> sha1(const Byte* data, size_t length)
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    const size_t padded = padded_size(length, 64, 8);
+
+    for (size_t block = 0; block < padded; block += 64)
+    {
+        uint32_t w[80] = {};
+        for (size_t t = 0; t < 16; ++t)
+            for (size_t j = 0; j < 4; ++j)
+                w[t] = (w[t] << 8) | padded_byte(data, length, padded, block + 4*t + j);
+        for (size_t t = 16; t < 80; ++t)
+            w[t] = rotl32(w[t-3] ^ w[t-8] ^ w[t-14] ^ w[t-16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (size_t t = 0; t < 80; ++t)
+        {
+            uint32_t f = 0, k = 0;
+            if (t < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if (t < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if (t < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+
+            const uint32_t temp = rotl32(a, 5) + f + e + k + w[t];
+            e = d; d = c; c = rotl32(b, 30); b = a; a = temp;
+        }
+
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    digest<20> out = {};
+    for (size_t i = 0; i < 20; ++i)
+        out.bytes[i] = static_cast<uint8_t>(h[i/4] >> (24 - 8*(i%4)));
+    return out;
+}
+
+template <class Byte>
+constexpr digest<32> sha256(const Byte* data, size_t length)
+{
+    uint32_t h[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    const size_t padded = padded_size(length, 64, 8);
+
+    for (size_t block = 0; block < padded; block += 64)
+    {
+        uint32_t w[64] = {};
+        for (size_t t = 0; t < 16; ++t)
+            for (size_t j = 0; j < 4; ++j)
+                w[t] = (w[t] << 8) | padded_byte(data, length, padded, block + 4*t + j);
+        for (size_t t = 16; t < 64; ++t)
+        {
+            const uint32_t s0 = rotr32(w[t-15], 7) ^ rotr32(w[t-15], 18) ^ (w[t-15] >> 3);
+            const uint32_t s1 = rotr32(w[t-2], 17) ^ rotr32(w[t-2], 19) ^ (w[t-2] >> 10);
+            w[t] = w[t-16] + s0 + w[t-7] + s1;
+        }
+
+        uint32_t s[8] = { h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7] };
+        for (size_t t = 0; t < 64; ++t)
+        {
+            const uint32_t S1 = rotr32(s[4], 6) ^ rotr32(s[4], 11) ^ rotr32(s[4], 25);
+            const uint32_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+            const uint32_t t1 = s[7] + S1 + ch + tables<>::K256[t] + w[t];
+            const uint32_t S0 = rotr32(s[0], 2) ^ rotr32(s[0], 13) ^ rotr32(s[0], 22);
+            const uint32_t maj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+
+            s[7] = s[6]; s[6] = s[5]; s[5] = s[4]; s[4] = s[3] + t1;
+            s[3] = s[2]; s[2] = s[1]; s[1] = s[0]; s[0] = t1 + S0 + maj;
+        }
+
+        for (size_t i = 0; i < 8; ++i)
+            h[i] += s[i];
+    }
+
+    digest<32> out = {};
+    for (size_t i = 0; i < 32; ++i)
+        out.bytes[i] = static_cast<uint8_t>(h[i/4] >> (24 - 8*(i%4)));
+    return out;
+}
+
+template <class Byte>
+constexpr digest<64> sha512(const Byte* data, size_t length)
+{
+    uint64_t h[8] = {
+        0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+        0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+    };
+    const size_t padded = padded_size(length, 128, 16);
+
+    for (size_t block = 0; block < padded; block += 128)
+    {
+        uint64_t w[80] = {};
+        for (size_t t = 0; t < 16; ++t)
+            for (size_t j = 0; j < 8; ++j)
+                w[t] = (w[t] << 8) | padded_byte(data, length, padded, block + 8*t + j);
+        for (size_t t = 16; t < 80; ++t)
+        {
+            const uint64_t s0 = rotr64(w[t-15], 1) ^ rotr64(w[t-15], 8) ^ (w[t-15] >> 7);
+            const uint64_t s1 = rotr64(w[t-2], 19) ^ rotr64(w[t-2], 61) ^ (w[t-2] >> 6);
+            w[t] = w[t-16] + s0 + w[t-7] + s1;
+        }
+
+        uint64_t s[8] = { h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7] };
+        for (size_t t = 0; t < 80; ++t)
+        {
+            const uint64_t S1 = rotr64(s[4], 14) ^ rotr64(s[4], 18) ^ rotr64(s[4], 41);
+            const uint64_t ch = (s[4] & s[5]) ^ (~s[4] & s[6]);
+            const uint64_t t1 = s[7] + S1 + ch + tables<>::K512[t] + w[t];
+            const uint64_t S0 = rotr64(s[0], 28) ^ rotr64(s[0], 34) ^ rotr64(s[0], 39);
+            const uint64_t maj = (s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]);
+
+            s[7] = s[6]; s[6] = s[5]; s[5] = s[4]; s[4] = s[3] + t1;
+            s[3] = s[2]; s[2] = s[1]; s[1] = s[0]; s[0] = t1 + S0 + maj;
+        }
+
+        for (size_t i = 0; i < 8; ++i)
+            h[i] += s[i];
+    }
+
+    digest<64> out = {};
+    for (size_t i = 0; i < 64; ++i)
+        out.bytes[i] = static_cast<uint8_t>(h[i/8] >> (56 - 8*(i%8)));
+    return out;
+}
+
+constexpr uint8_t hex_nibble(char c)
+{
+    return (c >= '0' && c <= '9') ? static_cast<uint8_t>(c - '0') :
+           (c >= 'a' && c <= 'f') ? static_cast<uint8_t>(c - 'a' + 10) :
+           (c >= 'A' && c <= 'F') ? static_cast<uint8_t>(c - 'A' + 10) :
+           throw "sha_constexpr: bad hex digit";
+}
+
+}  // namespace detail
+
+// Hash length bytes at data. Byte is char, unsigned char or uint8_t.
+template <class Byte>
+constexpr digest<20> sha1(const Byte* data, size_t length) { return detail::sha1(data, length); }
+template <class Byte>
+constexpr digest<32> sha256(const Byte* data, size_t length) { return detail::sha256(data, length); }
+template <class Byte>
+constexpr digest<64> sha512(const Byte* data, size_t length) { return detail::sha512(data, length); }
+
+// Hash a string literal, without its terminating NUL
+template <size_t L>
+constexpr digest<20> sha1(const char (&text)[L]) { return detail::sha1(text, L - 1); }
+template <size_t L>
+constexpr digest<32> sha256(const char (&text)[L]) { return detail::sha256(text, L - 1); }
+template <size_t L>
+constexpr digest<64> sha512(const char (&text)[L]) { return detail::sha512(text, L - 1); }
+
+// A digest written as 2*N hex digits, for pinned values. A wrong
+//   length or a bad digit fails to compile in a constant expression.
+template <size_t N, size_t L>
+constexpr digest<N> from_hex(const char (&text)[L])
+{
+    static_assert(L == 2*N + 1, "sha_constexpr::from_hex: wrong number of hex digits");
+
+    digest<N> out = {};
+    for (size_t i = 0; i < N; ++i)
+        out.bytes[i] = static_cast<uint8_t>((detail::hex_nibble(text[2*i]) << 4) |
+                                            detail::hex_nibble(text[2*i+1]));
+    return out;
+}
+
+}  // namespace sha_constexpr
+
+#endif  // SHA_CONSTEXPR_HXX
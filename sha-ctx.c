@@ -0,0 +1,661 @@
+/* sha-ctx.c - Streaming init/update/final over the compress functions */
+/*   Written and placed in public domain                              */
+
+/* update() buffers only a partial block. Runs of whole blocks go     */
+/* straight from the caller's buffer to the dispatched kernel. final() */
+/* builds the one or two padding blocks in a local block and hands     */
+/* them to the kernel in a single call, so the state is loaded and     */
+/* shuffled once for the tail.                                         */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -DTEST_MAIN sha-ctx.c sha-dispatch.o <ISA objects> -o sha-ctx.exe */
+
+#include <string.h>
+
+#include "sha-ctx.h"
+#include "sha-dispatch.h"
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v >>  0);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v)
+{
+    store_be32(p+0, (uint32_t)(v >> 32));
+    store_be32(p+4, (uint32_t)(v >>  0));
+}
+
+static inline uint32_t load_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] <<  8) | ((uint32_t)p[3] <<  0);
+}
+
+static inline uint64_t load_be64(const uint8_t* p)
+{
+    return ((uint64_t)load_be32(p) << 32) | load_be32(p+4);
+}
+
+/**************************** SHA-1 ****************************/
+
+void sha1_init(sha1_ctx* ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+}
+
+void sha1_update(sha1_ctx* ctx, const void* data, size_t length)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    const size_t used = (size_t)(ctx->length % 64);
+
+    /* data may be NULL with nothing to hash */
+    if (length == 0)
+        return;
+
+    ctx->length += length;
+
+    if (used)
+    {
+        const size_t fill = 64 - used;
+        if (length < fill)
+        {
+            memcpy(ctx->buffer + used, ptr, length);
+            return;
+        }
+        memcpy(ctx->buffer + used, ptr, fill);
+        sha1_process_dispatch(ctx->state, ctx->buffer, 64);
+        ptr += fill;
+        length -= fill;
+    }
+
+    /* Whole blocks straight from the caller's buffer */
+    const size_t blocks = length & ~(size_t)63;
+    if (blocks)
+    {
+        sha1_process_blocks_dispatch(ctx->state, ptr, blocks);
+        ptr += blocks;
+        length -= blocks;
+    }
+
+    if (length)
+        memcpy(ctx->buffer, ptr, length);
+}
+
+void sha1_final(sha1_ctx* ctx, uint8_t digest[20])
+{
+    union { uint64_t w[16]; uint8_t b[128]; } pad;
+    const size_t used = (size_t)(ctx->length % 64);
+    const size_t total = (used < 56) ? 64 : 128;
+
+    memcpy(pad.b, ctx->buffer, used);
+    memset(pad.b + used, 0x00, total - used);
+    pad.b[used] = 0x80;
+    store_be64(pad.b + total - 8, ctx->length << 3);
+
+    sha1_process_dispatch(ctx->state, pad.b, (uint32_t)total);
+
+    unsigned int i;
+    for (i = 0; i < 5; ++i)
+        store_be32(digest + 4*i, ctx->state[i]);
+
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+/*************************** SHA-256 ***************************/
+
+void sha256_init(sha256_ctx* ctx)
+{
+    ctx->state[0] = 0x6a09e667;
+    ctx->state[1] = 0xbb67ae85;
+    ctx->state[2] = 0x3c6ef372;
+    ctx->state[3] = 0xa54ff53a;
+    ctx->state[4] = 0x510e527f;
+    ctx->state[5] = 0x9b05688c;
+    ctx->state[6] = 0x1f83d9ab;
+    ctx->state[7] = 0x5be0cd19;
+    ctx->length = 0;
+}
+
+void sha256_update(sha256_ctx* ctx, const void* data, size_t length)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    const size_t used = (size_t)(ctx->length % 64);
+
+    if (length == 0)
+        return;
+
+    ctx->length += length;
+
+    if (used)
+    {
+        const size_t fill = 64 - used;
+        if (length < fill)
+        {
+            memcpy(ctx->buffer + used, ptr, length);
+            return;
+        }
+        memcpy(ctx->buffer + used, ptr, fill);
+        sha256_process_dispatch(ctx->state, ctx->buffer, 64);
+        ptr += fill;
+        length -= fill;
+    }
+
+    /* Whole blocks straight from the caller's buffer */
+    const size_t blocks = length & ~(size_t)63;
+    if (blocks)
+    {
+        sha256_process_blocks_dispatch(ctx->state, ptr, blocks);
+        ptr += blocks;
+        length -= blocks;
+    }
+
+    if (length)
+        memcpy(ctx->buffer, ptr, length);
+}
+
+void sha256_final(sha256_ctx* ctx, uint8_t digest[32])
+{
+    union { uint64_t w[16]; uint8_t b[128]; } pad;
+    const size_t used = (size_t)(ctx->length % 64);
+    const size_t total = (used < 56) ? 64 : 128;
+
+    memcpy(pad.b, ctx->buffer, used);
+    memset(pad.b + used, 0x00, total - used);
+    pad.b[used] = 0x80;
+    store_be64(pad.b + total - 8, ctx->length << 3);
+
+    sha256_process_dispatch(ctx->state, pad.b, (uint32_t)total);
+
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be32(digest + 4*i, ctx->state[i]);
+
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+/******************** SHA-256 native layout ********************/
+
+static const uint32_t SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+void sha256_native_init(sha256_native_ctx* ctx)
+{
+    sha256_to_native_dispatch(ctx->native, SHA256_IV);
+    ctx->length = 0;
+}
+
+void sha256_native_update(sha256_native_ctx* ctx, const void* data, size_t length)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    const size_t used = (size_t)(ctx->length % 64);
+
+    if (length == 0)
+        return;
+
+    ctx->length += length;
+
+    if (used)
+    {
+        const size_t fill = 64 - used;
+        if (length < fill)
+        {
+            memcpy(ctx->buffer + used, ptr, length);
+            return;
+        }
+        memcpy(ctx->buffer + used, ptr, fill);
+        sha256_process_native_dispatch(ctx->native, ctx->buffer, 64);
+        ptr += fill;
+        length -= fill;
+    }
+
+    const size_t blocks = length & ~(size_t)63;
+    if (blocks)
+    {
+        sha256_process_native_blocks_dispatch(ctx->native, ptr, blocks);
+        ptr += blocks;
+        length -= blocks;
+    }
+
+    if (length)
+        memcpy(ctx->buffer, ptr, length);
+}
+
+void sha256_native_final(sha256_native_ctx* ctx, uint8_t digest[32])
+{
+    union { uint64_t w[16]; uint8_t b[128]; } pad;
+    const size_t used = (size_t)(ctx->length % 64);
+    const size_t total = (used < 56) ? 64 : 128;
+    uint32_t state[8];
+
+    memcpy(pad.b, ctx->buffer, used);
+    memset(pad.b + used, 0x00, total - used);
+    pad.b[used] = 0x80;
+    store_be64(pad.b + total - 8, ctx->length << 3);
+
+    sha256_process_native_dispatch(ctx->native, pad.b, (uint32_t)total);
+    sha256_from_native_dispatch(state, ctx->native);
+
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be32(digest + 4*i, state[i]);
+
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+int sha256_native_export(const sha256_native_ctx* ctx, sha256_midstate* mid)
+{
+    if (ctx->length % 64)
+        return -1;
+    sha256_from_native_dispatch(mid->state, ctx->native);
+    mid->length = ctx->length;
+    return 0;
+}
+
+void sha256_native_import(sha256_native_ctx* ctx, const sha256_midstate* mid)
+{
+    sha256_to_native_dispatch(ctx->native, mid->state);
+    ctx->length = mid->length;
+}
+
+/*************************** SHA-512 ***************************/
+
+void sha512_init(sha512_ctx* ctx)
+{
+    ctx->state[0] = 0x6a09e667f3bcc908ULL;
+    ctx->state[1] = 0xbb67ae8584caa73bULL;
+    ctx->state[2] = 0x3c6ef372fe94f82bULL;
+    ctx->state[3] = 0xa54ff53a5f1d36f1ULL;
+    ctx->state[4] = 0x510e527fade682d1ULL;
+    ctx->state[5] = 0x9b05688c2b3e6c1fULL;
+    ctx->state[6] = 0x1f83d9abfb41bd6bULL;
+    ctx->state[7] = 0x5be0cd19137e2179ULL;
+    ctx->length = 0;
+}
+
+void sha512_update(sha512_ctx* ctx, const void* data, size_t length)
+{
+    const uint8_t* ptr = (const uint8_t*)data;
+    const size_t used = (size_t)(ctx->length % 128);
+
+    if (length == 0)
+        return;
+
+    ctx->length += length;
+
+    if (used)
+    {
+        const size_t fill = 128 - used;
+        if (length < fill)
+        {
+            memcpy(ctx->buffer + used, ptr, length);
+            return;
+        }
+        memcpy(ctx->buffer + used, ptr, fill);
+        sha512_process_dispatch(ctx->state, ctx->buffer, 128);
+        ptr += fill;
+        length -= fill;
+    }
+
+    /* Whole blocks straight from the caller's buffer */
+    const size_t blocks = length & ~(size_t)127;
+    if (blocks)
+    {
+        sha512_process_blocks_dispatch(ctx->state, ptr, blocks);
+        ptr += blocks;
+        length -= blocks;
+    }
+
+    if (length)
+        memcpy(ctx->buffer, ptr, length);
+}
+
+void sha512_final(sha512_ctx* ctx, uint8_t digest[64])
+{
+    union { uint64_t w[32]; uint8_t b[256]; } pad;
+    const size_t used = (size_t)(ctx->length % 128);
+    const size_t total = (used < 112) ? 128 : 256;
+
+    memcpy(pad.b, ctx->buffer, used);
+    memset(pad.b + used, 0x00, total - used);
+    pad.b[used] = 0x80;
+    store_be64(pad.b + total - 16, ctx->length >> 61);
+    store_be64(pad.b + total -  8, ctx->length << 3);
+
+    sha512_process_dispatch(ctx->state, pad.b, total);
+
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be64(digest + 8*i, ctx->state[i]);
+
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+/************************** Midstates **************************/
+
+int sha1_export(const sha1_ctx* ctx, sha1_midstate* mid)
+{
+    if (ctx->length % 64)
+        return -1;
+    memcpy(mid->state, ctx->state, sizeof(mid->state));
+    mid->length = ctx->length;
+    return 0;
+}
+
+void sha1_import(sha1_ctx* ctx, const sha1_midstate* mid)
+{
+    memcpy(ctx->state, mid->state, sizeof(ctx->state));
+    ctx->length = mid->length;
+}
+
+void sha1_clone(sha1_ctx* dst, const sha1_ctx* src)
+{
+    memcpy(dst->state, src->state, sizeof(dst->state));
+    memcpy(dst->buffer, src->buffer, (size_t)(src->length % 64));
+    dst->length = src->length;
+}
+
+void sha1_midstate_serialize(const sha1_midstate* mid, uint8_t out[SHA1_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    for (i = 0; i < 5; ++i)
+        store_be32(out + 4*i, mid->state[i]);
+    store_be64(out + 20, mid->length);
+}
+
+int sha1_midstate_deserialize(sha1_midstate* mid, const uint8_t in[SHA1_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    if (load_be64(in + 20) % 64)
+        return -1;
+    for (i = 0; i < 5; ++i)
+        mid->state[i] = load_be32(in + 4*i);
+    mid->length = load_be64(in + 20);
+    return 0;
+}
+
+int sha256_export(const sha256_ctx* ctx, sha256_midstate* mid)
+{
+    if (ctx->length % 64)
+        return -1;
+    memcpy(mid->state, ctx->state, sizeof(mid->state));
+    mid->length = ctx->length;
+    return 0;
+}
+
+void sha256_import(sha256_ctx* ctx, const sha256_midstate* mid)
+{
+    memcpy(ctx->state, mid->state, sizeof(ctx->state));
+    ctx->length = mid->length;
+}
+
+void sha256_clone(sha256_ctx* dst, const sha256_ctx* src)
+{
+    memcpy(dst->state, src->state, sizeof(dst->state));
+    memcpy(dst->buffer, src->buffer, (size_t)(src->length % 64));
+    dst->length = src->length;
+}
+
+void sha256_midstate_serialize(const sha256_midstate* mid, uint8_t out[SHA256_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be32(out + 4*i, mid->state[i]);
+    store_be64(out + 32, mid->length);
+}
+
+int sha256_midstate_deserialize(sha256_midstate* mid, const uint8_t in[SHA256_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    if (load_be64(in + 32) % 64)
+        return -1;
+    for (i = 0; i < 8; ++i)
+        mid->state[i] = load_be32(in + 4*i);
+    mid->length = load_be64(in + 32);
+    return 0;
+}
+
+int sha512_export(const sha512_ctx* ctx, sha512_midstate* mid)
+{
+    if (ctx->length % 128)
+        return -1;
+    memcpy(mid->state, ctx->state, sizeof(mid->state));
+    mid->length = ctx->length;
+    return 0;
+}
+
+void sha512_import(sha512_ctx* ctx, const sha512_midstate* mid)
+{
+    memcpy(ctx->state, mid->state, sizeof(ctx->state));
+    ctx->length = mid->length;
+}
+
+void sha512_clone(sha512_ctx* dst, const sha512_ctx* src)
+{
+    memcpy(dst->state, src->state, sizeof(dst->state));
+    memcpy(dst->buffer, src->buffer, (size_t)(src->length % 128));
+    dst->length = src->length;
+}
+
+void sha512_midstate_serialize(const sha512_midstate* mid, uint8_t out[SHA512_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be64(out + 8*i, mid->state[i]);
+    store_be64(out + 64, mid->length);
+}
+
+int sha512_midstate_deserialize(sha512_midstate* mid, const uint8_t in[SHA512_MIDSTATE_SIZE])
+{
+    unsigned int i;
+    if (load_be64(in + 64) % 128)
+        return -1;
+    for (i = 0; i < 8; ++i)
+        mid->state[i] = load_be64(in + 8*i);
+    mid->length = load_be64(in + 64);
+    return 0;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+
+/* Hash the message one byte at a time, then in odd-sized pieces */
+static int check_sha256(const char* msg, const uint8_t expected[32])
+{
+    const size_t len = strlen(msg);
+    uint8_t digest[32];
+    sha256_ctx ctx;
+    size_t i;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, NULL, 0);
+    sha256_update(&ctx, msg, len);
+    sha256_update(&ctx, NULL, 0);
+    sha256_final(&ctx, digest);
+    int success = (memcmp(digest, expected, 32) == 0);
+
+    sha256_init(&ctx);
+    for (i = 0; i < len; ++i)
+        sha256_update(&ctx, msg+i, 1);
+    sha256_final(&ctx, digest);
+    success &= (memcmp(digest, expected, 32) == 0);
+
+    sha256_init(&ctx);
+    for (i = 0; i < len; i += 7)
+        sha256_update(&ctx, msg+i, (len-i < 7) ? len-i : 7);
+    sha256_final(&ctx, digest);
+    success &= (memcmp(digest, expected, 32) == 0);
+
+    sha256_native_ctx nctx;
+    sha256_native_init(&nctx);
+    for (i = 0; i < len; i += 7)
+        sha256_native_update(&nctx, msg+i, (len-i < 7) ? len-i : 7);
+    sha256_native_final(&nctx, digest);
+    success &= (memcmp(digest, expected, 32) == 0);
+
+    return success;
+}
+
+int main(int argc, char* argv[])
+{
+    int success = 1;
+    const char* msg1 = "abc";
+    const char* msg2 = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const char* msg3 = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+    static const uint8_t sha256_1[32] = {
+        0xba,0x78,0x16,0xbf,0x8f,0x01,0xcf,0xea,0x41,0x41,0x40,0xde,0x5d,0xae,0x22,0x23,
+        0xb0,0x03,0x61,0xa3,0x96,0x17,0x7a,0x9c,0xb4,0x10,0xff,0x61,0xf2,0x00,0x15,0xad
+    };
+    static const uint8_t sha256_2[32] = {
+        0x24,0x8d,0x6a,0x61,0xd2,0x06,0x38,0xb8,0xe5,0xc0,0x26,0x93,0x0c,0x3e,0x60,0x39,
+        0xa3,0x3c,0xe4,0x59,0x64,0xff,0x21,0x67,0xf6,0xec,0xed,0xd4,0x19,0xdb,0x06,0xc1
+    };
+    static const uint8_t sha1_1[20] = {
+        0xa9,0x99,0x3e,0x36,0x47,0x06,0x81,0x6a,0xba,0x3e,
+        0x25,0x71,0x78,0x50,0xc2,0x6c,0x9c,0xd0,0xd8,0x9d
+    };
+    static const uint8_t sha512_3[64] = {
+        0x8e,0x95,0x9b,0x75,0xda,0xe3,0x13,0xda,0x8c,0xf4,0xf7,0x28,0x14,0xfc,0x14,0x3f,
+        0x8f,0x77,0x79,0xc6,0xeb,0x9f,0x7f,0xa1,0x72,0x99,0xae,0xad,0xb6,0x88,0x90,0x18,
+        0x50,0x1d,0x28,0x9e,0x49,0x00,0xf7,0xe4,0x33,0x1b,0x99,0xde,0xc4,0xb5,0x43,0x3a,
+        0xc7,0xd3,0x29,0xee,0xb6,0xdd,0x26,0x54,0x5e,0x96,0xe5,0x5b,0x87,0x4b,0xe9,0x09
+    };
+
+    success &= check_sha256(msg1, sha256_1);
+    success &= check_sha256(msg2, sha256_2);
+    printf("SHA256 streaming: %s\n", success ? "pass" : "fail");
+
+    {
+        uint8_t digest[20];
+        sha1_ctx ctx;
+        sha1_init(&ctx);
+        sha1_update(&ctx, msg1, strlen(msg1));
+        sha1_final(&ctx, digest);
+        success &= (memcmp(digest, sha1_1, 20) == 0);
+        printf("SHA1 streaming: %s\n", success ? "pass" : "fail");
+    }
+
+    {
+        uint8_t digest[64];
+        sha512_ctx ctx;
+        size_t i, len = strlen(msg3);
+        sha512_init(&ctx);
+        for (i = 0; i < len; i += 13)
+            sha512_update(&ctx, msg3+i, (len-i < 13) ? len-i : 13);
+        sha512_final(&ctx, digest);
+        success &= (memcmp(digest, sha512_3, 64) == 0);
+        printf("SHA512 streaming: %s\n", success ? "pass" : "fail");
+    }
+
+    /* Fork a prefix of 128 bytes and compare with hashing in one go */
+    {
+        uint8_t msg[300], digest[64], direct[64], wire[SHA512_MIDSTATE_SIZE];
+        sha1_ctx c1, f1;
+        sha256_ctx c256, f256;
+        sha512_ctx c512, f512;
+        sha1_midstate m1;
+        sha256_midstate m256;
+        sha512_midstate m512;
+        size_t i;
+
+        for (i = 0; i < sizeof(msg); ++i)
+            msg[i] = (uint8_t)(i * 17 + 1);
+
+        sha256_init(&c256);
+        sha256_update(&c256, msg, sizeof(msg));
+        sha256_final(&c256, direct);
+
+        sha256_init(&c256);
+        success &= (sha256_export(&c256, &m256) == 0);
+        sha256_update(&c256, msg, 3);
+        success &= (sha256_export(&c256, &m256) == -1);
+        sha256_update(&c256, msg + 3, 125);
+        success &= (sha256_export(&c256, &m256) == 0);
+        sha256_midstate_serialize(&m256, wire);
+        memset(&m256, 0x00, sizeof(m256));
+        success &= (sha256_midstate_deserialize(&m256, wire) == 0);
+        sha256_import(&f256, &m256);
+        sha256_update(&f256, msg + 128, sizeof(msg) - 128);
+        sha256_final(&f256, digest);
+        success &= (memcmp(digest, direct, 32) == 0);
+
+        /* A clone keeps the partial block */
+        sha256_update(&c256, msg + 128, 5);
+        sha256_clone(&f256, &c256);
+        sha256_update(&f256, msg + 133, sizeof(msg) - 133);
+        sha256_final(&f256, digest);
+        success &= (memcmp(digest, direct, 32) == 0);
+
+        /* A midstate moves between the native and word order contexts */
+        sha256_native_ctx n256;
+        sha256_native_init(&n256);
+        sha256_native_update(&n256, msg, 128);
+        success &= (sha256_native_export(&n256, &m256) == 0);
+        sha256_import(&f256, &m256);
+        sha256_update(&f256, msg + 128, sizeof(msg) - 128);
+        sha256_final(&f256, digest);
+        success &= (memcmp(digest, direct, 32) == 0);
+
+        sha256_native_import(&n256, &m256);
+        sha256_native_update(&n256, msg + 128, 1);
+        success &= (sha256_native_export(&n256, &m256) == -1);
+        sha256_native_update(&n256, msg + 129, sizeof(msg) - 129);
+        sha256_native_final(&n256, digest);
+        success &= (memcmp(digest, direct, 32) == 0);
+
+        wire[39] = 0x41;
+        success &= (sha256_midstate_deserialize(&m256, wire) == -1);
+
+        sha1_init(&c1);
+        sha1_update(&c1, msg, sizeof(msg));
+        sha1_final(&c1, direct);
+
+        sha1_init(&c1);
+        sha1_update(&c1, msg, 128);
+        success &= (sha1_export(&c1, &m1) == 0);
+        sha1_midstate_serialize(&m1, wire);
+        success &= (sha1_midstate_deserialize(&m1, wire) == 0);
+        sha1_import(&f1, &m1);
+        sha1_update(&f1, msg + 128, sizeof(msg) - 128);
+        sha1_final(&f1, digest);
+        success &= (memcmp(digest, direct, 20) == 0);
+
+        sha512_init(&c512);
+        sha512_update(&c512, msg, sizeof(msg));
+        sha512_final(&c512, direct);
+
+        sha512_init(&c512);
+        sha512_update(&c512, msg, 128);
+        success &= (sha512_export(&c512, &m512) == 0);
+        sha512_midstate_serialize(&m512, wire);
+        success &= (sha512_midstate_deserialize(&m512, wire) == 0);
+        sha512_import(&f512, &m512);
+        sha512_update(&f512, msg + 128, sizeof(msg) - 128);
+        sha512_final(&f512, digest);
+        success &= (memcmp(digest, direct, 64) == 0);
+
+        sha512_update(&c512, msg + 128, 1);
+        success &= (sha512_export(&c512, &m512) == -1);
+        printf("Midstates: %s\n", success ? "pass" : "fail");
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,122 @@
+/* sha-ctx.h - Streaming init/update/final over the compress functions */
+/*   Written and placed in public domain                              */
+
+/* The contexts sit on top of the dispatched compress functions. Full */
+/* blocks are passed to the kernel straight from the caller's buffer. */
+/* Only a partial block is copied into the context.                   */
+
+#ifndef SHA_CTX_H
+#define SHA_CTX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct sha1_ctx
+{
+    uint32_t state[5];
+    uint64_t length;      /* bytes hashed so far */
+    uint8_t  buffer[64];  /* partial block */
+} sha1_ctx;
+
+typedef struct sha256_ctx
+{
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t  buffer[64];
+} sha256_ctx;
+
+typedef struct sha512_ctx
+{
+    uint64_t state[8];
+    uint64_t length;
+    uint8_t  buffer[128];
+} sha512_ctx;
+
+void sha1_init(sha1_ctx* ctx);
+void sha1_update(sha1_ctx* ctx, const void* data, size_t length);
+void sha1_final(sha1_ctx* ctx, uint8_t digest[20]);
+
+void sha256_init(sha256_ctx* ctx);
+void sha256_update(sha256_ctx* ctx, const void* data, size_t length);
+void sha256_final(sha256_ctx* ctx, uint8_t digest[32]);
+
+void sha512_init(sha512_ctx* ctx);
+void sha512_update(sha512_ctx* ctx, const void* data, size_t length);
+void sha512_final(sha512_ctx* ctx, uint8_t digest[64]);
+
+/* A midstate is the chaining state after a whole number of blocks, */
+/*  with the number of bytes it covers. Compress a shared prefix     */
+/*  once, export the midstate, and import it into a context for     */
+/*  every message that starts with the prefix.                       */
+typedef struct sha1_midstate
+{
+    uint32_t state[5];
+    uint64_t length;      /* a multiple of the block size */
+} sha1_midstate;
+
+typedef struct sha256_midstate
+{
+    uint32_t state[8];
+    uint64_t length;
+} sha256_midstate;
+
+typedef struct sha512_midstate
+{
+    uint64_t state[8];
+    uint64_t length;
+} sha512_midstate;
+
+/* Serialized midstates are the state words and then the length, */
+/*  all big-endian.                                               */
+#define SHA1_MIDSTATE_SIZE   28
+#define SHA256_MIDSTATE_SIZE 40
+#define SHA512_MIDSTATE_SIZE 72
+
+/* Export returns -1 if the context holds a partial block, */
+/*  0 otherwise.                                           */
+int  sha1_export(const sha1_ctx* ctx, sha1_midstate* mid);
+void sha1_import(sha1_ctx* ctx, const sha1_midstate* mid);
+void sha1_clone(sha1_ctx* dst, const sha1_ctx* src);
+void sha1_midstate_serialize(const sha1_midstate* mid, uint8_t out[SHA1_MIDSTATE_SIZE]);
+int  sha1_midstate_deserialize(sha1_midstate* mid, const uint8_t in[SHA1_MIDSTATE_SIZE]);
+
+int  sha256_export(const sha256_ctx* ctx, sha256_midstate* mid);
+void sha256_import(sha256_ctx* ctx, const sha256_midstate* mid);
+void sha256_clone(sha256_ctx* dst, const sha256_ctx* src);
+void sha256_midstate_serialize(const sha256_midstate* mid, uint8_t out[SHA256_MIDSTATE_SIZE]);
+int  sha256_midstate_deserialize(sha256_midstate* mid, const uint8_t in[SHA256_MIDSTATE_SIZE]);
+
+int  sha512_export(const sha512_ctx* ctx, sha512_midstate* mid);
+void sha512_import(sha512_ctx* ctx, const sha512_midstate* mid);
+void sha512_clone(sha512_ctx* dst, const sha512_ctx* src);
+void sha512_midstate_serialize(const sha512_midstate* mid, uint8_t out[SHA512_MIDSTATE_SIZE]);
+int  sha512_midstate_deserialize(sha512_midstate* mid, const uint8_t in[SHA512_MIDSTATE_SIZE]);
+
+/* A SHA-256 context that keeps the state in the dispatched kernel's */
+/*  register layout between calls, ABEF and CDGH with SHA-NI. Many    */
+/*  small updates then skip the state shuffles on every kernel call. */
+/*  The state is converted only by final and export. The layout is   */
+/*  opaque and belongs to the process that made it, so do not copy   */
+/*  native[] out; export a midstate instead.                         */
+typedef struct sha256_native_ctx
+{
+    uint32_t native[8];
+    uint64_t length;
+    uint8_t  buffer[64];
+} sha256_native_ctx;
+
+void sha256_native_init(sha256_native_ctx* ctx);
+void sha256_native_update(sha256_native_ctx* ctx, const void* data, size_t length);
+void sha256_native_final(sha256_native_ctx* ctx, uint8_t digest[32]);
+int  sha256_native_export(const sha256_native_ctx* ctx, sha256_midstate* mid);
+void sha256_native_import(sha256_native_ctx* ctx, const sha256_midstate* mid);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_CTX_H */
@@ -0,0 +1,577 @@
+/* sha-dispatch.c - Runtime selection of SHA compress functions */
+/*   Written and placed in public domain                       */
+
+/* Each ISA file is compiled with its own flags. The dispatcher is  */
+/* compiled with the baseline flags for the platform.               */
+
+/* gcc -c -msse4.1 -msha sha1-x86.c sha256-x86.c                      */
+/* gcc -c -mavx2 -mbmi2 sha512-avx2.c                                 */
+/* gcc -c -mbmi2 sha256-bmi2.c                                        */
+/* gcc -c sha1.c sha256.c sha512.c                                    */
+/* gcc -DTEST_MAIN sha-dispatch.c sha1-x86.o sha256-x86.o \           */
+/*     sha512-avx2.o sha256-bmi2.o sha1.o sha256.o sha512.o \         */
+/*     -o sha-dispatch.exe                                            */
+
+/* gcc -c -march=armv8-a+crypto sha1-arm.c sha256-arm.c               */
+/* gcc -c sha1.c sha256.c sha512.c                                    */
+/* gcc -DTEST_MAIN sha-dispatch.c sha1-arm.o sha256-arm.o sha1.o \    */
+/*     sha256.o sha512.o -o sha-dispatch.exe                          */
+
+/* Define SHA_DISPATCH_PORTABLE to build without the ISA files. */
+
+#include "sha-dispatch.h"
+#include <string.h>
+
+#if defined(SHA_DISPATCH_X86)
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# else
+#  include <cpuid.h>
+# endif
+#endif
+
+#if (defined(SHA_DISPATCH_ARM) || defined(SHA_DISPATCH_P8)) && defined(__linux__)
+# include <sys/auxv.h>
+#endif
+
+/* Linux hwcap bits, in case the headers are too old to provide them */
+#if defined(SHA_DISPATCH_ARM)
+# ifndef AT_HWCAP2
+#  define AT_HWCAP2 26
+# endif
+# ifndef HWCAP_SHA1
+#  define HWCAP_SHA1 (1 << 5)
+# endif
+# ifndef HWCAP_SHA2
+#  define HWCAP_SHA2 (1 << 6)
+# endif
+# ifndef HWCAP_SHA512
+#  define HWCAP_SHA512 (1 << 21)
+# endif
+# ifndef HWCAP2_SHA1
+#  define HWCAP2_SHA1 (1 << 2)
+# endif
+# ifndef HWCAP2_SHA2
+#  define HWCAP2_SHA2 (1 << 3)
+# endif
+#endif
+
+#if defined(SHA_DISPATCH_P8)
+# ifndef AT_HWCAP2
+#  define AT_HWCAP2 26
+# endif
+# ifndef PPC_FEATURE2_VEC_CRYPTO
+#  define PPC_FEATURE2_VEC_CRYPTO 0x02000000
+# endif
+#endif
+
+#if defined(SHA_DISPATCH_X86)
+static void cpuid_count(unsigned int leaf, unsigned int sub, unsigned int info[4])
+{
+#if defined(_MSC_VER)
+    __cpuidex((int*)info, (int)leaf, (int)sub);
+#else
+    __cpuid_count(leaf, sub, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+/* XCR0 tells us which register state the OS saves on a context switch */
+static uint64_t xgetbv0(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static unsigned int probe_features(void)
+{
+    unsigned int info[4], features = 0;
+
+    cpuid_count(0, 0, info);
+    const unsigned int max_leaf = info[0];
+    if (max_leaf < 7)
+        return 0;
+
+    cpuid_count(1, 0, info);
+    const int ssse3   = (info[2] & (1 << 9))  != 0;
+    const int sse41   = (info[2] & (1 << 19)) != 0;
+    const int osxsave = (info[2] & (1 << 27)) != 0;
+    const uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+    const int ymm     = (xcr0 & 0x06) == 0x06;
+    const int zmm     = (xcr0 & 0xE6) == 0xE6;
+
+    cpuid_count(7, 0, info);
+    const int sha      = (info[1] & (1 << 29)) != 0;
+    const int avx2     = (info[1] & (1 <<  5)) != 0;
+    const int avx512f  = (info[1] & (1 << 16)) != 0;
+    const int avx512bw = (info[1] & (1 << 30)) != 0;
+    const int bmi2     = (info[1] & (1 <<  8)) != 0;
+
+    if (ssse3 && sse41 && sha)
+        features |= SHA_CPU_X86_SHA;
+    if (avx2 && ymm)
+        features |= SHA_CPU_X86_AVX2;
+    if (avx512f && avx512bw && zmm)
+        features |= SHA_CPU_X86_AVX512;
+    if (bmi2)
+        features |= SHA_CPU_X86_BMI2;
+
+    return features;
+}
+
+#elif defined(SHA_DISPATCH_ARM)
+static unsigned int probe_features(void)
+{
+    unsigned int features = 0;
+
+#if defined(__linux__) && (defined(__aarch64__) || defined(__arm64__))
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+    if (hwcap & HWCAP_SHA1)
+        features |= SHA_CPU_ARM_SHA1;
+    if (hwcap & HWCAP_SHA2)
+        features |= SHA_CPU_ARM_SHA2;
+    if (hwcap & HWCAP_SHA512)
+        features |= SHA_CPU_ARM_SHA512;
+#elif defined(__linux__)
+    const unsigned long hwcap2 = getauxval(AT_HWCAP2);
+    if (hwcap2 & HWCAP2_SHA1)
+        features |= SHA_CPU_ARM_SHA1;
+    if (hwcap2 & HWCAP2_SHA2)
+        features |= SHA_CPU_ARM_SHA2;
+#elif defined(__APPLE__) && (defined(__aarch64__) || defined(__arm64__))
+    /* Every Apple Aarch64 core has SHA1 and SHA256 */
+    features |= SHA_CPU_ARM_SHA1 | SHA_CPU_ARM_SHA2;
+#endif
+
+    return features;
+}
+
+#elif defined(SHA_DISPATCH_P8)
+static unsigned int probe_features(void)
+{
+    unsigned int features = 0;
+
+#if defined(__linux__)
+    if (getauxval(AT_HWCAP2) & PPC_FEATURE2_VEC_CRYPTO)
+        features |= SHA_CPU_P8_CRYPTO;
+#endif
+
+    return features;
+}
+
+#else
+static unsigned int probe_features(void)
+{
+    return 0;
+}
+#endif
+
+/* The once flag goes from 0 to 1 when a thread claims the init and */
+/*  to 2 when the init is done. The store of 2 is a release and the  */
+/*  load is an acquire, so a thread that sees 2 also sees everything */
+/*  the init wrote.                                                  */
+#if defined(_MSC_VER)
+# include <intrin.h>
+static long once_load(long* p)
+{
+    return _InterlockedOr((volatile long*)p, 0);
+}
+static void once_store(long* p, long v)
+{
+    _InterlockedExchange((volatile long*)p, v);
+}
+static int once_claim(long* p)
+{
+    return _InterlockedCompareExchange((volatile long*)p, 1, 0) == 0;
+}
+#else
+static long once_load(long* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static void once_store(long* p, long v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+static int once_claim(long* p)
+{
+    long expected = 0;
+    return __atomic_compare_exchange_n(p, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+#endif
+
+void sha_once(sha_once_flag* once, void (*init)(void))
+{
+    if (once_load(&once->state) == 2)
+        return;
+
+    if (once_claim(&once->state))
+    {
+        init();
+        once_store(&once->state, 2);
+        return;
+    }
+
+    /* Another thread runs init. It probes the CPU and fills a table, */
+    /*  which takes microseconds, so wait for it in place.            */
+    while (once_load(&once->state) != 2)
+        ;
+}
+
+unsigned int sha_cpu_features(void)
+{
+    return sha_dispatch()->features;
+}
+
+/* Word order is the native layout of every kernel but SHA-NI */
+static void sha256_layout_copy(uint32_t dst[8], const uint32_t src[8])
+{
+    memcpy(dst, src, 32);
+}
+
+static sha_dispatch_table s_table;
+static sha_once_flag s_once = SHA_ONCE_INIT;
+
+static void resolve(void)
+{
+    sha_dispatch_table table;
+    const unsigned int features = probe_features();
+
+    table.sha1 = sha1_process;
+    table.sha1_name = "sha1_process";
+    table.sha256 = sha256_process;
+    table.sha256_name = "sha256_process";
+    table.sha512 = sha512_process;
+    table.sha512_name = "sha512_process";
+    table.sha256_64 = sha256_64;
+    table.sha256_64_name = "sha256_64";
+    table.sha256_words = sha256_process_words;
+    table.sha256_words_name = "sha256_process_words";
+    table.sha512_words = sha512_process_words;
+    table.sha512_words_name = "sha512_process_words";
+
+    table.sha256_native = NULL;
+    table.features = features;
+
+#if defined(SHA_DISPATCH_X86)
+    if (features & SHA_CPU_X86_BMI2)
+    {
+        table.sha256 = sha256_process_bmi2;
+        table.sha256_name = "sha256_process_bmi2";
+        table.sha256_words = sha256_process_words_bmi2;
+        table.sha256_words_name = "sha256_process_words_bmi2";
+    }
+    if (features & SHA_CPU_X86_SHA)
+    {
+        table.sha1 = sha1_process_x86;
+        table.sha1_name = "sha1_process_x86";
+        table.sha256 = sha256_process_x86;
+        table.sha256_name = "sha256_process_x86";
+        table.sha256_64 = sha256_64_x86;
+        table.sha256_64_name = "sha256_64_x86";
+        table.sha256_words = sha256_process_words_x86;
+        table.sha256_words_name = "sha256_process_words_x86";
+        table.sha256_native = sha256_process_native_x86;
+        table.sha256_native_name = "sha256_process_native_x86";
+        table.sha256_to_native = sha256_to_native_x86;
+        table.sha256_from_native = sha256_from_native_x86;
+    }
+    if ((features & SHA_CPU_X86_AVX2) && (features & SHA_CPU_X86_BMI2))
+    {
+        table.sha512 = sha512_process_avx2;
+        table.sha512_name = "sha512_process_avx2";
+        table.sha512_words = sha512_process_words_avx2;
+        table.sha512_words_name = "sha512_process_words_avx2";
+    }
+#elif defined(SHA_DISPATCH_ARM)
+    if (features & SHA_CPU_ARM_SHA1)
+    {
+        table.sha1 = sha1_process_arm;
+        table.sha1_name = "sha1_process_arm";
+    }
+    if (features & SHA_CPU_ARM_SHA2)
+    {
+        table.sha256 = sha256_process_arm;
+        table.sha256_name = "sha256_process_arm";
+        table.sha256_64 = sha256_64_arm;
+        table.sha256_64_name = "sha256_64_arm";
+        table.sha256_words = sha256_process_words_arm;
+        table.sha256_words_name = "sha256_process_words_arm";
+    }
+#elif defined(SHA_DISPATCH_P8)
+    if (features & SHA_CPU_P8_CRYPTO)
+    {
+        table.sha256 = sha256_process_p8;
+        table.sha256_name = "sha256_process_p8";
+        table.sha256_64 = sha256_64_p8;
+        table.sha256_64_name = "sha256_64_p8";
+        table.sha512 = sha512_process_p8;
+        table.sha512_name = "sha512_process_p8";
+    }
+#endif
+
+    /* The other kernels keep the state in word order */
+    if (table.sha256_native == NULL)
+    {
+        table.sha256_native = table.sha256;
+        table.sha256_native_name = table.sha256_name;
+        table.sha256_to_native = sha256_layout_copy;
+        table.sha256_from_native = sha256_layout_copy;
+    }
+
+    s_table = table;
+}
+
+const sha_dispatch_table* sha_dispatch(void)
+{
+    sha_once(&s_once, resolve);
+    return &s_table;
+}
+
+void sha1_process_dispatch(uint32_t state[5], const uint8_t data[], uint32_t length)
+{
+    sha_dispatch()->sha1(state, data, length);
+}
+
+void sha256_process_dispatch(uint32_t state[8], const uint8_t data[], uint32_t length)
+{
+    sha_dispatch()->sha256(state, data, length);
+}
+
+void sha512_process_dispatch(uint64_t state[8], const uint8_t data[], uint64_t length)
+{
+    sha_dispatch()->sha512(state, data, length);
+}
+
+void sha256_64_dispatch(uint8_t digest[32], const uint8_t data[64])
+{
+    sha_dispatch()->sha256_64(digest, data);
+}
+
+void sha256_process_words_dispatch(uint32_t state[8], const uint32_t data[], uint32_t length)
+{
+    sha_dispatch()->sha256_words(state, data, length);
+}
+
+void sha512_process_words_dispatch(uint64_t state[8], const uint64_t data[], uint64_t length)
+{
+    sha_dispatch()->sha512_words(state, data, length);
+}
+
+/* The padding block of a 64-byte message, as words */
+static const uint32_t PAD64_WORDS[16] = {
+    0x80000000, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0x00000200
+};
+
+void sha256_64_words_dispatch(uint32_t digest[8], const uint32_t data[16])
+{
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    const sha_dispatch_table* table = sha_dispatch();
+    table->sha256_words(state, data, 64);
+    table->sha256_words(state, PAD64_WORDS, 64);
+    memcpy(digest, state, 32);
+}
+
+/* Whole blocks per kernel call in the size_t entry points */
+#if !defined(SHA_DISPATCH_CHUNK)
+# define SHA_DISPATCH_CHUNK ((size_t)1 << 30)
+#endif
+
+void sha1_process_blocks_dispatch(uint32_t state[5], const uint8_t data[], size_t length)
+{
+    while (length > SHA_DISPATCH_CHUNK)
+    {
+        sha_dispatch()->sha1(state, data, (uint32_t)SHA_DISPATCH_CHUNK);
+        data += SHA_DISPATCH_CHUNK;
+        length -= SHA_DISPATCH_CHUNK;
+    }
+    sha_dispatch()->sha1(state, data, (uint32_t)length);
+}
+
+void sha256_process_blocks_dispatch(uint32_t state[8], const uint8_t data[], size_t length)
+{
+    while (length > SHA_DISPATCH_CHUNK)
+    {
+        sha_dispatch()->sha256(state, data, (uint32_t)SHA_DISPATCH_CHUNK);
+        data += SHA_DISPATCH_CHUNK;
+        length -= SHA_DISPATCH_CHUNK;
+    }
+    sha_dispatch()->sha256(state, data, (uint32_t)length);
+}
+
+void sha512_process_blocks_dispatch(uint64_t state[8], const uint8_t data[], size_t length)
+{
+    sha_dispatch()->sha512(state, data, (uint64_t)length);
+}
+
+void sha256_process_native_dispatch(uint32_t native[8], const uint8_t data[], uint32_t length)
+{
+    sha_dispatch()->sha256_native(native, data, length);
+}
+
+void sha256_process_native_blocks_dispatch(uint32_t native[8], const uint8_t data[], size_t length)
+{
+    while (length > SHA_DISPATCH_CHUNK)
+    {
+        sha_dispatch()->sha256_native(native, data, (uint32_t)SHA_DISPATCH_CHUNK);
+        data += SHA_DISPATCH_CHUNK;
+        length -= SHA_DISPATCH_CHUNK;
+    }
+    sha_dispatch()->sha256_native(native, data, (uint32_t)length);
+}
+
+void sha256_to_native_dispatch(uint32_t native[8], const uint32_t state[8])
+{
+    sha_dispatch()->sha256_to_native(native, state);
+}
+
+void sha256_from_native_dispatch(uint32_t state[8], const uint32_t native[8])
+{
+    sha_dispatch()->sha256_from_native(state, native);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    const sha_dispatch_table* table = sha_dispatch();
+    int success = 1;
+
+    printf("CPU features: 0x%02X\n", table->features);
+    printf("SHA1 kernel: %s\n", table->sha1_name);
+    printf("SHA256 kernel: %s\n", table->sha256_name);
+    printf("SHA512 kernel: %s\n", table->sha512_name);
+    printf("SHA256 64-byte kernel: %s\n", table->sha256_64_name);
+    printf("SHA256 words kernel: %s\n", table->sha256_words_name);
+    printf("SHA512 words kernel: %s\n", table->sha512_words_name);
+    printf("SHA256 native kernel: %s\n", table->sha256_native_name);
+
+    /* empty message with padding */
+    uint8_t message[128];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    {
+        uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        sha1_process_dispatch(state, message, 64);
+
+        /* DA39A3EE5E6B4B0D... */
+        printf("SHA1 hash of empty message: %08X%08X...\n", state[0], state[1]);
+        success &= (state[0] == 0xDA39A3EE && state[1] == 0x5E6B4B0D);
+    }
+
+    {
+        uint32_t state[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        sha256_process_dispatch(state, message, 64);
+
+        /* e3b0c44298fc1c14... */
+        printf("SHA256 hash of empty message: %08X%08X...\n", state[0], state[1]);
+        success &= (state[0] == 0xE3B0C442 && state[1] == 0x98FC1C14);
+
+        /* The same block in native layout */
+        uint32_t native[8], state2[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        sha256_to_native_dispatch(native, state2);
+        sha256_process_native_dispatch(native, message, 64);
+        sha256_from_native_dispatch(state2, native);
+        success &= (memcmp(state, state2, sizeof(state)) == 0);
+    }
+
+    {
+        uint64_t state[8] = {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+            0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+            0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+        sha512_process_dispatch(state, message, 128);
+
+        /* cf83e1357eefb8bd... */
+        printf("SHA512 hash of empty message: %08X%08X...\n",
+            (uint32_t)(state[0] >> 32), (uint32_t)(state[0]));
+        success &= (state[0] == 0xcf83e1357eefb8bdULL);
+    }
+
+    {
+        uint8_t digest[32];
+        memset(message, 0x00, 64);
+        sha256_64_dispatch(digest, message);
+
+        /* f5a5fd42d16a2030... */
+        printf("SHA256 hash of 64 zero bytes: %02X%02X%02X%02X...\n",
+            digest[0], digest[1], digest[2], digest[3]);
+        success &= (digest[0] == 0xF5 && digest[1] == 0xA5 && digest[2] == 0xFD && digest[3] == 0x42);
+
+        /* The same node in word form */
+        uint32_t words[16], digest_words[8];
+        memset(words, 0x00, sizeof(words));
+        sha256_64_words_dispatch(digest_words, words);
+        success &= (digest_words[0] == 0xF5A5FD42 && digest_words[1] == 0xD16A2030);
+    }
+
+    {
+        uint64_t words[16], state[8] = {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+            0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+            0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+        memset(words, 0x00, sizeof(words));
+        words[0] = 0x8000000000000000ULL;
+        sha512_process_words_dispatch(state, words, 128);
+        success &= (state[0] == 0xcf83e1357eefb8bdULL);
+    }
+
+    {
+        /* The size_t entry points agree with the kernels */
+        uint8_t blocks[640];
+        uint32_t s1[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        uint32_t r1[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        uint32_t s256[8] = {0}, r256[8] = {0};
+        uint64_t s512[8] = {0}, r512[8] = {0};
+        uint32_t n256[8], m256[8];
+        unsigned int i;
+        for (i = 0; i < sizeof(blocks); ++i)
+            blocks[i] = (uint8_t)(i * 7 + 3);
+
+        sha1_process_blocks_dispatch(s1, blocks, sizeof(blocks));
+        sha1_process_dispatch(r1, blocks, sizeof(blocks));
+        sha256_process_blocks_dispatch(s256, blocks, sizeof(blocks));
+        sha256_process_dispatch(r256, blocks, sizeof(blocks));
+        sha512_process_blocks_dispatch(s512, blocks, sizeof(blocks));
+        sha512_process_dispatch(r512, blocks, sizeof(blocks));
+        sha256_to_native_dispatch(n256, r256);
+        memcpy(m256, n256, sizeof(m256));
+        sha256_process_native_blocks_dispatch(n256, blocks, sizeof(blocks));
+        sha256_process_native_dispatch(m256, blocks, sizeof(blocks));
+        success &= (memcmp(n256, m256, sizeof(m256)) == 0);
+        success &= (memcmp(s1, r1, sizeof(r1)) == 0);
+        success &= (memcmp(s256, r256, sizeof(r256)) == 0);
+        success &= (memcmp(s512, r512, sizeof(r512)) == 0);
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
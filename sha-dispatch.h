@@ -0,0 +1,170 @@
+/* sha-dispatch.h - Runtime selection of SHA compress functions */
+/*   Written and placed in public domain                       */
+
+/* The dispatcher probes the CPU once and binds the fastest compress    */
+/* function available on the host. Each ISA source file is compiled    */
+/* with its own flags, like -msha or -march=armv8-a+crypto, and the    */
+/* dispatcher itself is compiled without them. After the first call    */
+/* a dispatched call costs one acquire load and one indirect branch.   */
+/* There is no cpuid or getauxval on the hot path.                     */
+
+#ifndef SHA_DISPATCH_H
+#define SHA_DISPATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Platform with ISA files. SHA_DISPATCH_PORTABLE builds only the C files. */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# define SHA_DISPATCH_X86 1
+#elif defined(__aarch64__) || defined(__arm64__) || defined(_M_ARM64) || defined(__arm__)
+# define SHA_DISPATCH_ARM 1
+#elif defined(__powerpc64__) || defined(__PPC64__) || defined(_ARCH_PPC64)
+# define SHA_DISPATCH_P8 1
+#endif
+
+#if defined(SHA_DISPATCH_PORTABLE)
+# undef SHA_DISPATCH_X86
+# undef SHA_DISPATCH_ARM
+# undef SHA_DISPATCH_P8
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Compress function signatures. The caller is responsible for setting */
+/*  the initial state, and the caller is responsible for padding.      */
+typedef void (*sha1_process_fn)(uint32_t state[5], const uint8_t data[], uint32_t length);
+typedef void (*sha256_process_fn)(uint32_t state[8], const uint8_t data[], uint32_t length);
+typedef void (*sha512_process_fn)(uint64_t state[8], const uint8_t data[], uint64_t length);
+
+/* SHA-256 of exactly 64 bytes, like two child digests */
+typedef void (*sha256_64_fn)(uint8_t digest[32], const uint8_t data[64]);
+
+/* Compress functions over host-order message words. length is in bytes. */
+/*  A digest kept as state words feeds the next hash without byte swaps. */
+typedef void (*sha256_words_fn)(uint32_t state[8], const uint32_t data[], uint32_t length);
+typedef void (*sha512_words_fn)(uint64_t state[8], const uint64_t data[], uint64_t length);
+
+/* Compress on the state in the kernel's register layout, ABEF and CDGH */
+/*  with SHA-NI and word order elsewhere. The layout functions convert   */
+/*  between word order and the layout of the bound kernel.               */
+typedef void (*sha256_native_fn)(uint32_t native[8], const uint8_t data[], uint32_t length);
+typedef void (*sha256_layout_fn)(uint32_t dst[8], const uint32_t src[8]);
+
+/* CPU features reported by sha_cpu_features() */
+enum {
+    SHA_CPU_X86_SHA    = 1 << 0,  /* SSSE3, SSE4.1 and SHA extensions */
+    SHA_CPU_ARM_SHA1   = 1 << 1,  /* ARMv8 SHA1 */
+    SHA_CPU_ARM_SHA2   = 1 << 2,  /* ARMv8 SHA256 */
+    SHA_CPU_ARM_SHA512 = 1 << 3,  /* ARMv8.2 SHA512 */
+    SHA_CPU_P8_CRYPTO  = 1 << 4,  /* Power8 in-core crypto */
+    SHA_CPU_X86_AVX2   = 1 << 5,  /* AVX2 with OS support for YMM state */
+    SHA_CPU_X86_AVX512 = 1 << 6,  /* AVX-512F and BW with OS support for ZMM state */
+    SHA_CPU_X86_BMI2   = 1 << 7   /* BMI2, for rorx */
+};
+
+typedef struct sha_dispatch_table
+{
+    sha1_process_fn   sha1;
+    sha256_process_fn sha256;
+    sha512_process_fn sha512;
+    sha256_64_fn      sha256_64;
+    sha256_words_fn   sha256_words;
+    sha512_words_fn   sha512_words;
+    sha256_native_fn  sha256_native;
+    sha256_layout_fn  sha256_to_native;
+    sha256_layout_fn  sha256_from_native;
+
+    const char* sha1_name;
+    const char* sha256_name;
+    const char* sha512_name;
+    const char* sha256_64_name;
+    const char* sha256_words_name;
+    const char* sha512_words_name;
+    const char* sha256_native_name;
+
+    unsigned int features;
+} sha_dispatch_table;
+
+/* Run init exactly once. Threads that arrive while init runs wait */
+/*  for it, and every caller returns after init's writes are       */
+/*  visible. Modules with their own kernels bind them with this.   */
+typedef struct sha_once_flag
+{
+    long state;
+} sha_once_flag;
+
+#define SHA_ONCE_INIT { 0 }
+
+void sha_once(sha_once_flag* once, void (*init)(void));
+
+/* Probe the CPU. The result is cached after the first call. */
+unsigned int sha_cpu_features(void);
+
+/* Resolved table of compress functions. The table is built once, */
+/*  on first use from any thread.                                 */
+const sha_dispatch_table* sha_dispatch(void);
+
+/* Dispatched compress functions */
+void sha1_process_dispatch(uint32_t state[5], const uint8_t data[], uint32_t length);
+void sha256_process_dispatch(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha512_process_dispatch(uint64_t state[8], const uint8_t data[], uint64_t length);
+void sha256_64_dispatch(uint8_t digest[32], const uint8_t data[64]);
+void sha256_process_words_dispatch(uint32_t state[8], const uint32_t data[], uint32_t length);
+void sha512_process_words_dispatch(uint64_t state[8], const uint64_t data[], uint64_t length);
+
+/* SHA-256 of 16 message words, like two child digests in word form. */
+/*  The digest is left in word form for the next level.              */
+void sha256_64_words_dispatch(uint32_t digest[8], const uint32_t data[16]);
+
+/* Dispatched compress functions with a size_t length, for buffers  */
+/*  of 4 GiB and more. The kernel gets at most 1 GiB per call.       */
+void sha1_process_blocks_dispatch(uint32_t state[5], const uint8_t data[], size_t length);
+void sha256_process_blocks_dispatch(uint32_t state[8], const uint8_t data[], size_t length);
+void sha512_process_blocks_dispatch(uint64_t state[8], const uint8_t data[], size_t length);
+
+/* Dispatched native layout functions. The three are bound together. */
+void sha256_process_native_dispatch(uint32_t native[8], const uint8_t data[], uint32_t length);
+void sha256_to_native_dispatch(uint32_t native[8], const uint32_t state[8]);
+void sha256_from_native_dispatch(uint32_t state[8], const uint32_t native[8]);
+void sha256_process_native_blocks_dispatch(uint32_t native[8], const uint8_t data[], size_t length);
+
+/* Compress functions provided by the ISA source files */
+void sha1_process(uint32_t state[5], const uint8_t data[], uint32_t length);
+void sha256_process(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha512_process(uint64_t state[8], const uint8_t data[], uint64_t length);
+void sha1_process_x86(uint32_t state[5], const uint8_t data[], uint32_t length);
+void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha512_process_avx2(uint64_t state[8], const uint8_t data[], uint64_t length);
+void sha256_process_bmi2(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha1_process_x86_x2(uint32_t state1[5], uint32_t state2[5],
+                         const uint8_t data1[], const uint8_t data2[], uint32_t length);
+void sha256_process_x86_x2(uint32_t state1[8], uint32_t state2[8],
+                           const uint8_t data1[], const uint8_t data2[], uint32_t length);
+void sha1_process_arm(uint32_t state[5], const uint8_t data[], uint32_t length);
+void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha256_process_p8(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha512_process_p8(uint64_t state[8], const uint8_t data[], uint64_t length);
+void sha256_process_generic(uint32_t state[8], const uint8_t data[], uint32_t length);
+void sha512_process_generic(uint64_t state[8], const uint8_t data[], uint64_t length);
+void sha256_64(uint8_t digest[32], const uint8_t data[64]);
+void sha256_64_x86(uint8_t digest[32], const uint8_t data[64]);
+void sha256_64_arm(uint8_t digest[32], const uint8_t data[64]);
+void sha256_64_p8(uint8_t digest[32], const uint8_t data[64]);
+void sha256_process_words(uint32_t state[8], const uint32_t data[], uint32_t length);
+void sha512_process_words(uint64_t state[8], const uint64_t data[], uint64_t length);
+void sha256_process_words_x86(uint32_t state[8], const uint32_t data[], uint32_t length);
+void sha256_process_words_bmi2(uint32_t state[8], const uint32_t data[], uint32_t length);
+void sha512_process_words_avx2(uint64_t state[8], const uint64_t data[], uint64_t length);
+void sha256_process_words_arm(uint32_t state[8], const uint32_t data[], uint32_t length);
+void sha256_process_native_x86(uint32_t native[8], const uint8_t data[], uint32_t length);
+void sha256_to_native_x86(uint32_t native[8], const uint32_t state[8]);
+void sha256_from_native_x86(uint32_t state[8], const uint32_t native[8]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_DISPATCH_H */
@@ -0,0 +1,572 @@
+/* sha-file.c - Hash large files through memory-mapped windows */
+/*   Written and placed in public domain                      */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -DTEST_MAIN sha-file.c sha-ctx.o sha-dispatch.o <ISA objects> \ */
+/*     -o sha-file.exe                                                  */
+
+/* sha-file.exe with a file argument hashes the file with SHA-256 and */
+/* prints the digest and the throughput.                              */
+
+#if defined(__unix__) || defined(__APPLE__)
+# if !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE 1
+# endif
+# define SHA_FILE_MMAP 1
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha-file.h"
+#include "sha-ctx.h"
+
+#if defined(SHA_FILE_MMAP) && !defined(MAP_ANONYMOUS)
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+typedef union hash_ctx
+{
+    sha1_ctx sha1;
+    sha256_ctx sha256;
+    sha512_ctx sha512;
+} hash_ctx;
+
+static int hash_init(hash_ctx* ctx, int algorithm)
+{
+    switch (algorithm)
+    {
+    case SHA_FILE_SHA1:
+        sha1_init(&ctx->sha1);
+        return 0;
+    case SHA_FILE_SHA256:
+        sha256_init(&ctx->sha256);
+        return 0;
+    case SHA_FILE_SHA512:
+        sha512_init(&ctx->sha512);
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+static void hash_update(hash_ctx* ctx, int algorithm, const void* data, size_t length)
+{
+    if (algorithm == SHA_FILE_SHA1)
+        sha1_update(&ctx->sha1, data, length);
+    else if (algorithm == SHA_FILE_SHA256)
+        sha256_update(&ctx->sha256, data, length);
+    else
+        sha512_update(&ctx->sha512, data, length);
+}
+
+static void hash_final(hash_ctx* ctx, int algorithm, uint8_t* digest)
+{
+    if (algorithm == SHA_FILE_SHA1)
+        sha1_final(&ctx->sha1, digest);
+    else if (algorithm == SHA_FILE_SHA256)
+        sha256_final(&ctx->sha256, digest);
+    else
+        sha512_final(&ctx->sha512, digest);
+}
+
+static double now_seconds(void)
+{
+#if defined(SHA_FILE_MMAP)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Update the timing fields and call the progress callback */
+static int report(const sha_file_params* params, sha_file_progress* progress, double start)
+{
+    progress->seconds = now_seconds() - start;
+    progress->bytes_per_sec = (progress->seconds > 0) ? (double)progress->done / progress->seconds : 0;
+
+    if (params->progress && params->progress(progress, params->user))
+    {
+        errno = ECANCELED;
+        return -1;
+    }
+    return 0;
+}
+
+void sha_file_defaults(sha_file_params* params)
+{
+    memset(params, 0x00, sizeof(*params));
+    params->window = (size_t)64 << 20;
+    params->populate = 1;
+    params->sequential = 1;
+    params->readahead = 1;
+}
+
+#if defined(SHA_FILE_MMAP)
+
+/* Map length bytes of the file at offset. With align above the page   */
+/*  size, the window is placed at an aligned address so the kernel can  */
+/*  back it with huge pages: reserve align bytes of slack, map the file */
+/*  over the aligned part and release the rest.                         */
+static void* map_window(int fd, uint64_t offset, size_t length, int flags, size_t page, size_t align)
+{
+    if (align <= page)
+        return mmap(NULL, length, PROT_READ, flags, fd, (off_t)offset);
+
+    const size_t span = (length + page - 1) & ~(page - 1);
+    const size_t reserve = span + align;
+    uint8_t* area = (uint8_t*)mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == (uint8_t*)MAP_FAILED)
+        return MAP_FAILED;
+
+    uint8_t* aligned = (uint8_t*)(((uintptr_t)area + align - 1) & ~(uintptr_t)(align - 1));
+    void* map = mmap(aligned, length, PROT_READ, flags | MAP_FIXED, fd, (off_t)offset);
+    if (map == MAP_FAILED)
+    {
+        const int saved = errno;
+        munmap(area, reserve);
+        errno = saved;
+        return MAP_FAILED;
+    }
+
+    if (aligned > area)
+        munmap(area, (size_t)(aligned - area));
+    if (aligned + span < area + reserve)
+        munmap(aligned + span, (size_t)(area + reserve - (aligned + span)));
+
+    return map;
+}
+
+/* hash_mapped returns this when a window cannot be mapped. The   */
+/*  caller reads the rest of the file from progress->done instead. */
+#define HASH_UNMAPPED 1
+
+static int hash_mapped(int fd, uint64_t size, int algorithm, const sha_file_params* params,
+                       hash_ctx* ctx, sha_file_progress* progress, double start)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t align = params->huge_pages ? HUGE_PAGE_SIZE : page;
+
+    /* The window is a multiple of the alignment, and so of the */
+    /*  block size. Every window but the last is whole blocks.  */
+    size_t window = (params->window + align - 1) & ~(align - 1);
+    if (window == 0)
+        window = align;
+
+    int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (params->populate)
+        flags |= MAP_POPULATE;
+#endif
+
+    uint64_t offset;
+    for (offset = 0; offset < size; offset += window)
+    {
+        const size_t length = (size - offset < window) ? (size_t)(size - offset) : window;
+
+        void* map = map_window(fd, offset, length, flags, page, align);
+        if (map == MAP_FAILED)
+            return HASH_UNMAPPED;
+
+#if defined(MADV_HUGEPAGE)
+        if (params->huge_pages)
+            madvise(map, length, MADV_HUGEPAGE);
+#endif
+        if (params->sequential)
+            madvise(map, length, MADV_SEQUENTIAL);
+
+#if defined(POSIX_FADV_WILLNEED)
+        /* Start reading the next window while this one is hashed */
+        if (params->readahead && offset + length < size)
+            posix_fadvise(fd, (off_t)(offset + length), (off_t)window, POSIX_FADV_WILLNEED);
+#endif
+
+        hash_update(ctx, algorithm, map, length);
+        munmap(map, length);
+
+        progress->done += length;
+        if (report(params, progress, start) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* Pipes, sockets and other files that cannot be mapped. With   */
+/*  positioned set the file is read with pread from offset, so   */
+/*  the descriptor's own offset does not matter.                 */
+static int hash_stream(int fd, int algorithm, const sha_file_params* params,
+                       hash_ctx* ctx, sha_file_progress* progress, double start,
+                       uint64_t offset, int positioned)
+{
+    const size_t size = params->window ? params->window : ((size_t)1 << 20);
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    if (!buffer)
+        return -1;
+
+    for (;;)
+    {
+        const ssize_t n = positioned ? pread(fd, buffer, size, (off_t)offset) : read(fd, buffer, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buffer);
+            return -1;
+        }
+        if (n == 0)
+            break;
+
+        hash_update(ctx, algorithm, buffer, (size_t)n);
+        offset += (uint64_t)n;
+        progress->done += (uint64_t)n;
+        if (report(params, progress, start) != 0)
+        {
+            free(buffer);
+            return -1;
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
+
+int sha_file_hash_fd(int fd, int algorithm, const sha_file_params* params,
+                     uint8_t* digest, sha_file_progress* stats)
+{
+    sha_file_params defaults;
+    sha_file_progress progress;
+    hash_ctx ctx;
+    struct stat st;
+    int result;
+
+    if (!params)
+    {
+        sha_file_defaults(&defaults);
+        params = &defaults;
+    }
+
+    if (!digest || hash_init(&ctx, algorithm) != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0)
+        return -1;
+
+    memset(&progress, 0x00, sizeof(progress));
+    const double start = now_seconds();
+
+    /* Procfs and sysfs files are regular but report a size of 0, */
+    /*  so only a nonzero size is mapped. A window that cannot be  */
+    /*  mapped continues with pread from where the mapping ended.  */
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        progress.total = (uint64_t)st.st_size;
+        result = hash_mapped(fd, progress.total, algorithm, params, &ctx, &progress, start);
+        if (result == HASH_UNMAPPED)
+        {
+            result = hash_stream(fd, algorithm, params, &ctx, &progress, start, progress.done, 1);
+            progress.total = progress.done;
+        }
+    }
+    else
+    {
+        result = hash_stream(fd, algorithm, params, &ctx, &progress, start, 0, S_ISREG(st.st_mode));
+        progress.total = progress.done;
+    }
+
+    if (result != 0)
+        return -1;
+
+    hash_final(&ctx, algorithm, digest);
+
+    progress.seconds = now_seconds() - start;
+    progress.bytes_per_sec = (progress.seconds > 0) ? (double)progress.done / progress.seconds : 0;
+    if (stats)
+        *stats = progress;
+
+    return 0;
+}
+
+int sha_file_hash(const char* path, int algorithm, const sha_file_params* params,
+                  uint8_t* digest, sha_file_progress* stats)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    const int result = sha_file_hash_fd(fd, algorithm, params, digest, stats);
+    const int saved = errno;
+    close(fd);
+    errno = saved;
+
+    return result;
+}
+
+#else  /* SHA_FILE_MMAP */
+
+/* No mmap. Read the file through stdio one window at a time. */
+int sha_file_hash(const char* path, int algorithm, const sha_file_params* params,
+                  uint8_t* digest, sha_file_progress* stats)
+{
+    sha_file_params defaults;
+    sha_file_progress progress;
+    hash_ctx ctx;
+    size_t n;
+
+    if (!params)
+    {
+        sha_file_defaults(&defaults);
+        params = &defaults;
+    }
+
+    if (!digest || hash_init(&ctx, algorithm) != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return -1;
+
+    const size_t size = params->window ? params->window : ((size_t)1 << 20);
+    uint8_t* buffer = (uint8_t*)malloc(size);
+    if (!buffer)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    memset(&progress, 0x00, sizeof(progress));
+    const double start = now_seconds();
+    int result = 0;
+
+    while ((n = fread(buffer, 1, size, file)) > 0)
+    {
+        hash_update(&ctx, algorithm, buffer, n);
+        progress.done += n;
+        if (report(params, &progress, start) != 0)
+        {
+            result = -1;
+            break;
+        }
+    }
+
+    if (result == 0 && ferror(file))
+    {
+        errno = EIO;
+        result = -1;
+    }
+
+    free(buffer);
+    fclose(file);
+    if (result != 0)
+        return -1;
+
+    hash_final(&ctx, algorithm, digest);
+    progress.total = progress.done;
+    if (stats)
+        *stats = progress;
+
+    return 0;
+}
+
+int sha_file_hash_fd(int fd, int algorithm, const sha_file_params* params,
+                     uint8_t* digest, sha_file_progress* stats)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif  /* SHA_FILE_MMAP */
+
+#if defined(TEST_MAIN)
+
+static int cancel_after_first(const sha_file_progress* progress, void* user)
+{
+    (void)progress;
+    return ++*(int*)user > 1;
+}
+
+static int hash_file(const char* path)
+{
+    sha_file_params params;
+    sha_file_progress stats;
+    uint8_t digest[32];
+    unsigned int i;
+
+    sha_file_defaults(&params);
+    if (sha_file_hash(path, SHA_FILE_SHA256, &params, digest, &stats) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+
+    for (i = 0; i < 32; ++i)
+        printf("%02x", digest[i]);
+    printf("  %s\n", path);
+    printf("%llu bytes in %.3f s, %.2f GB/s\n", (unsigned long long)stats.done,
+        stats.seconds, stats.bytes_per_sec / 1e9);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    static const size_t digest_size[3] = { 20, 32, 64 };
+    const size_t size = ((size_t)5 << 20) + 77;
+    char path[] = "/tmp/sha-file-XXXXXX";
+    uint8_t digest[64], ref[64];
+    sha_file_params params;
+    sha_file_progress stats;
+    unsigned int i, mode;
+    int alg, calls;
+    int success = 1;
+
+    if (argc > 1)
+        return hash_file(argv[1]);
+
+    uint8_t* data = (uint8_t*)malloc(size);
+    for (i = 0; i < size; ++i)
+        data[i] = (uint8_t)((i * 2654435761u) >> 24);
+
+#if defined(SHA_FILE_MMAP)
+    const int fd = mkstemp(path);
+    if (fd < 0 || write(fd, data, size) != (ssize_t)size)
+    {
+        perror(path);
+        return 1;
+    }
+    close(fd);
+#else
+    tmpnam(path);
+    FILE* file = fopen(path, "wb");
+    if (!file || fwrite(data, 1, size, file) != size)
+    {
+        perror(path);
+        return 1;
+    }
+    fclose(file);
+#endif
+
+    for (alg = SHA_FILE_SHA1; alg <= SHA_FILE_SHA512; ++alg)
+    {
+        hash_ctx ctx;
+        hash_init(&ctx, alg);
+        hash_update(&ctx, alg, data, size);
+        hash_final(&ctx, alg, ref);
+
+        /* Defaults, small windows, odd windows, no populate, huge pages */
+        for (mode = 0; mode < 5; ++mode)
+        {
+            sha_file_defaults(&params);
+            if (mode == 1)
+                params.window = (size_t)1 << 20;
+            if (mode == 2)
+                params.window = 100000;
+            if (mode == 3)
+            {
+                params.window = (size_t)1 << 20;
+                params.populate = 0;
+                params.sequential = 0;
+                params.readahead = 0;
+            }
+            if (mode == 4)
+            {
+                params.window = (size_t)3 << 20;
+                params.huge_pages = 1;
+            }
+
+            memset(digest, 0x00, sizeof(digest));
+            success &= (sha_file_hash(path, alg, mode ? &params : NULL, digest, &stats) == 0);
+            success &= (memcmp(digest, ref, digest_size[alg]) == 0);
+            success &= (stats.done == size && stats.total == size);
+        }
+    }
+    printf("File hashes: %s\n", success ? "passed" : "failed");
+
+    /* A progress callback that cancels after the first window */
+    sha_file_defaults(&params);
+    params.window = (size_t)1 << 20;
+    params.progress = cancel_after_first;
+    params.user = &calls;
+    calls = 0;
+    success &= (sha_file_hash(path, SHA_FILE_SHA256, &params, digest, &stats) == -1);
+    success &= (errno == ECANCELED && calls == 2);
+    printf("Cancel: %s\n", success ? "passed" : "failed");
+
+    /* Bad algorithm and missing file */
+    success &= (sha_file_hash(path, 7, NULL, digest, NULL) == -1 && errno == EINVAL);
+    success &= (sha_file_hash("/nonexistent/sha-file", SHA_FILE_SHA256, NULL, digest, NULL) == -1);
+
+#if defined(SHA_FILE_MMAP)
+    /* An empty file, e3b0c44298fc1c14... */
+    const int empty = open(path, O_RDWR | O_TRUNC);
+    success &= (empty >= 0 && sha_file_hash_fd(empty, SHA_FILE_SHA256, NULL, digest, &stats) == 0);
+    success &= (digest[0] == 0xE3 && digest[1] == 0xB0 && stats.done == 0);
+    close(empty);
+
+    /* A pipe cannot be mapped and is read instead */
+    int fds[2];
+    if (pipe(fds) == 0)
+    {
+        const size_t part = 50000;
+        if (write(fds[1], data, part) == (ssize_t)part)
+        {
+            close(fds[1]);
+            hash_ctx ctx;
+            hash_init(&ctx, SHA_FILE_SHA256);
+            hash_update(&ctx, SHA_FILE_SHA256, data, part);
+            hash_final(&ctx, SHA_FILE_SHA256, ref);
+            success &= (sha_file_hash_fd(fds[0], SHA_FILE_SHA256, NULL, digest, &stats) == 0);
+            success &= (memcmp(digest, ref, 32) == 0 && stats.done == part);
+        }
+        close(fds[0]);
+    }
+    printf("Empty file and pipe: %s\n", success ? "passed" : "failed");
+#endif
+
+#if defined(__linux__)
+    /* Procfs reports a size of 0 for a file with content */
+    FILE* proc = fopen("/proc/self/cmdline", "rb");
+    if (proc)
+    {
+        uint8_t text[4096];
+        const size_t n = fread(text, 1, sizeof(text), proc);
+        fclose(proc);
+
+        hash_ctx ctx;
+        hash_init(&ctx, SHA_FILE_SHA256);
+        hash_update(&ctx, SHA_FILE_SHA256, text, n);
+        hash_final(&ctx, SHA_FILE_SHA256, ref);
+        success &= (n > 0 && sha_file_hash("/proc/self/cmdline", SHA_FILE_SHA256, NULL, digest, &stats) == 0);
+        success &= (memcmp(digest, ref, 32) == 0 && stats.done == n);
+        printf("Procfs file: %s\n", success ? "passed" : "failed");
+    }
+#endif
+
+    remove(path);
+    free(data);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,74 @@
+/* sha-file.h - Hash large files through memory-mapped windows */
+/*   Written and placed in public domain                      */
+
+/* The file is mapped one window at a time and each window goes   */
+/* to the compress function in place. Windows are a multiple of   */
+/* the block size, so only the final partial block is ever copied. */
+/* The kernel reads ahead with MADV_SEQUENTIAL, and the next       */
+/* window is requested with POSIX_FADV_WILLNEED while the current  */
+/* one is hashed. There is one mmap and one munmap per window, so  */
+/* a large window keeps syscall overhead well below memory         */
+/* bandwidth.                                                      */
+
+#ifndef SHA_FILE_H
+#define SHA_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Hash selection for sha_file_hash */
+enum {
+    SHA_FILE_SHA1 = 0,
+    SHA_FILE_SHA256,
+    SHA_FILE_SHA512
+};
+
+typedef struct sha_file_progress
+{
+    uint64_t done;          /* bytes hashed so far */
+    uint64_t total;         /* size of the file */
+    double seconds;         /* wall time since the start */
+    double bytes_per_sec;   /* done / seconds */
+} sha_file_progress;
+
+/* Return 0 to continue or nonzero to cancel the hash */
+typedef int (*sha_file_progress_fn)(const sha_file_progress* progress, void* user);
+
+typedef struct sha_file_params
+{
+    size_t window;          /* bytes mapped at a time, rounded up to the page or huge page size */
+    int populate;           /* MAP_POPULATE each window */
+    int sequential;         /* MADV_SEQUENTIAL each window */
+    int readahead;          /* POSIX_FADV_WILLNEED the next window */
+    int huge_pages;         /* 2 MiB aligned windows with MADV_HUGEPAGE */
+
+    sha_file_progress_fn progress;  /* called after each window, may be NULL */
+    void* user;                     /* caller's cookie for progress */
+} sha_file_params;
+
+/* 64 MiB windows, MAP_POPULATE, MADV_SEQUENTIAL, readahead, */
+/*  no huge pages and no progress callback                   */
+void sha_file_defaults(sha_file_params* params);
+
+/* Hash the file at path into digest, which holds 20, 32 or 64     */
+/*  bytes for the algorithm. params may be NULL for the defaults.  */
+/*  If stats is not NULL it receives the final progress. Returns 0  */
+/*  on success and -1 on an I/O error, a bad argument or a cancel.  */
+/*  errno tells which.                                              */
+int sha_file_hash(const char* path, int algorithm, const sha_file_params* params,
+                  uint8_t* digest, sha_file_progress* stats);
+
+/* Same, for an open file descriptor. The whole file is hashed, */
+/*  regardless of the descriptor's offset.                      */
+int sha_file_hash_fd(int fd, int algorithm, const sha_file_params* params,
+                     uint8_t* digest, sha_file_progress* stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_FILE_H */
@@ -0,0 +1,313 @@
+/* sha-hmac.c - HMAC-SHA256 and HMAC-SHA512 with cached midstates */
+/*   Written and placed in public domain                          */
+
+/* The inner hash continues from the ipad midstate through the      */
+/* streaming context, with the key block already counted in its     */
+/* length. The outer hash is always a single block: the inner       */
+/* digest, the padding and a fixed length, compressed from the opad */
+/* midstate.                                                        */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -DTEST_MAIN sha-hmac.c sha-ctx.o sha-dispatch.o <ISA objects> \ */
+/*     -o sha-hmac.exe                                                 */
+
+#include <string.h>
+
+#include "sha-hmac.h"
+#include "sha-dispatch.h"
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v >>  0);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v)
+{
+    store_be32(p+0, (uint32_t)(v >> 32));
+    store_be32(p+4, (uint32_t)(v >>  0));
+}
+
+static int equal_ct(const uint8_t* a, const uint8_t* b, size_t length)
+{
+    volatile uint8_t diff = 0;
+    size_t i;
+    for (i = 0; i < length; ++i)
+        diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+/*********************** HMAC-SHA256 ***********************/
+
+void hmac_sha256_key_init(hmac_sha256_key* key, const uint8_t* k, size_t length)
+{
+    uint8_t block[64];
+    sha256_ctx ctx;
+    unsigned int i;
+
+    memset(block, 0x00, sizeof(block));
+    if (length > 64)
+    {
+        sha256_init(&ctx);
+        sha256_update(&ctx, k, length);
+        sha256_final(&ctx, block);
+    }
+    else if (length)
+        memcpy(block, k, length);
+
+    for (i = 0; i < 64; ++i)
+        block[i] ^= 0x36;
+    sha256_init(&ctx);
+    sha256_process_dispatch(ctx.state, block, 64);
+    memcpy(key->inner, ctx.state, sizeof(key->inner));
+
+    /* 0x36 ^ 0x5c turns the ipad block into the opad block */
+    for (i = 0; i < 64; ++i)
+        block[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&ctx);
+    sha256_process_dispatch(ctx.state, block, 64);
+    memcpy(key->outer, ctx.state, sizeof(key->outer));
+
+    memset(block, 0x00, sizeof(block));
+    memset(&ctx, 0x00, sizeof(ctx));
+}
+
+void hmac_sha256_init(hmac_sha256_ctx* ctx, const hmac_sha256_key* key)
+{
+    memcpy(ctx->inner.state, key->inner, sizeof(key->inner));
+    memcpy(ctx->outer, key->outer, sizeof(key->outer));
+    ctx->inner.length = 64;
+}
+
+void hmac_sha256_update(hmac_sha256_ctx* ctx, const void* data, size_t length)
+{
+    sha256_update(&ctx->inner, data, length);
+}
+
+void hmac_sha256_final(hmac_sha256_ctx* ctx, uint8_t mac[32])
+{
+    union { uint64_t w[8]; uint8_t b[64]; } block;
+    unsigned int i;
+
+    sha256_final(&ctx->inner, block.b);
+    memset(block.b + 32, 0x00, 32);
+    block.b[32] = 0x80;
+    store_be64(block.b + 56, (64 + 32) * 8);
+
+    sha256_process_dispatch(ctx->outer, block.b, 64);
+    for (i = 0; i < 8; ++i)
+        store_be32(mac + 4*i, ctx->outer[i]);
+
+    memset(&block, 0x00, sizeof(block));
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+void hmac_sha256(const hmac_sha256_key* key, const void* data, size_t length, uint8_t mac[32])
+{
+    hmac_sha256_ctx ctx;
+    hmac_sha256_init(&ctx, key);
+    hmac_sha256_update(&ctx, data, length);
+    hmac_sha256_final(&ctx, mac);
+}
+
+int hmac_sha256_verify(const hmac_sha256_key* key, const void* data, size_t length,
+                       const uint8_t* mac, size_t maclen)
+{
+    uint8_t expected[32];
+    if (maclen < HMAC_SHA256_MIN_MAC || maclen > 32)
+        return 0;
+
+    hmac_sha256(key, data, length, expected);
+    const int ok = equal_ct(expected, mac, maclen);
+    memset(expected, 0x00, sizeof(expected));
+    return ok;
+}
+
+/*********************** HMAC-SHA512 ***********************/
+
+void hmac_sha512_key_init(hmac_sha512_key* key, const uint8_t* k, size_t length)
+{
+    uint8_t block[128];
+    sha512_ctx ctx;
+    unsigned int i;
+
+    memset(block, 0x00, sizeof(block));
+    if (length > 128)
+    {
+        sha512_init(&ctx);
+        sha512_update(&ctx, k, length);
+        sha512_final(&ctx, block);
+    }
+    else if (length)
+        memcpy(block, k, length);
+
+    for (i = 0; i < 128; ++i)
+        block[i] ^= 0x36;
+    sha512_init(&ctx);
+    sha512_process_dispatch(ctx.state, block, 128);
+    memcpy(key->inner, ctx.state, sizeof(key->inner));
+
+    for (i = 0; i < 128; ++i)
+        block[i] ^= 0x36 ^ 0x5c;
+    sha512_init(&ctx);
+    sha512_process_dispatch(ctx.state, block, 128);
+    memcpy(key->outer, ctx.state, sizeof(key->outer));
+
+    memset(block, 0x00, sizeof(block));
+    memset(&ctx, 0x00, sizeof(ctx));
+}
+
+void hmac_sha512_init(hmac_sha512_ctx* ctx, const hmac_sha512_key* key)
+{
+    memcpy(ctx->inner.state, key->inner, sizeof(key->inner));
+    memcpy(ctx->outer, key->outer, sizeof(key->outer));
+    ctx->inner.length = 128;
+}
+
+void hmac_sha512_update(hmac_sha512_ctx* ctx, const void* data, size_t length)
+{
+    sha512_update(&ctx->inner, data, length);
+}
+
+void hmac_sha512_final(hmac_sha512_ctx* ctx, uint8_t mac[64])
+{
+    union { uint64_t w[16]; uint8_t b[128]; } block;
+    unsigned int i;
+
+    sha512_final(&ctx->inner, block.b);
+    memset(block.b + 64, 0x00, 64);
+    block.b[64] = 0x80;
+    store_be64(block.b + 120, (128 + 64) * 8);
+
+    sha512_process_dispatch(ctx->outer, block.b, 128);
+    for (i = 0; i < 8; ++i)
+        store_be64(mac + 8*i, ctx->outer[i]);
+
+    memset(&block, 0x00, sizeof(block));
+    memset(ctx, 0x00, sizeof(*ctx));
+}
+
+void hmac_sha512(const hmac_sha512_key* key, const void* data, size_t length, uint8_t mac[64])
+{
+    hmac_sha512_ctx ctx;
+    hmac_sha512_init(&ctx, key);
+    hmac_sha512_update(&ctx, data, length);
+    hmac_sha512_final(&ctx, mac);
+}
+
+int hmac_sha512_verify(const hmac_sha512_key* key, const void* data, size_t length,
+                       const uint8_t* mac, size_t maclen)
+{
+    uint8_t expected[64];
+    if (maclen < HMAC_SHA512_MIN_MAC || maclen > 64)
+        return 0;
+
+    hmac_sha512(key, data, length, expected);
+    const int ok = equal_ct(expected, mac, maclen);
+    memset(expected, 0x00, sizeof(expected));
+    return ok;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+
+static void from_hex(const char* hex, uint8_t* out)
+{
+    while (hex[0] && hex[1])
+    {
+        unsigned int v;
+        sscanf(hex, "%2x", &v);
+        *out++ = (uint8_t)v;
+        hex += 2;
+    }
+}
+
+/* RFC 4231 test cases 1, 2 and 6 */
+int main(int argc, char* argv[])
+{
+    static const char* mac256[3] = {
+        "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+        "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+        "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"
+    };
+    static const char* mac512[3] = {
+        "87aa7cdea5ef619d4ff0b4241a1d6cb02379f4e2ce4ec2787ad0b30545e17cde"
+        "daa833b7d6b8a702038b274eaea3f4e4be9d914eeb61f1702e696c203a126854",
+        "164b7a7bfcf819e2e395fbe73b56e0a387bd64222e831fd610270cd7ea250554"
+        "9758bf75c05a994a6d034f65f8f0e6fdcaeab1a34d4a6b4b636e070a38bce737",
+        "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+        "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598"
+    };
+    static const char* msgs[3] = {
+        "Hi There",
+        "what do ya want for nothing?",
+        "Test Using Larger Than Block-Size Key - Hash Key First"
+    };
+
+    uint8_t keys[3][131];
+    size_t keylen[3] = {20, 4, 131};
+    memset(keys[0], 0x0b, 20);
+    memcpy(keys[1], "Jefe", 4);
+    memset(keys[2], 0xaa, 131);
+
+    int success = 1;
+    unsigned int i;
+    for (i = 0; i < 3; ++i)
+    {
+        uint8_t expected[64], mac[64];
+        const size_t len = strlen(msgs[i]);
+        hmac_sha256_key k256;
+        hmac_sha512_key k512;
+        size_t j;
+
+        hmac_sha256_key_init(&k256, keys[i], keylen[i]);
+        from_hex(mac256[i], expected);
+        hmac_sha256(&k256, msgs[i], len, mac);
+        success &= (memcmp(mac, expected, 32) == 0);
+        success &= hmac_sha256_verify(&k256, msgs[i], len, expected, 32);
+        success &= hmac_sha256_verify(&k256, msgs[i], len, expected, 16);
+        success &= !hmac_sha256_verify(&k256, msgs[i], len, expected, 15);
+        success &= !hmac_sha256_verify(&k256, msgs[i], len, expected, 1);
+
+        /* Streaming, one byte at a time */
+        hmac_sha256_ctx c256;
+        hmac_sha256_init(&c256, &k256);
+        for (j = 0; j < len; ++j)
+            hmac_sha256_update(&c256, msgs[i] + j, 1);
+        hmac_sha256_final(&c256, mac);
+        success &= (memcmp(mac, expected, 32) == 0);
+
+        expected[31] ^= 1;
+        success &= !hmac_sha256_verify(&k256, msgs[i], len, expected, 32);
+
+        hmac_sha512_key_init(&k512, keys[i], keylen[i]);
+        from_hex(mac512[i], expected);
+        hmac_sha512(&k512, msgs[i], len, mac);
+        success &= (memcmp(mac, expected, 64) == 0);
+        success &= hmac_sha512_verify(&k512, msgs[i], len, expected, 64);
+        success &= hmac_sha512_verify(&k512, msgs[i], len, expected, 32);
+        success &= !hmac_sha512_verify(&k512, msgs[i], len, expected, 31);
+
+        hmac_sha512_ctx c512;
+        hmac_sha512_init(&c512, &k512);
+        for (j = 0; j < len; ++j)
+            hmac_sha512_update(&c512, msgs[i] + j, 1);
+        hmac_sha512_final(&c512, mac);
+        success &= (memcmp(mac, expected, 64) == 0);
+
+        expected[0] ^= 1;
+        success &= !hmac_sha512_verify(&k512, msgs[i], len, expected, 64);
+
+        printf("RFC 4231 case %u: %s\n", i == 2 ? 6 : i + 1, success ? "pass" : "fail");
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,81 @@
+/* sha-hmac.h - HMAC-SHA256 and HMAC-SHA512 with cached midstates */
+/*   Written and placed in public domain                          */
+
+/* A key is prepared once. Preparing compresses the ipad and opad   */
+/* blocks and keeps the two midstates, so each MAC costs only the   */
+/* message blocks plus one outer block. A prepared key holds secret */
+/* material; clear it with memset when it is no longer needed.      */
+
+#ifndef SHA_HMAC_H
+#define SHA_HMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha-ctx.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct hmac_sha256_key
+{
+    uint32_t inner[8];    /* state after the ipad block */
+    uint32_t outer[8];    /* state after the opad block */
+} hmac_sha256_key;
+
+typedef struct hmac_sha512_key
+{
+    uint64_t inner[8];
+    uint64_t outer[8];
+} hmac_sha512_key;
+
+typedef struct hmac_sha256_ctx
+{
+    sha256_ctx inner;
+    uint32_t outer[8];
+} hmac_sha256_ctx;
+
+typedef struct hmac_sha512_ctx
+{
+    sha512_ctx inner;
+    uint64_t outer[8];
+} hmac_sha512_ctx;
+
+/* Prepare a key of any length. Keys longer than the block size */
+/*  are hashed first, as RFC 2104 requires.                     */
+void hmac_sha256_key_init(hmac_sha256_key* key, const uint8_t* k, size_t length);
+void hmac_sha512_key_init(hmac_sha512_key* key, const uint8_t* k, size_t length);
+
+/* Streaming MAC from a prepared key */
+void hmac_sha256_init(hmac_sha256_ctx* ctx, const hmac_sha256_key* key);
+void hmac_sha256_update(hmac_sha256_ctx* ctx, const void* data, size_t length);
+void hmac_sha256_final(hmac_sha256_ctx* ctx, uint8_t mac[32]);
+
+void hmac_sha512_init(hmac_sha512_ctx* ctx, const hmac_sha512_key* key);
+void hmac_sha512_update(hmac_sha512_ctx* ctx, const void* data, size_t length);
+void hmac_sha512_final(hmac_sha512_ctx* ctx, uint8_t mac[64]);
+
+/* One-shot MAC of a message */
+void hmac_sha256(const hmac_sha256_key* key, const void* data, size_t length, uint8_t mac[32]);
+void hmac_sha512(const hmac_sha512_key* key, const void* data, size_t length, uint8_t mac[64]);
+
+/* Shortest truncated MAC that verify accepts. RFC 2104 section 5 */
+/*  asks for at least half the digest and at least 80 bits.       */
+#define HMAC_SHA256_MIN_MAC 16
+#define HMAC_SHA512_MIN_MAC 32
+
+/* Compute the MAC and compare the first maclen bytes with mac in */
+/*  constant time. Returns 1 if they match, 0 otherwise. maclen   */
+/*  must be between the minimum above and the digest size; a      */
+/*  shorter tag is rejected without computing the MAC.            */
+int hmac_sha256_verify(const hmac_sha256_key* key, const void* data, size_t length,
+                       const uint8_t* mac, size_t maclen);
+int hmac_sha512_verify(const hmac_sha512_key* key, const void* data, size_t length,
+                       const uint8_t* mac, size_t maclen);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_HMAC_H */
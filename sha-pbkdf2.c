@@ -0,0 +1,335 @@
+/* sha-pbkdf2.c - PBKDF2-HMAC-SHA256 and PBKDF2-HMAC-SHA512 */
+/*   Written and placed in public domain                    */
+
+/* U1 is an ordinary HMAC from the prepared key. The remaining      */
+/* iterations hash a 32-byte U, so the inner and the outer message  */
+/* are each one block with the same padding and length. Each lane   */
+/* keeps its block with the padding written once; an iteration only */
+/* rewrites the first half and runs the kernel twice, from the ipad */
+/* and then the opad midstate.                                      */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* Build the multi-buffer objects as shown in sha256-mb.c              */
+/* gcc -DTEST_MAIN sha-pbkdf2.c sha-hmac.o sha256-mb.o \               */
+/*     sha256-mb-avx2.o sha256-mb-avx512.o sha-ctx.o sha-dispatch.o \  */
+/*     <ISA objects> -o sha-pbkdf2.exe                                 */
+
+#include <string.h>
+
+#include "sha-pbkdf2.h"
+#include "sha-hmac.h"
+#include "sha256-mb.h"
+#include "sha-dispatch.h"
+
+static inline uint32_t load_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] <<  8) | ((uint32_t)p[3] <<  0);
+}
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v >>  0);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v)
+{
+    store_be32(p+0, (uint32_t)(v >> 32));
+    store_be32(p+4, (uint32_t)(v >>  0));
+}
+
+/* HMAC(key, salt || INT(index)) */
+static void pbkdf2_sha256_u1(const hmac_sha256_key* key, const uint8_t* salt, size_t saltlen,
+                             uint32_t index, uint8_t u[32])
+{
+    uint8_t be[4];
+    hmac_sha256_ctx ctx;
+    store_be32(be, index);
+    hmac_sha256_init(&ctx, key);
+    hmac_sha256_update(&ctx, salt, saltlen);
+    hmac_sha256_update(&ctx, be, 4);
+    hmac_sha256_final(&ctx, u);
+}
+
+/* Lane state for one output block */
+typedef struct pbkdf2_sha256_lane
+{
+    hmac_sha256_key key;
+    uint8_t block[64];     /* U in the first half, then the fixed padding */
+    uint32_t t[8];         /* running XOR of the U's */
+    uint8_t* out;
+    size_t outlen;
+} pbkdf2_sha256_lane;
+
+static void pbkdf2_sha256_lanes(sha256_mb_mgr* mgr, pbkdf2_sha256_lane lane[], unsigned int count,
+                                uint32_t iterations)
+{
+    sha256_mb_args* args = &mgr->args;
+    const uint32_t mask = (uint32_t)((1ULL << count) - 1);
+    unsigned int l, i;
+    uint32_t n;
+
+    for (n = 1; n < iterations; ++n)
+    {
+        /* Inner hash of U from the ipad midstate */
+        for (l = 0; l < count; ++l)
+        {
+            for (i = 0; i < 8; ++i)
+                args->digest[i][l] = lane[l].key.inner[i];
+            args->data[l] = lane[l].block;
+        }
+        mgr->kernel(args, mask, 1);
+
+        /* Outer hash of the inner digest from the opad midstate */
+        for (l = 0; l < count; ++l)
+        {
+            for (i = 0; i < 8; ++i)
+            {
+                store_be32(lane[l].block + 4*i, args->digest[i][l]);
+                args->digest[i][l] = lane[l].key.outer[i];
+            }
+            args->data[l] = lane[l].block;
+        }
+        mgr->kernel(args, mask, 1);
+
+        for (l = 0; l < count; ++l)
+        {
+            for (i = 0; i < 8; ++i)
+            {
+                store_be32(lane[l].block + 4*i, args->digest[i][l]);
+                lane[l].t[i] ^= args->digest[i][l];
+            }
+        }
+    }
+
+    for (l = 0; l < count; ++l)
+    {
+        uint8_t t[32];
+        for (i = 0; i < 8; ++i)
+            store_be32(t + 4*i, lane[l].t[i]);
+        memcpy(lane[l].out, t, lane[l].outlen);
+        memset(t, 0x00, sizeof(t));
+    }
+}
+
+int pbkdf2_hmac_sha256_batch(const uint8_t* const passwords[], const size_t pwlens[], size_t count,
+                             const uint8_t* salt, size_t saltlen,
+                             uint32_t iterations, uint8_t* out, size_t outlen, int kernel)
+{
+    pbkdf2_sha256_lane lane[SHA256_MB_MAX_LANES];
+    sha256_mb_mgr mgr;
+    unsigned int used = 0, i;
+    size_t p, off;
+
+    if (iterations == 0 || outlen == 0)
+        return -1;
+    if (outlen > (size_t)0xFFFFFFFF * 32)
+        return -1;
+    if (sha256_mb_init(&mgr, kernel) != 0)
+        return -1;
+
+    for (p = 0; p < count; ++p)
+    {
+        hmac_sha256_key key;
+        uint32_t index = 1;
+        hmac_sha256_key_init(&key, passwords[p], pwlens[p]);
+
+        for (off = 0; off < outlen; off += 32, ++index)
+        {
+            pbkdf2_sha256_lane* ln = &lane[used];
+            ln->key = key;
+            ln->out = out + p * outlen + off;
+            ln->outlen = (outlen - off < 32) ? outlen - off : 32;
+
+            pbkdf2_sha256_u1(&key, salt, saltlen, index, ln->block);
+            memset(ln->block + 32, 0x00, 32);
+            ln->block[32] = 0x80;
+            store_be64(ln->block + 56, (64 + 32) * 8);
+            for (i = 0; i < 8; ++i)
+                ln->t[i] = load_be32(ln->block + 4*i);
+
+            if (++used == mgr.lanes)
+            {
+                pbkdf2_sha256_lanes(&mgr, lane, used, iterations);
+                used = 0;
+            }
+        }
+        memset(&key, 0x00, sizeof(key));
+    }
+
+    if (used)
+        pbkdf2_sha256_lanes(&mgr, lane, used, iterations);
+
+    memset(lane, 0x00, sizeof(lane));
+    memset(&mgr.args, 0x00, sizeof(mgr.args));
+    return 0;
+}
+
+int pbkdf2_hmac_sha256(const uint8_t* password, size_t pwlen,
+                       const uint8_t* salt, size_t saltlen,
+                       uint32_t iterations, uint8_t* out, size_t outlen)
+{
+    const uint8_t* passwords[1] = {password};
+    const size_t pwlens[1] = {pwlen};
+    return pbkdf2_hmac_sha256_batch(passwords, pwlens, 1, salt, saltlen,
+                                    iterations, out, outlen, SHA256_MB_AUTO);
+}
+
+/* SHA-512 has no multi-buffer kernel. The output blocks run one  */
+/*  after another through the dispatched compress function, with  */
+/*  the same fixed padding block.                                 */
+int pbkdf2_hmac_sha512(const uint8_t* password, size_t pwlen,
+                       const uint8_t* salt, size_t saltlen,
+                       uint32_t iterations, uint8_t* out, size_t outlen)
+{
+    union { uint64_t w[16]; uint8_t b[128]; } block;
+    hmac_sha512_key key;
+    uint32_t index = 1;
+    size_t off;
+
+    if (iterations == 0 || outlen == 0)
+        return -1;
+    if (outlen > (size_t)0xFFFFFFFF * 64)
+        return -1;
+
+    hmac_sha512_key_init(&key, password, pwlen);
+
+    for (off = 0; off < outlen; off += 64, ++index)
+    {
+        uint64_t state[8], t[8];
+        uint8_t be[4];
+        hmac_sha512_ctx ctx;
+        unsigned int i;
+        uint32_t n;
+
+        store_be32(be, index);
+        hmac_sha512_init(&ctx, &key);
+        hmac_sha512_update(&ctx, salt, saltlen);
+        hmac_sha512_update(&ctx, be, 4);
+        hmac_sha512_final(&ctx, block.b);
+
+        memset(block.b + 64, 0x00, 64);
+        block.b[64] = 0x80;
+        store_be64(block.b + 120, (128 + 64) * 8);
+        for (i = 0; i < 8; ++i)
+            t[i] = ((uint64_t)load_be32(block.b + 8*i) << 32) | load_be32(block.b + 8*i + 4);
+
+        for (n = 1; n < iterations; ++n)
+        {
+            memcpy(state, key.inner, sizeof(state));
+            sha512_process_dispatch(state, block.b, 128);
+            for (i = 0; i < 8; ++i)
+                store_be64(block.b + 8*i, state[i]);
+
+            memcpy(state, key.outer, sizeof(state));
+            sha512_process_dispatch(state, block.b, 128);
+            for (i = 0; i < 8; ++i)
+            {
+                store_be64(block.b + 8*i, state[i]);
+                t[i] ^= state[i];
+            }
+        }
+
+        const size_t len = (outlen - off < 64) ? outlen - off : 64;
+        for (i = 0; i < 8; ++i)
+            store_be64(block.b + 8*i, t[i]);
+        memcpy(out + off, block.b, len);
+        memset(t, 0x00, sizeof(t));
+        memset(state, 0x00, sizeof(state));
+    }
+
+    memset(&key, 0x00, sizeof(key));
+    memset(&block, 0x00, sizeof(block));
+    return 0;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+
+static void from_hex(const char* hex, uint8_t* out)
+{
+    while (hex[0] && hex[1])
+    {
+        unsigned int v;
+        sscanf(hex, "%2x", &v);
+        *out++ = (uint8_t)v;
+        hex += 2;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* pw1 = "password";
+    const char* salt1 = "salt";
+    const char* pw2 = "passwordPASSWORDpassword";
+    const char* salt2 = "saltSALTsaltSALTsaltSALTsaltSALTsalt";
+    uint8_t expected[80], out[80];
+    int success = 1;
+
+    /* The RFC 6070 vectors computed with SHA-256 and SHA-512 */
+    from_hex("120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b", expected);
+    pbkdf2_hmac_sha256((const uint8_t*)pw1, 8, (const uint8_t*)salt1, 4, 1, out, 32);
+    success &= (memcmp(out, expected, 32) == 0);
+
+    from_hex("c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a", expected);
+    pbkdf2_hmac_sha256((const uint8_t*)pw1, 8, (const uint8_t*)salt1, 4, 4096, out, 32);
+    success &= (memcmp(out, expected, 32) == 0);
+
+    from_hex("348c89dbcbd32b2f32d814b8116e84cf2b17347ebc1800181c4e2a1fb8dd53e1c635518c7dac47e9", expected);
+    pbkdf2_hmac_sha256((const uint8_t*)pw2, 24, (const uint8_t*)salt2, 36, 4096, out, 40);
+    success &= (memcmp(out, expected, 40) == 0);
+    printf("PBKDF2-HMAC-SHA256: %s\n", success ? "pass" : "fail");
+
+    from_hex("867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252"
+             "c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce", expected);
+    pbkdf2_hmac_sha512((const uint8_t*)pw1, 8, (const uint8_t*)salt1, 4, 1, out, 64);
+    success &= (memcmp(out, expected, 64) == 0);
+
+    from_hex("8c0511f4c6e597c6ac6315d8f0362e225f3c501495ba23b868c005174dc4ee71"
+             "115b59f9e60cd9532fa33e0f75aefe30225c583a186cd82bd4daea9724a3d3b8"
+             "04f75bdd41494fa324cab24bcc680fb3", expected);
+    pbkdf2_hmac_sha512((const uint8_t*)pw2, 24, (const uint8_t*)salt2, 36, 4096, out, 80);
+    success &= (memcmp(out, expected, 80) == 0);
+    printf("PBKDF2-HMAC-SHA512: %s\n", success ? "pass" : "fail");
+
+    /* 21 passwords of 40 bytes each through every kernel */
+    {
+        enum { COUNT = 21 };
+        static uint8_t batch[COUNT * 40], single[COUNT * 40];
+        const uint8_t* passwords[COUNT];
+        size_t pwlens[COUNT];
+        uint8_t buffer[COUNT * 3];
+        unsigned int i;
+        int kernel;
+
+        for (i = 0; i < sizeof(buffer); ++i)
+            buffer[i] = (uint8_t)('a' + i % 26);
+        for (i = 0; i < COUNT; ++i)
+        {
+            passwords[i] = buffer + i;
+            pwlens[i] = i * 2;
+            pbkdf2_hmac_sha256(passwords[i], pwlens[i], (const uint8_t*)salt1, 4, 100, single + i * 40, 40);
+        }
+
+        for (kernel = SHA256_MB_AUTO; kernel <= SHA256_MB_X2; ++kernel)
+        {
+            memset(batch, 0x00, sizeof(batch));
+            if (pbkdf2_hmac_sha256_batch(passwords, pwlens, COUNT, (const uint8_t*)salt1, 4,
+                                         100, batch, 40, kernel) != 0)
+                continue;
+            success &= (memcmp(batch, single, sizeof(batch)) == 0);
+        }
+        printf("PBKDF2-HMAC-SHA256 batch: %s\n", success ? "pass" : "fail");
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* sha-pbkdf2.h - PBKDF2-HMAC-SHA256 and PBKDF2-HMAC-SHA512 */
+/*   Written and placed in public domain                    */
+
+/* Each PBKDF2 iteration is two dependent one-block compressions,  */
+/* so one stream waits on the latency of the kernel. The SHA-256   */
+/* functions run independent output blocks, and for the batch form */
+/* independent passwords, in the lanes of a multi-buffer kernel.   */
+
+#ifndef SHA_PBKDF2_H
+#define SHA_PBKDF2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Derive outlen bytes into out. Returns 0 on success, -1 if */
+/*  iterations or outlen is 0.                                */
+int pbkdf2_hmac_sha256(const uint8_t* password, size_t pwlen,
+                       const uint8_t* salt, size_t saltlen,
+                       uint32_t iterations, uint8_t* out, size_t outlen);
+
+int pbkdf2_hmac_sha512(const uint8_t* password, size_t pwlen,
+                       const uint8_t* salt, size_t saltlen,
+                       uint32_t iterations, uint8_t* out, size_t outlen);
+
+/* Derive outlen bytes for each of count passwords with the same   */
+/*  salt. Password i writes out[i*outlen]. kernel is a SHA256_MB_*  */
+/*  value. Returns 0 on success, -1 on bad parameters or if the     */
+/*  kernel is not available.                                        */
+int pbkdf2_hmac_sha256_batch(const uint8_t* const passwords[], const size_t pwlens[], size_t count,
+                             const uint8_t* salt, size_t saltlen,
+                             uint32_t iterations, uint8_t* out, size_t outlen, int kernel);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_PBKDF2_H */
@@ -0,0 +1,316 @@
+/* sha-short-x86.c - One-block SHA-1 and SHA-256 using the Intel SHA */
+/*   extensions                                                      */
+/*   Written and placed in public domain                             */
+
+/* A message of 55 bytes or less fits one block with its padding. */
+/* The message and its 0x80 marker are copied into a zeroed block */
+/* on the stack, the bit length is merged into the message        */
+/* registers, and the rounds start from the IV as a constant.     */
+/* There is no state to load, save or combine with a previous     */
+/* block.                                                         */
+
+/* gcc -c -msse4.1 -msha sha-short-x86.c */
+
+/* Include the GCC super header */
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <string.h>
+# include <x86intrin.h>
+#endif
+
+/* Microsoft supports Intel SHA ACLE extensions as of Visual Studio 2015 */
+#if defined(_MSC_VER)
+# include <immintrin.h>
+# include <string.h>
+# define WIN32_LEAN_AND_MEAN
+# include <Windows.h>
+typedef UINT32 uint32_t;
+typedef UINT8 uint8_t;
+#endif
+
+#include "sha-short.h"
+
+/* Load length bytes at data, length less than 56, as a zero-padded */
+/*  block with the 0x80 marker after the message. The message is    */
+/*  copied into a zeroed stack block so nothing past its end is     */
+/*  read. The copy is at most 55 bytes.                             */
+static inline void load_short(__m128i M[4], const uint8_t data[], size_t length)
+{
+    uint8_t block[64];
+    unsigned int i;
+
+    memset(block, 0x00, sizeof(block));
+    if (length)
+        memcpy(block, data, length);
+    block[length] = 0x80;
+
+    for (i = 0; i < 4; ++i)
+        M[i] = _mm_loadu_si128((const __m128i*) (block + 16*i));
+}
+
+void sha1_short_x86(uint8_t digest[20], const uint8_t data[], size_t length)
+{
+    __m128i ABCD, E0, E1;
+    __m128i MSG0, MSG1, MSG2, MSG3;
+    __m128i M[4];
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    const __m128i IV_ABCD = _mm_set_epi32(0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476);
+    const __m128i IV_E = _mm_set_epi32(0xC3D2E1F0, 0, 0, 0);
+
+    /* The byte reversal puts word 15 in the low lane */
+    load_short(M, data, length);
+    MSG0 = _mm_shuffle_epi8(M[0], MASK);
+    MSG1 = _mm_shuffle_epi8(M[1], MASK);
+    MSG2 = _mm_shuffle_epi8(M[2], MASK);
+    MSG3 = _mm_insert_epi32(_mm_shuffle_epi8(M[3], MASK), (int)(length * 8), 0);
+
+    ABCD = IV_ABCD;
+    E0 = IV_E;
+
+    /* Rounds 0-3 */
+    E0 = _mm_add_epi32(E0, MSG0);
+    E1 = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+    /* Rounds 4-7 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG1);
+    E0 = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+    /* Rounds 8-11 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG2);
+    E1 = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    /* Rounds 12-15 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG3);
+    E0 = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    /* Rounds 16-19 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG0);
+    E1 = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    /* Rounds 20-23 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG1);
+    E0 = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    /* Rounds 24-27 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG2);
+    E1 = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    /* Rounds 28-31 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG3);
+    E0 = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    /* Rounds 32-35 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG0);
+    E1 = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    /* Rounds 36-39 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG1);
+    E0 = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    /* Rounds 40-43 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG2);
+    E1 = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    /* Rounds 44-47 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG3);
+    E0 = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    /* Rounds 48-51 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG0);
+    E1 = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    /* Rounds 52-55 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG1);
+    E0 = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+    MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    /* Rounds 56-59 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG2);
+    E1 = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+    MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+    MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+    /* Rounds 60-63 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG3);
+    E0 = ABCD;
+    MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+    MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+    MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+    /* Rounds 64-67 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG0);
+    E1 = ABCD;
+    MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+    MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+    MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+    /* Rounds 68-71 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG1);
+    E0 = ABCD;
+    MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+    MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+    /* Rounds 72-75 */
+    E0 = _mm_sha1nexte_epu32(E0, MSG2);
+    E1 = ABCD;
+    MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+    /* Rounds 76-79 */
+    E1 = _mm_sha1nexte_epu32(E1, MSG3);
+    E0 = ABCD;
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+    /* Combine state */
+    E0 = _mm_sha1nexte_epu32(E0, IV_E);
+    ABCD = _mm_add_epi32(ABCD, IV_ABCD);
+
+    /* The byte reversal also puts A first */
+    const uint32_t E = (uint32_t)_mm_extract_epi32(E0, 3);
+    _mm_storeu_si128((__m128i*) digest, _mm_shuffle_epi8(ABCD, MASK));
+    digest[16] = (uint8_t)(E >> 24);
+    digest[17] = (uint8_t)(E >> 16);
+    digest[18] = (uint8_t)(E >>  8);
+    digest[19] = (uint8_t)(E >>  0);
+}
+
+static const uint32_t K256[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+
+#define KQ(q) _mm_loadu_si128((const __m128i*) &K256[4*(q)])
+
+/* Four rounds with K+W already added */
+#define RNDS4(KW) \
+    do { \
+        const __m128i KW_ = (KW); \
+        STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, KW_); \
+        STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, _mm_shuffle_epi32(KW_, 0x0E)); \
+    } while (0)
+
+/* Schedule message words 4q to 4q+3 into MSG<a> and run their rounds */
+#define QUAD(a, b, c, d, q) \
+    do { \
+        MSG##a = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(MSG##a, MSG##b), \
+                     _mm_alignr_epi8(MSG##d, MSG##c, 4)), MSG##d); \
+        RNDS4(_mm_add_epi32(MSG##a, KQ(q))); \
+    } while (0)
+
+void sha256_short_x86(uint8_t digest[32], const uint8_t data[], size_t length)
+{
+    __m128i STATE0, STATE1, TMP;
+    __m128i MSG0, MSG1, MSG2, MSG3;
+    __m128i M[4];
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    const __m128i IV_ABEF = _mm_set_epi32(0x6A09E667, 0xBB67AE85, 0x510E527F, 0x9B05688C);
+    const __m128i IV_CDGH = _mm_set_epi32(0x3C6EF372, 0xA54FF53A, 0x1F83D9AB, 0x5BE0CD19);
+
+    load_short(M, data, length);
+    MSG0 = _mm_shuffle_epi8(M[0], MASK);
+    MSG1 = _mm_shuffle_epi8(M[1], MASK);
+    MSG2 = _mm_shuffle_epi8(M[2], MASK);
+    MSG3 = _mm_insert_epi32(_mm_shuffle_epi8(M[3], MASK), (int)(length * 8), 3);
+
+    STATE0 = IV_ABEF;
+    STATE1 = IV_CDGH;
+
+    RNDS4(_mm_add_epi32(MSG0, KQ(0)));
+    RNDS4(_mm_add_epi32(MSG1, KQ(1)));
+    RNDS4(_mm_add_epi32(MSG2, KQ(2)));
+    RNDS4(_mm_add_epi32(MSG3, KQ(3)));
+    QUAD(0, 1, 2, 3, 4);
+    QUAD(1, 2, 3, 0, 5);
+    QUAD(2, 3, 0, 1, 6);
+    QUAD(3, 0, 1, 2, 7);
+    QUAD(0, 1, 2, 3, 8);
+    QUAD(1, 2, 3, 0, 9);
+    QUAD(2, 3, 0, 1, 10);
+    QUAD(3, 0, 1, 2, 11);
+    QUAD(0, 1, 2, 3, 12);
+    QUAD(1, 2, 3, 0, 13);
+    QUAD(2, 3, 0, 1, 14);
+    QUAD(3, 0, 1, 2, 15);
+
+    /* Combine state */
+    STATE0 = _mm_add_epi32(STATE0, IV_ABEF);
+    STATE1 = _mm_add_epi32(STATE1, IV_CDGH);
+
+    TMP = _mm_shuffle_epi32(STATE0, 0x1B);       /* FEBA */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);    /* DCHG */
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0); /* DCBA */
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);    /* ABEF */
+
+    _mm_storeu_si128((__m128i*) (digest +  0), _mm_shuffle_epi8(STATE0, MASK));
+    _mm_storeu_si128((__m128i*) (digest + 16), _mm_shuffle_epi8(STATE1, MASK));
+}
@@ -0,0 +1,282 @@
+/* sha-short.c - One-shot hashes of short messages */
+/*   Written and placed in public domain          */
+
+/* The SHA-NI kernels are bound on first use. Elsewhere the padded */
+/* block is built on the stack and goes through the dispatched     */
+/* compress function, starting from the IV instead of a context.   */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -c -msse4.1 -msha sha-short-x86.c                                */
+/* gcc -DTEST_MAIN sha-short.c sha-short-x86.o sha-ctx.o \             */
+/*     sha-dispatch.o <ISA objects> -o sha-short.exe                    */
+
+#include <string.h>
+
+#include "sha-short.h"
+#include "sha-ctx.h"
+#include "sha-dispatch.h"
+
+static const uint32_t IV1[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+static const uint32_t IV256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint64_t IV512[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8);
+    p[3] = (uint8_t)(v >>  0);
+}
+
+static inline void store_be64(uint8_t* p, uint64_t v)
+{
+    store_be32(p + 0, (uint32_t)(v >> 32));
+    store_be32(p + 4, (uint32_t)(v >>  0));
+}
+
+/* Pad a message of at most size-9 bytes into one block of size bytes */
+static inline void pad_block(uint8_t* block, size_t size, const void* data, size_t length)
+{
+    if (length)
+        memcpy(block, data, length);
+    memset(block + length, 0x00, size - length);
+    block[length] = 0x80;
+    block[size-2] = (uint8_t)((length * 8) >> 8);
+    block[size-1] = (uint8_t)((length * 8) >> 0);
+}
+
+static void sha1_short_portable(uint8_t digest[20], const uint8_t data[], size_t length)
+{
+    uint32_t state[5];
+    uint8_t block[64];
+    unsigned int i;
+
+    pad_block(block, sizeof(block), data, length);
+    memcpy(state, IV1, sizeof(state));
+    sha1_process_dispatch(state, block, sizeof(block));
+    for (i = 0; i < 5; ++i)
+        store_be32(digest + 4*i, state[i]);
+}
+
+static void sha256_short_portable(uint8_t digest[32], const uint8_t data[], size_t length)
+{
+    uint32_t state[8];
+    uint8_t block[64];
+    unsigned int i;
+
+    pad_block(block, sizeof(block), data, length);
+    memcpy(state, IV256, sizeof(state));
+    sha256_process_dispatch(state, block, sizeof(block));
+    for (i = 0; i < 8; ++i)
+        store_be32(digest + 4*i, state[i]);
+}
+
+typedef void (*sha1_short_fn)(uint8_t digest[20], const uint8_t data[], size_t length);
+typedef void (*sha256_short_fn)(uint8_t digest[32], const uint8_t data[], size_t length);
+
+static sha1_short_fn s_sha1_short;
+static sha256_short_fn s_sha256_short;
+static sha_once_flag s_once = SHA_ONCE_INIT;
+
+/* Runs once through sha_once, so every caller sees the bound kernels */
+static void resolve(void)
+{
+    const unsigned int features = sha_cpu_features();
+
+    s_sha1_short = sha1_short_portable;
+    s_sha256_short = sha256_short_portable;
+
+#if defined(SHA_DISPATCH_X86)
+    if (features & SHA_CPU_X86_SHA)
+    {
+        s_sha1_short = sha1_short_x86;
+        s_sha256_short = sha256_short_x86;
+    }
+#else
+    (void)features;
+#endif
+}
+
+void sha1_short(uint8_t digest[20], const void* data, size_t length)
+{
+    if (length <= SHA1_SHORT_MAX)
+    {
+        sha_once(&s_once, resolve);
+        s_sha1_short(digest, (const uint8_t*)data, length);
+    }
+    else
+    {
+        sha1_ctx ctx;
+        sha1_init(&ctx);
+        sha1_update(&ctx, data, length);
+        sha1_final(&ctx, digest);
+    }
+}
+
+void sha256_short(uint8_t digest[32], const void* data, size_t length)
+{
+    if (length <= SHA256_SHORT_MAX)
+    {
+        sha_once(&s_once, resolve);
+        s_sha256_short(digest, (const uint8_t*)data, length);
+    }
+    else
+    {
+        sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, data, length);
+        sha256_final(&ctx, digest);
+    }
+}
+
+/* There is no SHA-512 instruction on x86, so the block is built on */
+/*  the stack for the dispatched AVX2 or C compress function.        */
+void sha512_short(uint8_t digest[64], const void* data, size_t length)
+{
+    if (length <= SHA512_SHORT_MAX)
+    {
+        uint64_t state[8];
+        uint8_t block[128];
+        unsigned int i;
+
+        pad_block(block, sizeof(block), data, length);
+        memcpy(state, IV512, sizeof(state));
+        sha512_process_dispatch(state, block, sizeof(block));
+        for (i = 0; i < 8; ++i)
+            store_be64(digest + 8*i, state[i]);
+    }
+    else
+    {
+        sha512_ctx ctx;
+        sha512_init(&ctx);
+        sha512_update(&ctx, data, length);
+        sha512_final(&ctx, digest);
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+int main(int argc, char* argv[])
+{
+    uint8_t message[128], digest[64], ref[64];
+    size_t length;
+    unsigned int i;
+    int success = 1;
+
+    for (i = 0; i < sizeof(message); ++i)
+        message[i] = (uint8_t)(i * 37 + 11);
+
+    /* Every length up to past the one-block limit, every path */
+    for (length = 0; length < sizeof(message); ++length)
+    {
+        sha1_ctx c1;
+        sha1_init(&c1);
+        sha1_update(&c1, message, length);
+        sha1_final(&c1, ref);
+        sha1_short(digest, message, length);
+        success &= (memcmp(digest, ref, 20) == 0);
+        if (length <= SHA1_SHORT_MAX)
+        {
+            sha1_short_portable(digest, message, length);
+            success &= (memcmp(digest, ref, 20) == 0);
+        }
+
+        sha256_ctx c256;
+        sha256_init(&c256);
+        sha256_update(&c256, message, length);
+        sha256_final(&c256, ref);
+        sha256_short(digest, message, length);
+        success &= (memcmp(digest, ref, 32) == 0);
+        if (length <= SHA256_SHORT_MAX)
+        {
+            sha256_short_portable(digest, message, length);
+            success &= (memcmp(digest, ref, 32) == 0);
+        }
+
+        sha512_ctx c512;
+        sha512_init(&c512);
+        sha512_update(&c512, message, length);
+        sha512_final(&c512, ref);
+        sha512_short(digest, message, length);
+        success &= (memcmp(digest, ref, 64) == 0);
+    }
+
+    /* The empty message with no buffer, e3b0c44298fc1c14... */
+    sha256_short(digest, NULL, 0);
+    printf("SHA256 hash of empty message: ");
+    for (i = 0; i < 8; ++i)
+        printf("%02X", digest[i]);
+    printf("...\n");
+    success &= (digest[0] == 0xE3 && digest[1] == 0xB0 && digest[2] == 0xC4 && digest[3] == 0x42);
+    sha256_short_portable(digest, NULL, 0);
+    success &= (digest[0] == 0xE3 && digest[1] == 0xB0 && digest[2] == 0xC4 && digest[3] == 0x42);
+    sha1_short_portable(digest, NULL, 0);
+    success &= (digest[0] == 0xDA && digest[1] == 0x39 && digest[2] == 0xA3 && digest[3] == 0xEE);
+
+    /* SHA-512 of the empty message, cf83e1357eefb8bd... */
+    sha512_short(digest, NULL, 0);
+    success &= (digest[0] == 0xCF && digest[1] == 0x83 && digest[2] == 0xE1 && digest[3] == 0x35);
+
+#if defined(__unix__) || defined(__APPLE__)
+    /* Messages that end on the last byte before an unmapped page */
+    {
+        const long page = sysconf(_SC_PAGESIZE);
+        uint8_t* map = (uint8_t*)mmap(NULL, 2 * page, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map != MAP_FAILED && mprotect(map + page, page, PROT_NONE) == 0)
+        {
+            for (length = 1; length <= SHA256_SHORT_MAX; ++length)
+            {
+                uint8_t* p = map + page - length;
+                memcpy(p, message, length);
+
+                sha1_ctx c1;
+                sha1_init(&c1);
+                sha1_update(&c1, message, length);
+                sha1_final(&c1, ref);
+                sha1_short(digest, p, length);
+                success &= (memcmp(digest, ref, 20) == 0);
+
+                sha256_ctx c256;
+                sha256_init(&c256);
+                sha256_update(&c256, message, length);
+                sha256_final(&c256, ref);
+                sha256_short(digest, p, length);
+                success &= (memcmp(digest, ref, 32) == 0);
+            }
+            printf("Page boundary: %s\n", success ? "passed" : "failed");
+        }
+        if (map != MAP_FAILED)
+            munmap(map, 2 * page);
+    }
+#endif
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/* sha-short.h - One-shot hashes of short messages */
+/*   Written and placed in public domain          */
+
+/* Keys, IDs and other short strings fit one block with their      */
+/* padding: 55 bytes or less for SHA-1 and SHA-256, 111 bytes or   */
+/* less for SHA-512. For those lengths the functions below build   */
+/* the padded block directly and run one compress from the IV,     */
+/* without a context. Longer messages go through the streaming     */
+/* API, so any length is accepted.                                 */
+
+#ifndef SHA_SHORT_H
+#define SHA_SHORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHA1_SHORT_MAX   55
+#define SHA256_SHORT_MAX 55
+#define SHA512_SHORT_MAX 111
+
+void sha1_short(uint8_t digest[20], const void* data, size_t length);
+void sha256_short(uint8_t digest[32], const void* data, size_t length);
+void sha512_short(uint8_t digest[64], const void* data, size_t length);
+
+/* Kernels provided by the ISA source files. The length is at */
+/*  most SHA1_SHORT_MAX or SHA256_SHORT_MAX.                  */
+void sha1_short_x86(uint8_t digest[20], const uint8_t data[], size_t length);
+void sha256_short_x86(uint8_t digest[32], const uint8_t data[], size_t length);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_SHORT_H */
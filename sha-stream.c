@@ -0,0 +1,206 @@
+/* sha-stream.c - Compress large cold buffers with software prefetch */
+/*   Written and placed in public domain                            */
+
+/* The prefetch runs one slice ahead of the kernel call it serves,  */
+/* so the lines for slice n+k are requested while slice n hashes.   */
+/* Each line is prefetched once. Nothing is prefetched past the end */
+/* of the buffer.                                                   */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -DTEST_MAIN sha-stream.c sha-dispatch.o <ISA objects> -o sha-stream.exe */
+
+#include <string.h>
+
+#include "sha-stream.h"
+#include "sha-dispatch.h"
+
+#define SHA_STREAM_LINE 64
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <xmmintrin.h>
+# define SHA_PREFETCH(p, nt) _mm_prefetch((const char*)(p), (nt) ? _MM_HINT_NTA : _MM_HINT_T0)
+#elif defined(__GNUC__)
+# define SHA_PREFETCH(p, nt) ((nt) ? __builtin_prefetch((p), 0, 0) : __builtin_prefetch((p), 0, 3))
+#else
+# define SHA_PREFETCH(p, nt) ((void)(p))
+#endif
+
+typedef void (*stream_kernel_fn)(void* state, const uint8_t data[], size_t length);
+
+static void sha1_kernel(void* state, const uint8_t data[], size_t length)
+{
+    sha1_process_blocks_dispatch((uint32_t*)state, data, length);
+}
+
+static void sha256_kernel(void* state, const uint8_t data[], size_t length)
+{
+    sha256_process_blocks_dispatch((uint32_t*)state, data, length);
+}
+
+static void sha512_kernel(void* state, const uint8_t data[], size_t length)
+{
+    sha512_process_blocks_dispatch((uint64_t*)state, data, length);
+}
+
+void sha_stream_defaults(sha_stream_params* params)
+{
+    params->distance = 2048;
+    params->slice = 1024;
+    params->nontemporal = 0;
+}
+
+/* Prefetch the lines from p up to end. Returns the next line. */
+static const uint8_t* prefetch_lines(const uint8_t* p, const uint8_t* end, int nontemporal)
+{
+    if (nontemporal)
+    {
+        for (; p < end; p += SHA_STREAM_LINE)
+            SHA_PREFETCH(p, 1);
+    }
+    else
+    {
+        for (; p < end; p += SHA_STREAM_LINE)
+            SHA_PREFETCH(p, 0);
+    }
+    return p;
+}
+
+static void stream(void* state, const uint8_t* data, size_t length, size_t block,
+                   const sha_stream_params* params, stream_kernel_fn kernel)
+{
+    sha_stream_params defaults;
+    if (params == NULL)
+    {
+        sha_stream_defaults(&defaults);
+        params = &defaults;
+    }
+
+    length -= length % block;
+    if (params->distance == 0)
+    {
+        kernel(state, data, length);
+        return;
+    }
+
+    size_t slice = params->slice - params->slice % 128;
+    if (slice == 0)
+        slice = 128;
+
+    const uint8_t* end = data + length;
+    const size_t distance = params->distance;
+    const int nt = params->nontemporal;
+
+    /* The first line not yet prefetched */
+    const uint8_t* ahead = (const uint8_t*)((uintptr_t)data & ~(uintptr_t)(SHA_STREAM_LINE - 1));
+
+    while (data < end)
+    {
+        const size_t n = ((size_t)(end - data) < slice) ? (size_t)(end - data) : slice;
+        const uint8_t* target = ((size_t)(end - data) - n > distance) ? data + n + distance : end;
+
+        ahead = prefetch_lines(ahead, target, nt);
+
+        kernel(state, data, n);
+        data += n;
+    }
+}
+
+void sha1_process_stream(uint32_t state[5], const uint8_t data[], size_t length,
+                         const sha_stream_params* params)
+{
+    stream(state, data, length, 64, params, sha1_kernel);
+}
+
+void sha256_process_stream(uint32_t state[8], const uint8_t data[], size_t length,
+                           const sha_stream_params* params)
+{
+    stream(state, data, length, 64, params, sha256_kernel);
+}
+
+void sha512_process_stream(uint64_t state[8], const uint8_t data[], size_t length,
+                           const sha_stream_params* params)
+{
+    stream(state, data, length, 128, params, sha512_kernel);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+int main(int argc, char* argv[])
+{
+    /* Odd slices, distances past the end, an unaligned buffer and */
+    /*  a partial block at the end, against the plain kernels.     */
+    const size_t length = 100000;
+    uint8_t* buffer = (uint8_t*)malloc(length + 1);
+    const uint8_t* data = buffer + 1;
+    int success = (buffer != NULL);
+    size_t i;
+
+    if (buffer)
+    {
+        for (i = 0; i < length + 1; ++i)
+            buffer[i] = (uint8_t)(i * 31 + 5);
+    }
+
+    static const size_t distances[] = { 0, 64, 1000, 2048, 1 << 20 };
+    static const size_t slices[] = { 0, 100, 1024, 4096 };
+    unsigned int d, s, nt;
+
+    for (d = 0; success && d < sizeof(distances)/sizeof(distances[0]); ++d)
+    {
+        for (s = 0; s < sizeof(slices)/sizeof(slices[0]); ++s)
+        {
+            for (nt = 0; nt < 2; ++nt)
+            {
+                sha_stream_params params;
+                params.distance = distances[d];
+                params.slice = slices[s];
+                params.nontemporal = (int)nt;
+
+                uint32_t s1[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+                uint32_t r1[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+                uint32_t s256[8] = {0}, r256[8] = {0};
+                uint64_t s512[8] = {0}, r512[8] = {0};
+
+                sha1_process_stream(s1, data, length, &params);
+                sha1_process_blocks_dispatch(r1, data, length - length % 64);
+                sha256_process_stream(s256, data, length, &params);
+                sha256_process_blocks_dispatch(r256, data, length - length % 64);
+                sha512_process_stream(s512, data, length, &params);
+                sha512_process_blocks_dispatch(r512, data, length - length % 128);
+
+                success &= (memcmp(s1, r1, sizeof(r1)) == 0);
+                success &= (memcmp(s256, r256, sizeof(r256)) == 0);
+                success &= (memcmp(s512, r512, sizeof(r512)) == 0);
+            }
+        }
+    }
+    printf("Stream parameters: %s\n", success ? "pass" : "fail");
+
+    /* The defaults, and the empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_process_stream(state, message, sizeof(message), NULL);
+
+    /* e3b0c44298fc1c14... */
+    printf("SHA256 hash of empty message: %08X%08X...\n", state[0], state[1]);
+    success &= (state[0] == 0xE3B0C442 && state[1] == 0x98FC1C14);
+
+    free(buffer);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
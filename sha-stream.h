@@ -0,0 +1,49 @@
+/* sha-stream.h - Compress large cold buffers with software prefetch */
+/*   Written and placed in public domain                            */
+
+/* For buffers that are not in cache, like a fresh mmap of a large  */
+/* file, the compress loop can stall on DRAM. These functions feed  */
+/* the dispatched kernel one slice at a time, and before each slice */
+/* they prefetch the cache lines a set distance ahead. The length   */
+/* is a size_t, so buffers of 4 GiB and more go in one call.        */
+
+/* With nontemporal set the lines are prefetched with the           */
+/* non-temporal hint, prefetchnta on x86 and pldl1strm on Aarch64.  */
+/* The data then passes through the near cache without displacing   */
+/* the caller's working set from the outer levels.                  */
+
+#ifndef SHA_STREAM_H
+#define SHA_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct sha_stream_params
+{
+    size_t distance;    /* bytes to prefetch ahead of the kernel, 0 for none */
+    size_t slice;       /* bytes per kernel call, rounded down to 128 bytes */
+    int nontemporal;    /* prefetch with the non-temporal hint */
+} sha_stream_params;
+
+/* 2 KiB distance, 1 KiB slices, non-temporal hint off */
+void sha_stream_defaults(sha_stream_params* params);
+
+/* Process whole blocks. The caller is responsible for setting the */
+/*  initial state, and the caller is responsible for padding the   */
+/*  final block. params may be NULL for the defaults.              */
+void sha1_process_stream(uint32_t state[5], const uint8_t data[], size_t length,
+                         const sha_stream_params* params);
+void sha256_process_stream(uint32_t state[8], const uint8_t data[], size_t length,
+                           const sha_stream_params* params);
+void sha512_process_stream(uint64_t state[8], const uint8_t data[], size_t length,
+                           const sha_stream_params* params);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_STREAM_H */
@@ -0,0 +1,655 @@
+/* sha-tree.c - Parallel tree hashing of a single large input */
+/*   Written and placed in public domain                     */
+
+/* Each worker hashes a contiguous range of chunks through the      */
+/* streaming API, so the chunks go to the dispatched compress       */
+/* function in place. The leaf digests land in one array and the    */
+/* caller's thread folds them into the root. The tree above the     */
+/* leaves is a few thousand small hashes even for very large input, */
+/* so it is not worth spreading across threads.                     */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -DTEST_MAIN sha-tree.c sha-ctx.o sha-dispatch.o <ISA objects> \ */
+/*     -lpthread -o sha-tree.exe                                        */
+
+/* sha-tree.exe with a file argument prints the file's tree digest */
+/* in text form, hashed on eight threads.                          */
+
+#if defined(__unix__) || defined(__APPLE__)
+# if !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE 1
+# endif
+# define SHA_TREE_MMAP 1
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+# include <pthread.h>
+#endif
+
+#include "sha-tree.h"
+#include "sha-ctx.h"
+
+/* Root header: version, algorithm, chunk_log2 and the 64-bit length */
+#define TREE_HEADER 11
+
+typedef struct tree_worker
+{
+    int algorithm;
+    const uint8_t* data;
+    uint64_t length;
+    uint64_t chunk;
+
+    uint8_t* leaves;          /* digest of chunk i at size * i */
+    size_t size;
+    uint64_t begin, end;      /* chunks of this worker */
+} tree_worker;
+
+static const char* const s_names[3] = { NULL, "sha256", "sha512" };
+
+void sha_tree_defaults(sha_tree_params* params)
+{
+    params->algorithm = SHA_TREE_SHA256;
+    params->chunk_log2 = 20;
+    params->threads = 1;
+}
+
+/* H(prefix || a || b), with b optional */
+static void tree_hash(int algorithm, uint8_t prefix, const uint8_t* a, size_t alen,
+                      const uint8_t* b, size_t blen, uint8_t* out)
+{
+    if (algorithm == SHA_TREE_SHA256)
+    {
+        sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_update(&ctx, &prefix, 1);
+        sha256_update(&ctx, a, alen);
+        sha256_update(&ctx, b, blen);
+        sha256_final(&ctx, out);
+    }
+    else
+    {
+        sha512_ctx ctx;
+        sha512_init(&ctx);
+        sha512_update(&ctx, &prefix, 1);
+        sha512_update(&ctx, a, alen);
+        sha512_update(&ctx, b, blen);
+        sha512_final(&ctx, out);
+    }
+}
+
+static void* tree_work(void* arg)
+{
+    tree_worker* w = (tree_worker*)arg;
+    uint64_t i;
+
+    for (i = w->begin; i < w->end; ++i)
+    {
+        const uint64_t offset = i * w->chunk;
+        const uint64_t left = w->length - offset;
+        const size_t n = (size_t)(left < w->chunk ? left : w->chunk);
+        tree_hash(w->algorithm, 0x00, w->data + offset, n, NULL, 0, w->leaves + w->size * i);
+    }
+
+    return NULL;
+}
+
+/* Split the chunks across the workers and wait for them */
+static void tree_leaves(tree_worker* workers, unsigned int threads, uint64_t count)
+{
+    uint64_t t = threads ? threads : 1;
+    uint64_t i;
+
+    if (t > count) t = count;
+
+    for (i = 0; i < t; ++i)
+    {
+        workers[i] = workers[0];
+        workers[i].begin = count * i / t;
+        workers[i].end = count * (i + 1) / t;
+    }
+
+#if !defined(_WIN32)
+    pthread_t tid[SHA_TREE_MAX_THREADS];
+    int started[SHA_TREE_MAX_THREADS];
+
+    for (i = 1; i < t; ++i)
+        started[i] = (pthread_create(&tid[i], NULL, tree_work, &workers[i]) == 0);
+
+    tree_work(&workers[0]);
+
+    for (i = 1; i < t; ++i)
+    {
+        if (started[i])
+            pthread_join(tid[i], NULL);
+        else
+            tree_work(&workers[i]);
+    }
+#else
+    for (i = 0; i < t; ++i)
+        tree_work(&workers[i]);
+#endif
+}
+
+int sha_tree_hash(const void* data, uint64_t length, const sha_tree_params* params,
+                  sha_tree_digest* result)
+{
+    sha_tree_params defaults;
+    tree_worker workers[SHA_TREE_MAX_THREADS];
+    uint8_t header[TREE_HEADER];
+    unsigned int i;
+
+    if (!params)
+    {
+        sha_tree_defaults(&defaults);
+        params = &defaults;
+    }
+
+    if ((params->algorithm != SHA_TREE_SHA256 && params->algorithm != SHA_TREE_SHA512) ||
+        params->chunk_log2 < SHA_TREE_MIN_CHUNK_LOG2 || params->chunk_log2 > SHA_TREE_MAX_CHUNK_LOG2 ||
+        params->threads > SHA_TREE_MAX_THREADS || (!data && length) || !result)
+        return -1;
+
+    const size_t size = (params->algorithm == SHA_TREE_SHA256) ? 32 : 64;
+    const uint64_t chunk = (uint64_t)1 << params->chunk_log2;
+    const uint64_t count = length ? (length + chunk - 1) / chunk : 1;
+
+    if (count > SIZE_MAX / size)
+        return -1;
+    uint8_t* leaves = (uint8_t*)malloc((size_t)count * size);
+    if (!leaves)
+        return -1;
+
+    workers[0].algorithm = params->algorithm;
+    workers[0].data = (const uint8_t*)data;
+    workers[0].length = length;
+    workers[0].chunk = chunk;
+    workers[0].leaves = leaves;
+    workers[0].size = size;
+    tree_leaves(workers, params->threads, count);
+
+    /* Fold the levels in place. Node j of the next level overwrites */
+    /*  node j of this one, which has already been read.             */
+    uint64_t n = count;
+    while (n > 1)
+    {
+        uint64_t j;
+        for (j = 0; j < n / 2; ++j)
+            tree_hash(params->algorithm, 0x01, leaves + size * (2*j), size,
+                      leaves + size * (2*j+1), size, leaves + size * j);
+        if (n & 1)
+            memmove(leaves + size * (n / 2), leaves + size * (n - 1), size);
+        n = (n + 1) / 2;
+    }
+
+    header[0] = SHA_TREE_VERSION;
+    header[1] = (uint8_t)params->algorithm;
+    header[2] = (uint8_t)params->chunk_log2;
+    for (i = 0; i < 8; ++i)
+        header[3 + i] = (uint8_t)(length >> (56 - 8*i));
+
+    memset(result, 0x00, sizeof(*result));
+    result->version = SHA_TREE_VERSION;
+    result->algorithm = (uint8_t)params->algorithm;
+    result->chunk_log2 = (uint8_t)params->chunk_log2;
+    result->size = (uint8_t)size;
+    tree_hash(params->algorithm, 0x02, header, TREE_HEADER, leaves, size, result->digest);
+
+    free(leaves);
+    return 0;
+}
+
+#if defined(SHA_TREE_MMAP)
+/* Read the whole file into a heap buffer, for files that report a */
+/*  size of 0, like procfs, or that cannot be mapped. The tree needs */
+/*  the total length before the root, so the file is read first.    */
+static int read_all(int fd, uint8_t** data, size_t* length)
+{
+    size_t size = 0, capacity = 0;
+    uint8_t* buffer = NULL;
+
+    for (;;)
+    {
+        if (size == capacity)
+        {
+            const size_t grow = capacity ? capacity * 2 : ((size_t)1 << 16);
+            uint8_t* bigger = (grow > capacity) ? (uint8_t*)realloc(buffer, grow) : NULL;
+            if (!bigger)
+            {
+                free(buffer);
+                errno = ENOMEM;
+                return -1;
+            }
+            buffer = bigger;
+            capacity = grow;
+        }
+
+        const ssize_t n = pread(fd, buffer + size, capacity - size, (off_t)size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buffer);
+            return -1;
+        }
+        if (n == 0)
+            break;
+        size += (size_t)n;
+    }
+
+    *data = buffer;
+    *length = size;
+    return 0;
+}
+
+int sha_tree_hash_file(const char* path, const sha_tree_params* params,
+                       sha_tree_digest* result)
+{
+    struct stat st;
+    void* map = MAP_FAILED;
+    uint8_t* heap = NULL;
+    const uint8_t* data = NULL;
+    size_t length = 0;
+    int saved;
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0)
+        goto fail;
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX)
+        {
+            errno = EFBIG;
+            goto fail;
+        }
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            data = (const uint8_t*)map;
+            length = (size_t)st.st_size;
+        }
+    }
+
+    if (map == MAP_FAILED)
+    {
+        if (read_all(fd, &heap, &length) != 0)
+            goto fail;
+        data = heap;
+    }
+
+    const int ret = sha_tree_hash(data, (uint64_t)length, params, result);
+    if (ret != 0)
+        errno = EINVAL;
+
+    saved = errno;
+    if (map != MAP_FAILED)
+        munmap(map, length);
+    free(heap);
+    close(fd);
+    errno = saved;
+    return ret;
+
+fail:
+    saved = errno;
+    close(fd);
+    errno = saved;
+    return -1;
+}
+#else
+int sha_tree_hash_file(const char* path, const sha_tree_params* params,
+                       sha_tree_digest* result)
+{
+    errno = ENOSYS;
+    return -1;
+}
+#endif
+
+size_t sha_tree_format(const sha_tree_digest* result, char out[SHA_TREE_STRING_SIZE])
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned int i;
+
+    out[0] = '\0';
+    if (!((result->algorithm == SHA_TREE_SHA256 && result->size == 32) ||
+          (result->algorithm == SHA_TREE_SHA512 && result->size == 64)))
+        return 0;
+
+    int n = snprintf(out, SHA_TREE_STRING_SIZE, "tree%u-%s-%u-", result->version,
+                     s_names[result->algorithm == SHA_TREE_SHA512 ? 2 : 1], result->chunk_log2);
+    for (i = 0; i < result->size; ++i)
+    {
+        out[n++] = hex[result->digest[i] >> 4];
+        out[n++] = hex[result->digest[i] & 0x0f];
+    }
+    out[n] = '\0';
+
+    return (size_t)n;
+}
+
+/* Lowercase only, as sha_tree_format writes it */
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* Canonical decimal only: no sign, no leading zero, at most max */
+static int parse_uint(const char** text, unsigned int max, unsigned int* value)
+{
+    const char* p = *text;
+    unsigned int v = 0;
+
+    if (*p < '0' || *p > '9')
+        return -1;
+    if (*p == '0' && p[1] >= '0' && p[1] <= '9')
+        return -1;
+
+    for (; *p >= '0' && *p <= '9'; ++p)
+    {
+        v = v * 10 + (unsigned int)(*p - '0');
+        if (v > max)
+            return -1;
+    }
+
+    *value = v;
+    *text = p;
+    return 0;
+}
+
+/* Match the literal prefix at *text and step over it */
+static int parse_literal(const char** text, const char* literal)
+{
+    const size_t n = strlen(literal);
+    if (strncmp(*text, literal, n) != 0)
+        return -1;
+    *text += n;
+    return 0;
+}
+
+int sha_tree_parse(const char* text, sha_tree_digest* result)
+{
+    unsigned int version, chunk_log2, i;
+    const char* p = text;
+
+    /* One digest has exactly one accepted text form */
+    if (parse_literal(&p, "tree") != 0 || parse_uint(&p, 255, &version) != 0 ||
+        parse_literal(&p, "-") != 0)
+        return -1;
+
+    memset(result, 0x00, sizeof(*result));
+    if (parse_literal(&p, s_names[SHA_TREE_SHA256]) == 0)
+        result->algorithm = SHA_TREE_SHA256, result->size = 32;
+    else if (parse_literal(&p, s_names[SHA_TREE_SHA512]) == 0)
+        result->algorithm = SHA_TREE_SHA512, result->size = 64;
+    else
+        return -1;
+
+    if (parse_literal(&p, "-") != 0 || parse_uint(&p, 255, &chunk_log2) != 0 ||
+        parse_literal(&p, "-") != 0)
+        return -1;
+    if (version != SHA_TREE_VERSION ||
+        chunk_log2 < SHA_TREE_MIN_CHUNK_LOG2 || chunk_log2 > SHA_TREE_MAX_CHUNK_LOG2)
+        return -1;
+
+    if (strlen(p) != 2 * (size_t)result->size)
+        return -1;
+
+    for (i = 0; i < result->size; ++i)
+    {
+        const int hi = hex_value(p[2*i]);
+        const int lo = hex_value(p[2*i+1]);
+        if (hi < 0 || lo < 0)
+            return -1;
+        result->digest[i] = (uint8_t)((hi << 4) | lo);
+    }
+
+    result->version = (uint8_t)version;
+    result->chunk_log2 = (uint8_t)chunk_log2;
+    return 0;
+}
+
+#if defined(TEST_MAIN)
+
+#include <time.h>
+
+/* Straight from the definition in sha-tree.h, recursing on the */
+/*  largest power of two leaves below n like the level pairing. */
+static void reference_top(int algorithm, const uint8_t* data, uint64_t length, uint64_t chunk,
+                          uint64_t first, uint64_t n, uint8_t* out)
+{
+    const size_t size = (algorithm == SHA_TREE_SHA256) ? 32 : 64;
+
+    if (n == 1)
+    {
+        const uint64_t offset = first * chunk;
+        const uint64_t left = length - offset;
+        tree_hash(algorithm, 0x00, data + offset, (size_t)(left < chunk ? left : chunk), NULL, 0, out);
+    }
+    else
+    {
+        uint8_t l[64], r[64];
+        uint64_t k = 1;
+        while (k * 2 < n)
+            k *= 2;
+
+        reference_top(algorithm, data, length, chunk, first, k, l);
+        reference_top(algorithm, data, length, chunk, first + k, n - k, r);
+        tree_hash(algorithm, 0x01, l, size, r, size, out);
+    }
+}
+
+static void reference_root(int algorithm, unsigned int chunk_log2, const uint8_t* data,
+                           uint64_t length, uint8_t* out)
+{
+    const size_t size = (algorithm == SHA_TREE_SHA256) ? 32 : 64;
+    const uint64_t chunk = (uint64_t)1 << chunk_log2;
+    const uint64_t count = length ? (length + chunk - 1) / chunk : 1;
+    uint8_t top[64], header[TREE_HEADER];
+    unsigned int i;
+
+    reference_top(algorithm, data, length, chunk, 0, count, top);
+    header[0] = SHA_TREE_VERSION;
+    header[1] = (uint8_t)algorithm;
+    header[2] = (uint8_t)chunk_log2;
+    for (i = 0; i < 8; ++i)
+        header[3 + i] = (uint8_t)(length >> (56 - 8*i));
+    tree_hash(algorithm, 0x02, header, TREE_HEADER, top, size, out);
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t size = (size_t)37 << 12 | 123;
+    uint8_t* data = (uint8_t*)malloc(size);
+    uint8_t expected[64];
+    sha_tree_params params;
+    sha_tree_digest result, parsed;
+    char text[SHA_TREE_STRING_SIZE];
+    size_t i, n;
+    int success = 1;
+
+    for (i = 0; i < size; ++i)
+        data[i] = (uint8_t)(i * 29 + 3);
+
+    /* sha-tree.exe <file> hashes the file with every core */
+    if (argc > 1)
+    {
+        struct timespec t0, t1;
+        sha_tree_defaults(&params);
+        params.threads = 8;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (sha_tree_hash_file(argv[1], &params, &result) != 0)
+        {
+            perror(argv[1]);
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        sha_tree_format(&result, text);
+        printf("%s  %s  (%.3f s)\n", text, argv[1],
+               (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+        return 0;
+    }
+
+    /* Against the recursive definition, at lengths around chunk edges */
+    static const size_t lengths[] = {0, 1, 4095, 4096, 4097, 8192, 3*4096 + 5, 5*4096, 37*4096 + 123};
+    sha_tree_defaults(&params);
+    params.chunk_log2 = 12;
+    for (n = 0; n < sizeof(lengths)/sizeof(lengths[0]); ++n)
+    {
+        reference_root(SHA_TREE_SHA256, 12, data, lengths[n], expected);
+        success &= (sha_tree_hash(data, lengths[n], &params, &result) == 0);
+        success &= (result.size == 32 && memcmp(result.digest, expected, 32) == 0);
+    }
+    printf("SHA-256 trees: %s\n", success ? "pass" : "fail");
+
+    params.algorithm = SHA_TREE_SHA512;
+    params.chunk_log2 = 13;
+    for (n = 0; n < sizeof(lengths)/sizeof(lengths[0]); ++n)
+    {
+        reference_root(SHA_TREE_SHA512, 13, data, lengths[n], expected);
+        success &= (sha_tree_hash(data, lengths[n], &params, &result) == 0);
+        success &= (result.size == 64 && memcmp(result.digest, expected, 64) == 0);
+    }
+    printf("SHA-512 trees: %s\n", success ? "pass" : "fail");
+
+    /* The digest does not depend on the thread count */
+    params.algorithm = SHA_TREE_SHA256;
+    params.chunk_log2 = 12;
+    reference_root(SHA_TREE_SHA256, 12, data, size, expected);
+    for (params.threads = 0; params.threads <= 9; params.threads += 3)
+    {
+        success &= (sha_tree_hash(data, size, &params, &result) == 0);
+        success &= (memcmp(result.digest, expected, 32) == 0);
+    }
+    printf("Thread counts: %s\n", success ? "pass" : "fail");
+
+    /* The chunk size and the length are bound into the root */
+    {
+        sha_tree_digest other;
+        params.threads = 1;
+        sha_tree_hash(data, 8192, &params, &result);
+        params.chunk_log2 = 13;
+        sha_tree_hash(data, 8192, &params, &other);
+        success &= (memcmp(result.digest, other.digest, 32) != 0);
+        params.chunk_log2 = 12;
+        sha_tree_hash(data, 8191, &params, &other);
+        success &= (memcmp(result.digest, other.digest, 32) != 0);
+    }
+
+    /* Bad parameters */
+    params.chunk_log2 = SHA_TREE_MIN_CHUNK_LOG2 - 1;
+    success &= (sha_tree_hash(data, size, &params, &result) == -1);
+    params.chunk_log2 = 12;
+    params.algorithm = 3;
+    success &= (sha_tree_hash(data, size, &params, &result) == -1);
+    params.algorithm = SHA_TREE_SHA256;
+    params.threads = SHA_TREE_MAX_THREADS + 1;
+    success &= (sha_tree_hash(data, size, &params, &result) == -1);
+    success &= (sha_tree_hash(NULL, 1, NULL, &result) == -1);
+    printf("Parameters: %s\n", success ? "pass" : "fail");
+
+    /* Text form round trip */
+    sha_tree_hash(data, size, NULL, &result);
+    n = sha_tree_format(&result, text);
+    success &= (n == 16 + 64 && strncmp(text, "tree1-sha256-20-", 16) == 0);
+    success &= (sha_tree_parse(text, &parsed) == 0 && memcmp(&parsed, &result, sizeof(result)) == 0);
+    params.algorithm = SHA_TREE_SHA512;
+    sha_tree_hash(data, size, &params, &result);
+    sha_tree_format(&result, text);
+    success &= (sha_tree_parse(text, &parsed) == 0 && memcmp(&parsed, &result, sizeof(result)) == 0);
+    text[strlen(text) - 1] = '\0';
+    success &= (sha_tree_parse(text, &parsed) == -1);
+    success &= (sha_tree_parse("tree2-sha256-20-00", &parsed) == -1);
+    success &= (sha_tree_parse("tree1-md5-20-00", &parsed) == -1);
+
+    /* Only the canonical form parses: no signs, leading zeros, */
+    /*  wrapped numbers or uppercase hex                        */
+    {
+        static const char* const prefixes[] = {
+            "tree+1-sha256-20-", "tree01-sha256-20-", "tree1-sha256-+20-",
+            "tree1-sha256-020-", "tree1-sha256--4294967276-", "tree4294967297-sha256-20-",
+            "tree 1-sha256-20-", "tree1-sha2566-20-"
+        };
+        char variant[SHA_TREE_STRING_SIZE + 16];
+
+        sha_tree_hash(data, size, NULL, &result);
+        sha_tree_format(&result, text);
+        success &= (sha_tree_parse(text, &parsed) == 0);
+        for (i = 0; i < sizeof(prefixes)/sizeof(prefixes[0]); ++i)
+        {
+            snprintf(variant, sizeof(variant), "%s%s", prefixes[i], text + 16);
+            success &= (sha_tree_parse(variant, &parsed) == -1);
+        }
+        strcpy(variant, text);
+        for (i = 16; variant[i]; ++i)
+            if (variant[i] >= 'a' && variant[i] <= 'f')
+                break;
+        variant[i] = (char)(variant[i] - 'a' + 'A');
+        success &= (sha_tree_parse(variant, &parsed) == -1);
+
+        /* A size that does not match the algorithm is not formatted */
+        result.size = 40;
+        success &= (sha_tree_format(&result, text) == 0 && text[0] == '\0');
+    }
+    printf("Text form: %s\n", success ? "pass" : "fail");
+
+#if defined(SHA_TREE_MMAP)
+    /* A file hashes like the same bytes in memory */
+    {
+        char path[] = "/tmp/sha-tree-XXXXXX";
+        sha_tree_digest other;
+        const int fd = mkstemp(path);
+        success &= (fd >= 0 && write(fd, data, size) == (ssize_t)size);
+        params.algorithm = SHA_TREE_SHA256;
+        params.threads = 4;
+        success &= (sha_tree_hash_file(path, &params, &result) == 0);
+        success &= (sha_tree_hash(data, size, &params, &other) == 0);
+        success &= (memcmp(&result, &other, sizeof(result)) == 0);
+        if (fd >= 0)
+            ftruncate(fd, 0), close(fd);
+        success &= (sha_tree_hash_file(path, &params, &result) == 0);
+        success &= (sha_tree_hash(NULL, 0, &params, &other) == 0);
+        success &= (memcmp(&result, &other, sizeof(result)) == 0);
+        unlink(path);
+        success &= (sha_tree_hash_file(path, &params, &result) == -1);
+
+#if defined(__linux__)
+        /* Procfs reports a size of 0 for a file with content */
+        FILE* proc = fopen("/proc/self/cmdline", "rb");
+        if (proc)
+        {
+            uint8_t text_bytes[4096];
+            const size_t n = fread(text_bytes, 1, sizeof(text_bytes), proc);
+            fclose(proc);
+            success &= (n > 0 && sha_tree_hash_file("/proc/self/cmdline", &params, &result) == 0);
+            success &= (sha_tree_hash(text_bytes, n, &params, &other) == 0);
+            success &= (memcmp(&result, &other, sizeof(result)) == 0);
+        }
+#endif
+        printf("Files: %s\n", success ? "pass" : "fail");
+    }
+#endif
+
+    free(data);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
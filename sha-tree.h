@@ -0,0 +1,95 @@
+/* sha-tree.h - Parallel tree hashing of a single large input */
+/*   Written and placed in public domain                     */
+
+/* A single SHA-256 or SHA-512 stream runs on one core. Tree mode   */
+/* splits the input into fixed-size chunks, hashes the chunks on    */
+/* worker threads and combines the chunk digests in a binary tree.  */
+/* The result is not the plain SHA-256 or SHA-512 of the input. It  */
+/* is meant for manifests where both ends use this format.          */
+
+/* Format version 1, with H the selected hash and || concatenation: */
+/*                                                                  */
+/*   leaf[i] = H(0x00 || chunk[i])                                  */
+/*   node    = H(0x01 || left || right)                             */
+/*   root    = H(0x02 || version || algorithm || chunk_log2 ||      */
+/*               length || top)                                     */
+/*                                                                  */
+/* Chunks are 2^chunk_log2 bytes except the last one, which may be  */
+/* shorter. An empty input has one empty chunk. The leaves are      */
+/* paired left to right, level by level, and an unpaired last node  */
+/* moves up a level unchanged. top is the single node that remains. */
+/* version, algorithm and chunk_log2 are one byte each, and length  */
+/* is the input size in bytes as a 64-bit big-endian integer.       */
+/* The text form is "tree1-sha256-20-" followed by the hex digest.  */
+
+#ifndef SHA_TREE_H
+#define SHA_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHA_TREE_VERSION       1
+#define SHA_TREE_MAX_THREADS   64
+#define SHA_TREE_MIN_CHUNK_LOG2 12
+#define SHA_TREE_MAX_CHUNK_LOG2 30
+
+/* Room for the text form of any tree digest, with the terminator */
+#define SHA_TREE_STRING_SIZE   160
+
+/* Algorithm byte of the format */
+enum {
+    SHA_TREE_SHA256 = 1,
+    SHA_TREE_SHA512 = 2
+};
+
+typedef struct sha_tree_params
+{
+    int algorithm;            /* SHA_TREE_SHA256 or SHA_TREE_SHA512 */
+    unsigned int chunk_log2;  /* chunk size is 2^chunk_log2 bytes */
+    unsigned int threads;     /* worker threads, 0 or 1 for the caller's thread only */
+} sha_tree_params;
+
+/* SHA-256, 1 MiB chunks, one thread */
+void sha_tree_defaults(sha_tree_params* params);
+
+typedef struct sha_tree_digest
+{
+    uint8_t version;
+    uint8_t algorithm;
+    uint8_t chunk_log2;
+    uint8_t size;             /* bytes of digest in use, 32 or 64 */
+    uint8_t digest[64];
+} sha_tree_digest;
+
+/* Tree hash of length bytes at data. params may be NULL for the */
+/*  defaults. Returns 0 on success, -1 on bad parameters or an    */
+/*  allocation failure.                                           */
+int sha_tree_hash(const void* data, uint64_t length, const sha_tree_params* params,
+                  sha_tree_digest* result);
+
+/* Tree hash of a file. The file is mapped whole and the workers */
+/*  fault in their own chunks. A file that reports a size of 0,  */
+/*  like procfs, or that cannot be mapped is read into memory    */
+/*  instead. Returns -1 on an I/O error too.                     */
+int sha_tree_hash_file(const char* path, const sha_tree_params* params,
+                       sha_tree_digest* result);
+
+/* Text form of a digest. Returns the length of the string, or 0 */
+/*  with an empty string if size does not match the algorithm.   */
+size_t sha_tree_format(const sha_tree_digest* result, char out[SHA_TREE_STRING_SIZE]);
+
+/* Parse the text form. Returns 0 on success, -1 if the string is */
+/*  malformed or uses an unknown version or algorithm. Only the   */
+/*  form sha_tree_format writes is accepted: decimal numbers with */
+/*  no sign or leading zero, and lowercase hex.                   */
+int sha_tree_parse(const char* text, sha_tree_digest* result);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA_TREE_H */
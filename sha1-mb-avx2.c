@@ -0,0 +1,237 @@
+/* sha1-mb-avx2.c - 8-lane multi-buffer SHA-1 using AVX2         */
+/*   Written and placed in public domain                         */
+
+/* Each 32-bit lane of a YMM register carries one message. The   */
+/* rounds are the same as sha1_process, but every operation      */
+/* works on eight messages. The message words are loaded one     */
+/* lane at a time and transposed into word-major order.          */
+
+/* gcc -DTEST_MAIN -mavx2 sha1-mb-avx2.c -o sha1-mb-avx2.exe */
+
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <immintrin.h>
+#endif
+
+#include "sha1-mb.h"
+
+/* Inactive lanes read this block so the loads never fault */
+static const uint8_t ZERO_BLOCK[64] = {0};
+
+#define ROTL(x,n)    _mm256_or_si256(_mm256_slli_epi32((x),(n)), _mm256_srli_epi32((x),32-(n)))
+#define XOR(x,y)     _mm256_xor_si256((x),(y))
+#define ADD(x,y)     _mm256_add_epi32((x),(y))
+
+#define F1(x,y,z)    XOR(_mm256_and_si256(XOR((y),(z)),(x)),(z))
+#define F2(x,y,z)    XOR(XOR((x),(y)),(z))
+#define F3(x,y,z)    _mm256_or_si256(_mm256_and_si256((x),(y)), _mm256_and_si256(_mm256_or_si256((x),(y)),(z)))
+
+/* Next word of the circular message schedule */
+#define SCHEDULE(i) \
+    (W[(i)&15] = ROTL(XOR(XOR(W[((i)+13)&15], W[((i)+8)&15]), XOR(W[((i)+2)&15], W[(i)&15])), 1))
+
+/* One round. The caller renames the working variables instead of */
+/*  moving them, so only b and e are written.                     */
+#define ROUND(F,K,a,b,c,d,e,w) do { \
+    e = ADD(ADD(e, ROTL(a,5)), ADD(F(b,c,d), ADD(K, w))); \
+    b = ROTL(b,30); \
+} while (0)
+
+/* Five rounds with the words from the block */
+#define ROUNDS_LOAD(F,K,i) do { \
+    ROUND(F,K,a,b,c,d,e,W[(i)+0]); ROUND(F,K,e,a,b,c,d,W[(i)+1]); \
+    ROUND(F,K,d,e,a,b,c,W[(i)+2]); ROUND(F,K,c,d,e,a,b,W[(i)+3]); \
+    ROUND(F,K,b,c,d,e,a,W[(i)+4]); \
+} while (0)
+
+/* Five rounds with scheduled words */
+#define ROUNDS_SCHED(F,K,i) do { \
+    ROUND(F,K,a,b,c,d,e,SCHEDULE((i)+0)); ROUND(F,K,e,a,b,c,d,SCHEDULE((i)+1)); \
+    ROUND(F,K,d,e,a,b,c,SCHEDULE((i)+2)); ROUND(F,K,c,d,e,a,b,SCHEDULE((i)+3)); \
+    ROUND(F,K,b,c,d,e,a,SCHEDULE((i)+4)); \
+} while (0)
+
+/* Load eight words from each lane and transpose them so the */
+/*  result holds word i of every lane in W[i].               */
+static inline void load_transpose(__m256i W[8], const uint8_t* ptr[8], size_t offset)
+{
+    const __m256i MASK = _mm256_set_epi64x(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m256i r0 = _mm256_loadu_si256((const __m256i*)(ptr[0] + offset));
+    __m256i r1 = _mm256_loadu_si256((const __m256i*)(ptr[1] + offset));
+    __m256i r2 = _mm256_loadu_si256((const __m256i*)(ptr[2] + offset));
+    __m256i r3 = _mm256_loadu_si256((const __m256i*)(ptr[3] + offset));
+    __m256i r4 = _mm256_loadu_si256((const __m256i*)(ptr[4] + offset));
+    __m256i r5 = _mm256_loadu_si256((const __m256i*)(ptr[5] + offset));
+    __m256i r6 = _mm256_loadu_si256((const __m256i*)(ptr[6] + offset));
+    __m256i r7 = _mm256_loadu_si256((const __m256i*)(ptr[7] + offset));
+
+    const __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    const __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    const __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    const __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+    const __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+    const __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+    const __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+    const __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    r0 = _mm256_unpacklo_epi64(t0, t2);
+    r1 = _mm256_unpackhi_epi64(t0, t2);
+    r2 = _mm256_unpacklo_epi64(t1, t3);
+    r3 = _mm256_unpackhi_epi64(t1, t3);
+    r4 = _mm256_unpacklo_epi64(t4, t6);
+    r5 = _mm256_unpackhi_epi64(t4, t6);
+    r6 = _mm256_unpacklo_epi64(t5, t7);
+    r7 = _mm256_unpackhi_epi64(t5, t7);
+
+    W[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x20), MASK);
+    W[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x20), MASK);
+    W[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x20), MASK);
+    W[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x20), MASK);
+    W[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x31), MASK);
+    W[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x31), MASK);
+    W[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x31), MASK);
+    W[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x31), MASK);
+}
+
+/* Process blocks for the lanes set in mask. The caller is responsible */
+/*  for setting the initial state and padding each lane's message.    */
+void sha1_mb_avx2(sha1_mb_args* args, uint32_t mask, size_t blocks)
+{
+    const uint8_t* ptr[8];
+    size_t stride[8];
+    unsigned int i;
+
+    if (blocks == 0 || (mask & 0xff) == 0)
+        return;
+
+    /* Inactive lanes spin on the zero block */
+    for (i = 0; i < 8; ++i)
+    {
+        const int active = (mask >> i) & 1;
+        ptr[i] = active ? args->data[i] : ZERO_BLOCK;
+        stride[i] = active ? 64 : 0;
+    }
+
+    const __m256i LANES = _mm256_cmpgt_epi32(
+        _mm256_and_si256(_mm256_set1_epi32((int)mask), _mm256_set_epi32(128,64,32,16,8,4,2,1)),
+        _mm256_setzero_si256());
+
+    const __m256i K1 = _mm256_set1_epi32(0x5A827999);
+    const __m256i K2 = _mm256_set1_epi32(0x6ED9EBA1);
+    const __m256i K3 = _mm256_set1_epi32((int)0x8F1BBCDC);
+    const __m256i K4 = _mm256_set1_epi32((int)0xCA62C1D6);
+
+    const __m256i A0 = _mm256_loadu_si256((const __m256i*)args->digest[0]);
+    const __m256i B0 = _mm256_loadu_si256((const __m256i*)args->digest[1]);
+    const __m256i C0 = _mm256_loadu_si256((const __m256i*)args->digest[2]);
+    const __m256i D0 = _mm256_loadu_si256((const __m256i*)args->digest[3]);
+    const __m256i E0 = _mm256_loadu_si256((const __m256i*)args->digest[4]);
+
+    __m256i SA = A0, SB = B0, SC = C0, SD = D0, SE = E0;
+
+    while (blocks--)
+    {
+        __m256i a = SA, b = SB, c = SC, d = SD, e = SE;
+        __m256i W[16];
+
+        load_transpose(W+0, ptr, 0);
+        load_transpose(W+8, ptr, 32);
+
+        /* Rounds 0-19 */
+        ROUNDS_LOAD(F1, K1, 0);
+        ROUNDS_LOAD(F1, K1, 5);
+        ROUNDS_LOAD(F1, K1, 10);
+        ROUND(F1,K1,a,b,c,d,e,W[15]);
+        ROUND(F1,K1,e,a,b,c,d,SCHEDULE(16)); ROUND(F1,K1,d,e,a,b,c,SCHEDULE(17));
+        ROUND(F1,K1,c,d,e,a,b,SCHEDULE(18)); ROUND(F1,K1,b,c,d,e,a,SCHEDULE(19));
+
+        /* Rounds 20-39 */
+        ROUNDS_SCHED(F2, K2, 20); ROUNDS_SCHED(F2, K2, 25);
+        ROUNDS_SCHED(F2, K2, 30); ROUNDS_SCHED(F2, K2, 35);
+
+        /* Rounds 40-59 */
+        ROUNDS_SCHED(F3, K3, 40); ROUNDS_SCHED(F3, K3, 45);
+        ROUNDS_SCHED(F3, K3, 50); ROUNDS_SCHED(F3, K3, 55);
+
+        /* Rounds 60-79 */
+        ROUNDS_SCHED(F2, K4, 60); ROUNDS_SCHED(F2, K4, 65);
+        ROUNDS_SCHED(F2, K4, 70); ROUNDS_SCHED(F2, K4, 75);
+
+        SA = ADD(SA, a); SB = ADD(SB, b); SC = ADD(SC, c);
+        SD = ADD(SD, d); SE = ADD(SE, e);
+
+        for (i = 0; i < 8; ++i)
+            ptr[i] += stride[i];
+    }
+
+    /* Keep the old digest in the inactive lanes */
+    _mm256_storeu_si256((__m256i*)args->digest[0], _mm256_blendv_epi8(A0, SA, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[1], _mm256_blendv_epi8(B0, SB, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[2], _mm256_blendv_epi8(C0, SC, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[3], _mm256_blendv_epi8(D0, SD, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[4], _mm256_blendv_epi8(E0, SE, LANES));
+
+    for (i = 0; i < 8; ++i)
+    {
+        if ((mask >> i) & 1)
+            args->data[i] = ptr[i];
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state in every lane */
+    static const uint32_t iv[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    sha1_mb_args args;
+    unsigned int i, j;
+    for (i = 0; i < 5; ++i)
+        for (j = 0; j < 8; ++j)
+            args.digest[i][j] = iv[i];
+    for (j = 0; j < 8; ++j)
+        args.data[j] = message;
+
+    /* Lane 5 is inactive and keeps the initial state */
+    sha1_mb_avx2(&args, 0xDF, 1);
+
+    /* DA39A3EE5E6B4B0D... */
+    printf("SHA1 hash of empty message: %08X%08X...\n",
+        args.digest[0][0], args.digest[1][0]);
+
+    int success = 1;
+    for (j = 0; j < 8; ++j)
+    {
+        if (j == 5)
+            success &= (args.digest[0][j] == iv[0] && args.data[j] == message);
+        else
+            success &= (args.digest[0][j] == 0xDA39A3EE && args.digest[1][j] == 0x5E6B4B0D &&
+                        args.digest[4][j] == 0xAFD80709 && args.data[j] == message + 64);
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
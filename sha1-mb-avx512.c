@@ -0,0 +1,234 @@
+/* sha1-mb-avx512.c - 16-lane multi-buffer SHA-1 using AVX-512 */
+/*   Written and placed in public domain                        */
+
+/* Each 32-bit lane of a ZMM register carries one message. AVX-512 */
+/* has a native rotate, vprold, and vpternlogd computes the round  */
+/* functions and the four-way XOR of the schedule in fewer steps.  */
+
+/* gcc -DTEST_MAIN -mavx512f -mavx512bw sha1-mb-avx512.c -o sha1-mb-avx512.exe */
+
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <immintrin.h>
+#endif
+
+#include "sha1-mb.h"
+
+/* Inactive lanes read this block so the loads never fault */
+static const uint8_t ZERO_BLOCK[64] = {0};
+
+#define ROTL(x,n)    _mm512_rol_epi32((x),(n))
+#define XOR(x,y)     _mm512_xor_si512((x),(y))
+#define ADD(x,y)     _mm512_add_epi32((x),(y))
+
+/* x ? y : z, parity and the majority of x, y and z */
+#define F1(x,y,z)    _mm512_ternarylogic_epi32((x),(y),(z),0xCA)
+#define F2(x,y,z)    _mm512_ternarylogic_epi32((x),(y),(z),0x96)
+#define F3(x,y,z)    _mm512_ternarylogic_epi32((x),(y),(z),0xE8)
+
+/* Next word of the circular message schedule */
+#define SCHEDULE(i) \
+    (W[(i)&15] = ROTL(XOR(F2(W[((i)+13)&15], W[((i)+8)&15], W[((i)+2)&15]), W[(i)&15]), 1))
+
+/* One round. The caller renames the working variables instead of */
+/*  moving them, so only b and e are written.                     */
+#define ROUND(F,K,a,b,c,d,e,w) do { \
+    e = ADD(ADD(e, ROTL(a,5)), ADD(F(b,c,d), ADD(K, w))); \
+    b = ROTL(b,30); \
+} while (0)
+
+/* Five rounds with the words from the block */
+#define ROUNDS_LOAD(F,K,i) do { \
+    ROUND(F,K,a,b,c,d,e,W[(i)+0]); ROUND(F,K,e,a,b,c,d,W[(i)+1]); \
+    ROUND(F,K,d,e,a,b,c,W[(i)+2]); ROUND(F,K,c,d,e,a,b,W[(i)+3]); \
+    ROUND(F,K,b,c,d,e,a,W[(i)+4]); \
+} while (0)
+
+/* Five rounds with scheduled words */
+#define ROUNDS_SCHED(F,K,i) do { \
+    ROUND(F,K,a,b,c,d,e,SCHEDULE((i)+0)); ROUND(F,K,e,a,b,c,d,SCHEDULE((i)+1)); \
+    ROUND(F,K,d,e,a,b,c,SCHEDULE((i)+2)); ROUND(F,K,c,d,e,a,b,SCHEDULE((i)+3)); \
+    ROUND(F,K,b,c,d,e,a,SCHEDULE((i)+4)); \
+} while (0)
+
+/* Load a block from each lane and transpose it so the */
+/*  result holds word i of every lane in W[i].         */
+static inline void load_transpose(__m512i W[16], const uint8_t* ptr[16])
+{
+    const __m512i MASK = _mm512_set_epi64(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m512i r[16], t[16];
+    unsigned int i;
+
+    for (i = 0; i < 16; ++i)
+        r[i] = _mm512_loadu_si512((const void*)ptr[i]);
+
+    /* 2x2 blocks of words, then 4x4 blocks within each 128-bit chunk */
+    for (i = 0; i < 16; i += 2)
+    {
+        t[i+0] = _mm512_unpacklo_epi32(r[i], r[i+1]);
+        t[i+1] = _mm512_unpackhi_epi32(r[i], r[i+1]);
+    }
+    for (i = 0; i < 16; i += 4)
+    {
+        r[i+0] = _mm512_unpacklo_epi64(t[i+0], t[i+2]);
+        r[i+1] = _mm512_unpackhi_epi64(t[i+0], t[i+2]);
+        r[i+2] = _mm512_unpacklo_epi64(t[i+1], t[i+3]);
+        r[i+3] = _mm512_unpackhi_epi64(t[i+1], t[i+3]);
+    }
+
+    /* Chunk k of r[4g+m] holds word 4k+m of lanes 4g..4g+3 */
+    for (i = 0; i < 4; ++i)
+    {
+        const __m512i x0 = _mm512_shuffle_i32x4(r[i+0], r[i+4], 0x44);
+        const __m512i x1 = _mm512_shuffle_i32x4(r[i+0], r[i+4], 0xEE);
+        const __m512i y0 = _mm512_shuffle_i32x4(r[i+8], r[i+12], 0x44);
+        const __m512i y1 = _mm512_shuffle_i32x4(r[i+8], r[i+12], 0xEE);
+
+        W[i+ 0] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x0, y0, 0x88), MASK);
+        W[i+ 4] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x0, y0, 0xDD), MASK);
+        W[i+ 8] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x1, y1, 0x88), MASK);
+        W[i+12] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x1, y1, 0xDD), MASK);
+    }
+}
+
+/* Process blocks for the lanes set in mask. The caller is responsible */
+/*  for setting the initial state and padding each lane's message.    */
+void sha1_mb_avx512(sha1_mb_args* args, uint32_t mask, size_t blocks)
+{
+    const uint8_t* ptr[16];
+    size_t stride[16];
+    unsigned int i;
+
+    if (blocks == 0 || (mask & 0xffff) == 0)
+        return;
+
+    /* Inactive lanes spin on the zero block */
+    for (i = 0; i < 16; ++i)
+    {
+        const int active = (mask >> i) & 1;
+        ptr[i] = active ? args->data[i] : ZERO_BLOCK;
+        stride[i] = active ? 64 : 0;
+    }
+
+    const __mmask16 LANES = (__mmask16)mask;
+
+    const __m512i K1 = _mm512_set1_epi32(0x5A827999);
+    const __m512i K2 = _mm512_set1_epi32(0x6ED9EBA1);
+    const __m512i K3 = _mm512_set1_epi32((int)0x8F1BBCDC);
+    const __m512i K4 = _mm512_set1_epi32((int)0xCA62C1D6);
+
+    const __m512i A0 = _mm512_loadu_si512((const void*)args->digest[0]);
+    const __m512i B0 = _mm512_loadu_si512((const void*)args->digest[1]);
+    const __m512i C0 = _mm512_loadu_si512((const void*)args->digest[2]);
+    const __m512i D0 = _mm512_loadu_si512((const void*)args->digest[3]);
+    const __m512i E0 = _mm512_loadu_si512((const void*)args->digest[4]);
+
+    __m512i SA = A0, SB = B0, SC = C0, SD = D0, SE = E0;
+
+    while (blocks--)
+    {
+        __m512i a = SA, b = SB, c = SC, d = SD, e = SE;
+        __m512i W[16];
+
+        load_transpose(W, ptr);
+
+        /* Rounds 0-19 */
+        ROUNDS_LOAD(F1, K1, 0);
+        ROUNDS_LOAD(F1, K1, 5);
+        ROUNDS_LOAD(F1, K1, 10);
+        ROUND(F1,K1,a,b,c,d,e,W[15]);
+        ROUND(F1,K1,e,a,b,c,d,SCHEDULE(16)); ROUND(F1,K1,d,e,a,b,c,SCHEDULE(17));
+        ROUND(F1,K1,c,d,e,a,b,SCHEDULE(18)); ROUND(F1,K1,b,c,d,e,a,SCHEDULE(19));
+
+        /* Rounds 20-39 */
+        ROUNDS_SCHED(F2, K2, 20); ROUNDS_SCHED(F2, K2, 25);
+        ROUNDS_SCHED(F2, K2, 30); ROUNDS_SCHED(F2, K2, 35);
+
+        /* Rounds 40-59 */
+        ROUNDS_SCHED(F3, K3, 40); ROUNDS_SCHED(F3, K3, 45);
+        ROUNDS_SCHED(F3, K3, 50); ROUNDS_SCHED(F3, K3, 55);
+
+        /* Rounds 60-79 */
+        ROUNDS_SCHED(F2, K4, 60); ROUNDS_SCHED(F2, K4, 65);
+        ROUNDS_SCHED(F2, K4, 70); ROUNDS_SCHED(F2, K4, 75);
+
+        SA = ADD(SA, a); SB = ADD(SB, b); SC = ADD(SC, c);
+        SD = ADD(SD, d); SE = ADD(SE, e);
+
+        for (i = 0; i < 16; ++i)
+            ptr[i] += stride[i];
+    }
+
+    /* Keep the old digest in the inactive lanes */
+    _mm512_storeu_si512((void*)args->digest[0], _mm512_mask_mov_epi32(A0, LANES, SA));
+    _mm512_storeu_si512((void*)args->digest[1], _mm512_mask_mov_epi32(B0, LANES, SB));
+    _mm512_storeu_si512((void*)args->digest[2], _mm512_mask_mov_epi32(C0, LANES, SC));
+    _mm512_storeu_si512((void*)args->digest[3], _mm512_mask_mov_epi32(D0, LANES, SD));
+    _mm512_storeu_si512((void*)args->digest[4], _mm512_mask_mov_epi32(E0, LANES, SE));
+
+    for (i = 0; i < 16; ++i)
+    {
+        if ((mask >> i) & 1)
+            args->data[i] = ptr[i];
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state in every lane */
+    static const uint32_t iv[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    sha1_mb_args args;
+    unsigned int i, j;
+    for (i = 0; i < 5; ++i)
+        for (j = 0; j < 16; ++j)
+            args.digest[i][j] = iv[i];
+    for (j = 0; j < 16; ++j)
+        args.data[j] = message;
+
+    /* Lane 5 is inactive and keeps the initial state */
+    sha1_mb_avx512(&args, 0xFFDF, 1);
+
+    /* DA39A3EE5E6B4B0D... */
+    printf("SHA1 hash of empty message: %08X%08X...\n",
+        args.digest[0][0], args.digest[1][0]);
+
+    int success = 1;
+    for (j = 0; j < 16; ++j)
+    {
+        if (j == 5)
+            success &= (args.digest[0][j] == iv[0] && args.data[j] == message);
+        else
+            success &= (args.digest[0][j] == 0xDA39A3EE && args.digest[1][j] == 0x5E6B4B0D &&
+                        args.digest[4][j] == 0xAFD80709 && args.data[j] == message + 64);
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,339 @@
+/* sha1-mb.c - Job manager for the multi-buffer SHA-1 kernels */
+/*   Written and placed in public domain                        */
+
+/* The manager keeps one job per lane. A job runs in two segments:  */
+/* the whole blocks of the message, read in place, and then one or  */
+/* two padded blocks built in the lane's tail buffer. Each kernel   */
+/* call runs the smallest segment among the busy lanes, so no lane  */
+/* does wasted work. A finished lane is handed back and refilled by */
+/* the next submit.                                                 */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -c -mavx2 sha1-mb-avx2.c                                        */
+/* gcc -c -mavx512f -mavx512bw sha1-mb-avx512.c                        */
+/* gcc -DTEST_MAIN sha1-mb.c sha1-mb-avx2.o sha1-mb-avx512.o \         */
+/*     sha-ctx.o sha-dispatch.o <ISA objects> -o sha1-mb.exe           */
+
+#include <string.h>
+
+#include "sha1-mb.h"
+#include "sha-dispatch.h"
+
+enum { LANE_BODY, LANE_TAIL, LANE_DONE };
+
+static const uint32_t IV160[5] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v >>  0);
+}
+
+/* One lane at a time through the dispatched compress function */
+static void sha1_mb_single(sha1_mb_args* args, uint32_t mask, size_t blocks)
+{
+    unsigned int lane, i;
+    for (lane = 0; lane < SHA1_MB_MAX_LANES; ++lane)
+    {
+        if (((mask >> lane) & 1) == 0)
+            continue;
+
+        uint32_t state[5];
+        for (i = 0; i < 5; ++i)
+            state[i] = args->digest[i][lane];
+
+        size_t left = blocks;
+        while (left)
+        {
+            const size_t n = (left > (1 << 24)) ? (1 << 24) : left;
+            sha1_process_dispatch(state, args->data[lane], (uint32_t)(n * 64));
+            args->data[lane] += n * 64;
+            left -= n;
+        }
+
+        for (i = 0; i < 5; ++i)
+            args->digest[i][lane] = state[i];
+    }
+}
+
+int sha1_mb_init(sha1_mb_mgr* mgr, int kernel)
+{
+    const unsigned int features = sha_cpu_features();
+    memset(mgr, 0x00, sizeof(*mgr));
+
+    if (kernel == SHA1_MB_AUTO)
+    {
+        /* SHA-1 rounds are cheap, so the vector lanes outrun a  */
+        /*  single SHA-NI stream even on hosts that have SHA-NI. */
+        if (features & SHA_CPU_X86_AVX512)
+            kernel = SHA1_MB_AVX512;
+        else if (features & SHA_CPU_X86_AVX2)
+            kernel = SHA1_MB_AVX2;
+        else
+            kernel = SHA1_MB_SINGLE;
+    }
+
+    switch (kernel)
+    {
+#if defined(SHA_DISPATCH_X86)
+    case SHA1_MB_AVX2:
+        if (!(features & SHA_CPU_X86_AVX2))
+            return -1;
+        mgr->kernel = sha1_mb_avx2;
+        mgr->lanes = 8;
+        return 0;
+    case SHA1_MB_AVX512:
+        if (!(features & SHA_CPU_X86_AVX512))
+            return -1;
+        mgr->kernel = sha1_mb_avx512;
+        mgr->lanes = 16;
+        return 0;
+#endif
+    case SHA1_MB_SINGLE:
+        mgr->kernel = sha1_mb_single;
+        mgr->lanes = 1;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/* Pad the last partial block into the lane's tail buffer. */
+/*  Returns the number of tail blocks, 1 or 2.             */
+static size_t build_tail(uint8_t tail[128], const uint8_t* data, size_t length)
+{
+    const size_t rem = length % 64;
+    const size_t total = (rem < 56) ? 64 : 128;
+    const uint64_t bits = (uint64_t)length << 3;
+
+    if (rem)
+        memcpy(tail, data + (length - rem), rem);
+    memset(tail + rem, 0x00, total - rem);
+    tail[rem] = 0x80;
+    store_be32(tail + total - 8, (uint32_t)(bits >> 32));
+    store_be32(tail + total - 4, (uint32_t)(bits >>  0));
+
+    return total / 64;
+}
+
+static void lane_start(sha1_mb_mgr* mgr, unsigned int lane, sha1_mb_job* job)
+{
+    unsigned int i;
+    for (i = 0; i < 5; ++i)
+        mgr->args.digest[i][lane] = IV160[i];
+
+    mgr->job[lane] = job;
+    const size_t body = job->length / 64;
+    const size_t tail = build_tail(mgr->tail[lane], job->data, job->length);
+
+    if (body)
+    {
+        mgr->phase[lane] = LANE_BODY;
+        mgr->args.data[lane] = job->data;
+        mgr->blocks[lane] = body;
+    }
+    else
+    {
+        mgr->phase[lane] = LANE_TAIL;
+        mgr->args.data[lane] = mgr->tail[lane];
+        mgr->blocks[lane] = tail;
+    }
+}
+
+static void lane_finish(sha1_mb_mgr* mgr, unsigned int lane)
+{
+    sha1_mb_job* job = mgr->job[lane];
+    unsigned int i;
+    for (i = 0; i < 5; ++i)
+        store_be32(job->digest + 4*i, mgr->args.digest[i][lane]);
+    mgr->phase[lane] = LANE_DONE;
+}
+
+static uint32_t busy_lanes(const sha1_mb_mgr* mgr)
+{
+    uint32_t mask = 0;
+    unsigned int lane;
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] && mgr->phase[lane] != LANE_DONE)
+            mask |= (uint32_t)1 << lane;
+    }
+    return mask;
+}
+
+/* Run the kernel until at least one lane finishes */
+static void run_lanes(sha1_mb_mgr* mgr)
+{
+    int finished = 0;
+    while (!finished)
+    {
+        const uint32_t mask = busy_lanes(mgr);
+        unsigned int lane;
+        size_t blocks = 0;
+
+        if (mask == 0)
+            return;
+
+        for (lane = 0; lane < mgr->lanes; ++lane)
+        {
+            if (((mask >> lane) & 1) && (blocks == 0 || mgr->blocks[lane] < blocks))
+                blocks = mgr->blocks[lane];
+        }
+
+        mgr->kernel(&mgr->args, mask, blocks);
+
+        for (lane = 0; lane < mgr->lanes; ++lane)
+        {
+            if (((mask >> lane) & 1) == 0)
+                continue;
+            if ((mgr->blocks[lane] -= blocks) != 0)
+                continue;
+
+            if (mgr->phase[lane] == LANE_BODY)
+            {
+                const sha1_mb_job* job = mgr->job[lane];
+                mgr->phase[lane] = LANE_TAIL;
+                mgr->args.data[lane] = mgr->tail[lane];
+                mgr->blocks[lane] = ((job->length % 64) < 56) ? 1 : 2;
+            }
+            else
+            {
+                lane_finish(mgr, lane);
+                finished = 1;
+            }
+        }
+    }
+}
+
+static sha1_mb_job* take_finished(sha1_mb_mgr* mgr)
+{
+    unsigned int lane;
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] && mgr->phase[lane] == LANE_DONE)
+        {
+            sha1_mb_job* job = mgr->job[lane];
+            mgr->job[lane] = NULL;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+sha1_mb_job* sha1_mb_submit(sha1_mb_mgr* mgr, sha1_mb_job* job)
+{
+    unsigned int lane, free_lanes = 0;
+    int placed = 0;
+
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] != NULL)
+            continue;
+        if (!placed)
+        {
+            lane_start(mgr, lane, job);
+            placed = 1;
+        }
+        else
+            free_lanes++;
+    }
+
+    sha1_mb_job* done = take_finished(mgr);
+    if (done || free_lanes)
+        return done;
+
+    /* Every lane is busy. Run until one finishes. */
+    run_lanes(mgr);
+    return take_finished(mgr);
+}
+
+sha1_mb_job* sha1_mb_flush(sha1_mb_mgr* mgr)
+{
+    sha1_mb_job* done = take_finished(mgr);
+    if (done)
+        return done;
+
+    run_lanes(mgr);
+    return take_finished(mgr);
+}
+
+void sha1_mb_run(sha1_mb_mgr* mgr, sha1_mb_job jobs[], size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; ++i)
+        sha1_mb_submit(mgr, &jobs[i]);
+    while (sha1_mb_flush(mgr) != NULL)
+        continue;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sha-ctx.h"
+
+/* Hash 100 messages of mixed lengths and compare with sha1_ctx */
+static int test_kernel(int kernel, const char* name)
+{
+    enum { COUNT = 100 };
+    static uint8_t buffer[COUNT * 300];
+    static sha1_mb_job jobs[COUNT];
+    sha1_mb_mgr mgr;
+    unsigned int i, returned = 0;
+    int success = 1;
+
+    if (sha1_mb_init(&mgr, kernel) != 0)
+    {
+        printf("%s: not available\n", name);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(i * 7 + 3);
+
+    for (i = 0; i < COUNT; ++i)
+    {
+        jobs[i].length = (i * 37) % 300;
+        jobs[i].data = jobs[i].length ? buffer + i * 300 : NULL;
+        jobs[i].user = &jobs[i];
+
+        sha1_mb_job* job = sha1_mb_submit(&mgr, &jobs[i]);
+        if (job) returned++;
+    }
+    while (sha1_mb_flush(&mgr) != NULL)
+        returned++;
+
+    for (i = 0; i < COUNT; ++i)
+    {
+        uint8_t digest[20];
+        sha1_ctx ctx;
+        sha1_init(&ctx);
+        sha1_update(&ctx, jobs[i].data, jobs[i].length);
+        sha1_final(&ctx, digest);
+        success &= (memcmp(digest, jobs[i].digest, 20) == 0);
+    }
+    success &= (returned == COUNT);
+
+    printf("%s, %u lanes: %s\n", name, mgr.lanes, success ? "pass" : "fail");
+    return success;
+}
+
+int main(int argc, char* argv[])
+{
+    int success = 1;
+    success &= test_kernel(SHA1_MB_SINGLE, "single");
+    success &= test_kernel(SHA1_MB_AVX2, "avx2");
+    success &= test_kernel(SHA1_MB_AVX512, "avx512");
+    success &= test_kernel(SHA1_MB_AUTO, "auto");
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,88 @@
+/* sha1-mb.h - Multi-buffer SHA-1 over independent messages */
+/*   Written and placed in public domain                     */
+
+/* The multi-buffer kernels run the SHA-1 rounds on several        */
+/* messages at once, one message per 32-bit vector lane. The job   */
+/* manager fills the lanes, pads each message in its own lane and  */
+/* hands back jobs as they finish. It suits bulk hashing of many   */
+/* small messages, like git objects, where the per-call cost of a  */
+/* single-stream kernel dominates.                                 */
+
+#ifndef SHA1_MB_H
+#define SHA1_MB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHA1_MB_MAX_LANES 16
+
+/* Kernel arguments. The digest is transposed so word w of every */
+/*  lane is contiguous and loads straight into a vector.          */
+typedef struct sha1_mb_args
+{
+    uint32_t digest[5][SHA1_MB_MAX_LANES];
+    const uint8_t* data[SHA1_MB_MAX_LANES];
+} sha1_mb_args;
+
+/* Process blocks for the lanes set in mask. Lanes not in mask are  */
+/*  left untouched and their data pointer is not read. The data     */
+/*  pointers of the active lanes are advanced past the blocks.      */
+typedef void (*sha1_mb_fn)(sha1_mb_args* args, uint32_t mask, size_t blocks);
+
+void sha1_mb_avx2(sha1_mb_args* args, uint32_t mask, size_t blocks);
+void sha1_mb_avx512(sha1_mb_args* args, uint32_t mask, size_t blocks);
+
+typedef struct sha1_mb_job
+{
+    const uint8_t* data;   /* message, owned by the caller */
+    size_t length;         /* message length in bytes */
+    uint8_t digest[20];    /* set when the job is returned */
+    void* user;            /* caller's cookie */
+} sha1_mb_job;
+
+/* Kernel selection for sha1_mb_init */
+enum {
+    SHA1_MB_AUTO = 0,
+    SHA1_MB_SINGLE,   /* one message at a time through sha1_process_dispatch */
+    SHA1_MB_AVX2,
+    SHA1_MB_AVX512
+};
+
+typedef struct sha1_mb_mgr
+{
+    sha1_mb_args args;
+    sha1_mb_fn kernel;
+    unsigned int lanes;
+
+    sha1_mb_job* job[SHA1_MB_MAX_LANES];  /* NULL if the lane is free */
+    size_t blocks[SHA1_MB_MAX_LANES];       /* blocks left in the segment */
+    int phase[SHA1_MB_MAX_LANES];           /* body, tail or done */
+    uint8_t tail[SHA1_MB_MAX_LANES][128];   /* padded final blocks */
+} sha1_mb_mgr;
+
+/* Returns 0 on success, -1 if the requested kernel is not */
+/*  available on this host.                                */
+int sha1_mb_init(sha1_mb_mgr* mgr, int kernel);
+
+/* Submit a job. Returns a finished job, or NULL if no job has  */
+/*  finished yet. The returned job is not necessarily the one   */
+/*  just submitted.                                             */
+sha1_mb_job* sha1_mb_submit(sha1_mb_mgr* mgr, sha1_mb_job* job);
+
+/* Run the partially filled lanes. Returns a finished job, or NULL */
+/*  when the manager is empty. Call until it returns NULL.         */
+sha1_mb_job* sha1_mb_flush(sha1_mb_mgr* mgr);
+
+/* Hash a batch of jobs with the manager's kernel. Submits every */
+/*  job and flushes the manager.                                 */
+void sha1_mb_run(sha1_mb_mgr* mgr, sha1_mb_job jobs[], size_t count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA1_MB_H */
@@ -209,6 +209,328 @@ void sha1_process_x86(uint32_t state[5], const uint8_t data[], uint32_t length)
     state[4] = _mm_extract_epi32(E0, 3);
 }
 
+/* Process multiple blocks of two independent messages. The rounds of  */
+/*  the two messages are interleaved so one stream runs while the      */
+/*  other waits on sha1rnds4 latency. Both messages have the same      */
+/*  length. The caller is responsible for setting the initial states,  */
+/*  and the caller is responsible for padding the final blocks.        */
+void sha1_process_x86_x2(uint32_t state1[5], uint32_t state2[5],
+                         const uint8_t data1[], const uint8_t data2[], uint32_t length)
+{
+    __m128i ABCDA, ABCD_SAVEA, E0A, E0_SAVEA, E1A;
+    __m128i ABCDB, ABCD_SAVEB, E0B, E0_SAVEB, E1B;
+    __m128i MSG0A, MSG1A, MSG2A, MSG3A;
+    __m128i MSG0B, MSG1B, MSG2B, MSG3B;
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    /* Load initial values */
+    ABCDA = _mm_loadu_si128((const __m128i*) state1);
+    E0A = _mm_set_epi32(state1[4], 0, 0, 0);
+    ABCDA = _mm_shuffle_epi32(ABCDA, 0x1B);
+    ABCDB = _mm_loadu_si128((const __m128i*) state2);
+    E0B = _mm_set_epi32(state2[4], 0, 0, 0);
+    ABCDB = _mm_shuffle_epi32(ABCDB, 0x1B);
+
+    while (length >= 64)
+    {
+        /* Save current state  */
+        ABCD_SAVEA = ABCDA;
+        ABCD_SAVEB = ABCDB;
+        E0_SAVEA = E0A;
+        E0_SAVEB = E0B;
+
+        /* Rounds 0-3 */
+        MSG0A = _mm_loadu_si128((const __m128i*)(data1 + 0));
+        MSG0B = _mm_loadu_si128((const __m128i*)(data2 + 0));
+        MSG0A = _mm_shuffle_epi8(MSG0A, MASK);
+        MSG0B = _mm_shuffle_epi8(MSG0B, MASK);
+        E0A = _mm_add_epi32(E0A, MSG0A);
+        E0B = _mm_add_epi32(E0B, MSG0B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 0);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 0);
+
+        /* Rounds 4-7 */
+        MSG1A = _mm_loadu_si128((const __m128i*)(data1 + 16));
+        MSG1B = _mm_loadu_si128((const __m128i*)(data2 + 16));
+        MSG1A = _mm_shuffle_epi8(MSG1A, MASK);
+        MSG1B = _mm_shuffle_epi8(MSG1B, MASK);
+        E1A = _mm_sha1nexte_epu32(E1A, MSG1A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG1B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 0);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 0);
+        MSG0A = _mm_sha1msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha1msg1_epu32(MSG0B, MSG1B);
+
+        /* Rounds 8-11 */
+        MSG2A = _mm_loadu_si128((const __m128i*)(data1 + 32));
+        MSG2B = _mm_loadu_si128((const __m128i*)(data2 + 32));
+        MSG2A = _mm_shuffle_epi8(MSG2A, MASK);
+        MSG2B = _mm_shuffle_epi8(MSG2B, MASK);
+        E0A = _mm_sha1nexte_epu32(E0A, MSG2A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG2B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 0);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 0);
+        MSG1A = _mm_sha1msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha1msg1_epu32(MSG1B, MSG2B);
+        MSG0A = _mm_xor_si128(MSG0A, MSG2A);
+        MSG0B = _mm_xor_si128(MSG0B, MSG2B);
+
+        /* Rounds 12-15 */
+        MSG3A = _mm_loadu_si128((const __m128i*)(data1 + 48));
+        MSG3B = _mm_loadu_si128((const __m128i*)(data2 + 48));
+        MSG3A = _mm_shuffle_epi8(MSG3A, MASK);
+        MSG3B = _mm_shuffle_epi8(MSG3B, MASK);
+        E1A = _mm_sha1nexte_epu32(E1A, MSG3A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG3B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG0A = _mm_sha1msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha1msg2_epu32(MSG0B, MSG3B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 0);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 0);
+        MSG2A = _mm_sha1msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha1msg1_epu32(MSG2B, MSG3B);
+        MSG1A = _mm_xor_si128(MSG1A, MSG3A);
+        MSG1B = _mm_xor_si128(MSG1B, MSG3B);
+
+        /* Rounds 16-19 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG0A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG0B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG1A = _mm_sha1msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha1msg2_epu32(MSG1B, MSG0B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 0);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 0);
+        MSG3A = _mm_sha1msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha1msg1_epu32(MSG3B, MSG0B);
+        MSG2A = _mm_xor_si128(MSG2A, MSG0A);
+        MSG2B = _mm_xor_si128(MSG2B, MSG0B);
+
+        /* Rounds 20-23 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG1A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG1B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG2A = _mm_sha1msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha1msg2_epu32(MSG2B, MSG1B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 1);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 1);
+        MSG0A = _mm_sha1msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha1msg1_epu32(MSG0B, MSG1B);
+        MSG3A = _mm_xor_si128(MSG3A, MSG1A);
+        MSG3B = _mm_xor_si128(MSG3B, MSG1B);
+
+        /* Rounds 24-27 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG2A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG2B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG3A = _mm_sha1msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha1msg2_epu32(MSG3B, MSG2B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 1);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 1);
+        MSG1A = _mm_sha1msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha1msg1_epu32(MSG1B, MSG2B);
+        MSG0A = _mm_xor_si128(MSG0A, MSG2A);
+        MSG0B = _mm_xor_si128(MSG0B, MSG2B);
+
+        /* Rounds 28-31 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG3A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG3B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG0A = _mm_sha1msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha1msg2_epu32(MSG0B, MSG3B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 1);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 1);
+        MSG2A = _mm_sha1msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha1msg1_epu32(MSG2B, MSG3B);
+        MSG1A = _mm_xor_si128(MSG1A, MSG3A);
+        MSG1B = _mm_xor_si128(MSG1B, MSG3B);
+
+        /* Rounds 32-35 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG0A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG0B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG1A = _mm_sha1msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha1msg2_epu32(MSG1B, MSG0B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 1);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 1);
+        MSG3A = _mm_sha1msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha1msg1_epu32(MSG3B, MSG0B);
+        MSG2A = _mm_xor_si128(MSG2A, MSG0A);
+        MSG2B = _mm_xor_si128(MSG2B, MSG0B);
+
+        /* Rounds 36-39 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG1A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG1B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG2A = _mm_sha1msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha1msg2_epu32(MSG2B, MSG1B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 1);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 1);
+        MSG0A = _mm_sha1msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha1msg1_epu32(MSG0B, MSG1B);
+        MSG3A = _mm_xor_si128(MSG3A, MSG1A);
+        MSG3B = _mm_xor_si128(MSG3B, MSG1B);
+
+        /* Rounds 40-43 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG2A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG2B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG3A = _mm_sha1msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha1msg2_epu32(MSG3B, MSG2B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 2);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 2);
+        MSG1A = _mm_sha1msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha1msg1_epu32(MSG1B, MSG2B);
+        MSG0A = _mm_xor_si128(MSG0A, MSG2A);
+        MSG0B = _mm_xor_si128(MSG0B, MSG2B);
+
+        /* Rounds 44-47 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG3A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG3B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG0A = _mm_sha1msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha1msg2_epu32(MSG0B, MSG3B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 2);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 2);
+        MSG2A = _mm_sha1msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha1msg1_epu32(MSG2B, MSG3B);
+        MSG1A = _mm_xor_si128(MSG1A, MSG3A);
+        MSG1B = _mm_xor_si128(MSG1B, MSG3B);
+
+        /* Rounds 48-51 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG0A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG0B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG1A = _mm_sha1msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha1msg2_epu32(MSG1B, MSG0B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 2);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 2);
+        MSG3A = _mm_sha1msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha1msg1_epu32(MSG3B, MSG0B);
+        MSG2A = _mm_xor_si128(MSG2A, MSG0A);
+        MSG2B = _mm_xor_si128(MSG2B, MSG0B);
+
+        /* Rounds 52-55 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG1A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG1B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG2A = _mm_sha1msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha1msg2_epu32(MSG2B, MSG1B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 2);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 2);
+        MSG0A = _mm_sha1msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha1msg1_epu32(MSG0B, MSG1B);
+        MSG3A = _mm_xor_si128(MSG3A, MSG1A);
+        MSG3B = _mm_xor_si128(MSG3B, MSG1B);
+
+        /* Rounds 56-59 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG2A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG2B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG3A = _mm_sha1msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha1msg2_epu32(MSG3B, MSG2B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 2);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 2);
+        MSG1A = _mm_sha1msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha1msg1_epu32(MSG1B, MSG2B);
+        MSG0A = _mm_xor_si128(MSG0A, MSG2A);
+        MSG0B = _mm_xor_si128(MSG0B, MSG2B);
+
+        /* Rounds 60-63 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG3A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG3B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG0A = _mm_sha1msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha1msg2_epu32(MSG0B, MSG3B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 3);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 3);
+        MSG2A = _mm_sha1msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha1msg1_epu32(MSG2B, MSG3B);
+        MSG1A = _mm_xor_si128(MSG1A, MSG3A);
+        MSG1B = _mm_xor_si128(MSG1B, MSG3B);
+
+        /* Rounds 64-67 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG0A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG0B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG1A = _mm_sha1msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha1msg2_epu32(MSG1B, MSG0B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 3);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 3);
+        MSG3A = _mm_sha1msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha1msg1_epu32(MSG3B, MSG0B);
+        MSG2A = _mm_xor_si128(MSG2A, MSG0A);
+        MSG2B = _mm_xor_si128(MSG2B, MSG0B);
+
+        /* Rounds 68-71 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG1A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG1B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        MSG2A = _mm_sha1msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha1msg2_epu32(MSG2B, MSG1B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 3);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 3);
+        MSG3A = _mm_xor_si128(MSG3A, MSG1A);
+        MSG3B = _mm_xor_si128(MSG3B, MSG1B);
+
+        /* Rounds 72-75 */
+        E0A = _mm_sha1nexte_epu32(E0A, MSG2A);
+        E0B = _mm_sha1nexte_epu32(E0B, MSG2B);
+        E1A = ABCDA;
+        E1B = ABCDB;
+        MSG3A = _mm_sha1msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha1msg2_epu32(MSG3B, MSG2B);
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E0A, 3);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E0B, 3);
+
+        /* Rounds 76-79 */
+        E1A = _mm_sha1nexte_epu32(E1A, MSG3A);
+        E1B = _mm_sha1nexte_epu32(E1B, MSG3B);
+        E0A = ABCDA;
+        E0B = ABCDB;
+        ABCDA = _mm_sha1rnds4_epu32(ABCDA, E1A, 3);
+        ABCDB = _mm_sha1rnds4_epu32(ABCDB, E1B, 3);
+
+        /* Combine state */
+        E0A = _mm_sha1nexte_epu32(E0A, E0_SAVEA);
+        E0B = _mm_sha1nexte_epu32(E0B, E0_SAVEB);
+        ABCDA = _mm_add_epi32(ABCDA, ABCD_SAVEA);
+        ABCDB = _mm_add_epi32(ABCDB, ABCD_SAVEB);
+
+        data1 += 64;
+        data2 += 64;
+        length -= 64;
+    }
+
+    /* Save state */
+    ABCDA = _mm_shuffle_epi32(ABCDA, 0x1B);
+    _mm_storeu_si128((__m128i*) state1, ABCDA);
+    state1[4] = _mm_extract_epi32(E0A, 3);
+    ABCDB = _mm_shuffle_epi32(ABCDB, 0x1B);
+    _mm_storeu_si128((__m128i*) state2, ABCDB);
+    state2[4] = _mm_extract_epi32(E0B, 3);
+}
+
 #if defined(TEST_MAIN)
 
 #include <stdio.h>
@@ -242,6 +564,38 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xDA) && (b2 == 0x39) && (b3 == 0xA3) && (b4 == 0xEE) &&
                     (b5 == 0x5E) && (b6 == 0x6B) && (b7 == 0x4B) && (b8 == 0x0D));
 
+    /* Two streams. The second message is three blocks of filler */
+    /*  and its result must match the single stream kernel.       */
+    uint8_t filler[192];
+    unsigned int i;
+    for (i = 0; i < sizeof(filler); ++i)
+        filler[i] = (uint8_t)(i * 13 + 1);
+
+    uint8_t triple[192];
+    memcpy(triple, message, 64);
+    memcpy(triple+64, message, 64);
+    memcpy(triple+128, message, 64);
+
+    uint32_t x2_state1[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+    uint32_t x2_state2[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+    uint32_t ref_state[5] = {
+        0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+    };
+
+    sha1_process_x86_x2(x2_state1, x2_state2, triple, filler, sizeof(filler));
+    sha1_process_x86(ref_state, filler, sizeof(filler));
+    success = success && (memcmp(x2_state2, ref_state, sizeof(ref_state)) == 0);
+
+    memcpy(ref_state, x2_state1, sizeof(ref_state));
+    memcpy(x2_state1, state, sizeof(x2_state1));
+    sha1_process_x86(x2_state1, message, 64);
+    sha1_process_x86(x2_state1, message, 64);
+    success = success && (memcmp(x2_state1, ref_state, sizeof(ref_state)) == 0);
+
     if (success)
         printf("Success!\n");
     else
@@ -0,0 +1,164 @@
+/* sha1.c - SHA reference implementation using C              */
+/*   Written and placed in public domain                      */
+
+/* The round loop is fully unrolled and the working variables  */
+/* are renamed rather than moved. The message schedule is a    */
+/* 16-word circular buffer and words are loaded with a byte    */
+/* swap where the compiler provides one.                       */
+
+/* xlc -DTEST_MAIN sha1.c -o sha1.exe           */
+/* gcc -DTEST_MAIN -std=c99 sha1.c -o sha1.exe  */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+# include <stdlib.h>
+#endif
+
+static inline uint32_t load_be32(const uint8_t* p)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+#elif defined(_MSC_VER)
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return _byteswap_ulong(v);
+#else
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] <<  8) | ((uint32_t)p[3] <<  0);
+#endif
+}
+
+#define ROTL(x,y)    (((x)<<(y)) | ((x)>>(32-(y))))
+
+#define F1(x,y,z)    ((((y) ^ (z)) & (x)) ^ (z))
+#define F2(x,y,z)    ((x) ^ (y) ^ (z))
+#define F3(x,y,z)    ((((x) | (y)) & (z)) | ((x) & (y)))
+#define F4(x,y,z)    ((x) ^ (y) ^ (z))
+
+/* Next word of the circular message schedule */
+#define BLK(i)       (X[(i)&15] = ROTL(X[((i)+13)&15] ^ X[((i)+8)&15] ^ X[((i)+2)&15] ^ X[(i)&15], 1))
+
+#define R0(v,w,x,y,z,i) z += F1(w,x,y) + (X[i] = load_be32(data + 4*(i))) + 0x5A827999 + ROTL(v,5); w = ROTL(w,30);
+#define R1(v,w,x,y,z,i) z += F1(w,x,y) + BLK(i) + 0x5A827999 + ROTL(v,5); w = ROTL(w,30);
+#define R2(v,w,x,y,z,i) z += F2(w,x,y) + BLK(i) + 0x6ED9EBA1 + ROTL(v,5); w = ROTL(w,30);
+#define R3(v,w,x,y,z,i) z += F3(w,x,y) + BLK(i) + 0x8F1BBCDC + ROTL(v,5); w = ROTL(w,30);
+#define R4(v,w,x,y,z,i) z += F4(w,x,y) + BLK(i) + 0xCA62C1D6 + ROTL(v,5); w = ROTL(w,30);
+
+/* Process multiple blocks. The caller is responsible for setting the initial */
+/*  state, and the caller is responsible for padding the final block.        */
+void sha1_process(uint32_t state[5], const uint8_t data[], uint32_t length)
+{
+    uint32_t a, b, c, d, e;
+    uint32_t X[16];
+
+    while (length >= 64)
+    {
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+
+        /* Rounds 0-15 */
+        R0(a,b,c,d,e, 0); R0(e,a,b,c,d, 1); R0(d,e,a,b,c, 2); R0(c,d,e,a,b, 3);
+        R0(b,c,d,e,a, 4); R0(a,b,c,d,e, 5); R0(e,a,b,c,d, 6); R0(d,e,a,b,c, 7);
+        R0(c,d,e,a,b, 8); R0(b,c,d,e,a, 9); R0(a,b,c,d,e,10); R0(e,a,b,c,d,11);
+        R0(d,e,a,b,c,12); R0(c,d,e,a,b,13); R0(b,c,d,e,a,14); R0(a,b,c,d,e,15);
+
+        /* Rounds 16-19 */
+        R1(e,a,b,c,d,16); R1(d,e,a,b,c,17); R1(c,d,e,a,b,18); R1(b,c,d,e,a,19);
+
+        /* Rounds 20-39 */
+        R2(a,b,c,d,e,20); R2(e,a,b,c,d,21); R2(d,e,a,b,c,22); R2(c,d,e,a,b,23);
+        R2(b,c,d,e,a,24); R2(a,b,c,d,e,25); R2(e,a,b,c,d,26); R2(d,e,a,b,c,27);
+        R2(c,d,e,a,b,28); R2(b,c,d,e,a,29); R2(a,b,c,d,e,30); R2(e,a,b,c,d,31);
+        R2(d,e,a,b,c,32); R2(c,d,e,a,b,33); R2(b,c,d,e,a,34); R2(a,b,c,d,e,35);
+        R2(e,a,b,c,d,36); R2(d,e,a,b,c,37); R2(c,d,e,a,b,38); R2(b,c,d,e,a,39);
+
+        /* Rounds 40-59 */
+        R3(a,b,c,d,e,40); R3(e,a,b,c,d,41); R3(d,e,a,b,c,42); R3(c,d,e,a,b,43);
+        R3(b,c,d,e,a,44); R3(a,b,c,d,e,45); R3(e,a,b,c,d,46); R3(d,e,a,b,c,47);
+        R3(c,d,e,a,b,48); R3(b,c,d,e,a,49); R3(a,b,c,d,e,50); R3(e,a,b,c,d,51);
+        R3(d,e,a,b,c,52); R3(c,d,e,a,b,53); R3(b,c,d,e,a,54); R3(a,b,c,d,e,55);
+        R3(e,a,b,c,d,56); R3(d,e,a,b,c,57); R3(c,d,e,a,b,58); R3(b,c,d,e,a,59);
+
+        /* Rounds 60-79 */
+        R4(a,b,c,d,e,60); R4(e,a,b,c,d,61); R4(d,e,a,b,c,62); R4(c,d,e,a,b,63);
+        R4(b,c,d,e,a,64); R4(a,b,c,d,e,65); R4(e,a,b,c,d,66); R4(d,e,a,b,c,67);
+        R4(c,d,e,a,b,68); R4(b,c,d,e,a,69); R4(a,b,c,d,e,70); R4(e,a,b,c,d,71);
+        R4(d,e,a,b,c,72); R4(c,d,e,a,b,73); R4(b,c,d,e,a,74); R4(a,b,c,d,e,75);
+        R4(e,a,b,c,d,76); R4(d,e,a,b,c,77); R4(c,d,e,a,b,78); R4(b,c,d,e,a,79);
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+
+        data += 64;
+        length -= 64;
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state */
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    sha1_process(state, message, sizeof(message));
+
+    const uint8_t b1 = (uint8_t)(state[0] >> 24);
+    const uint8_t b2 = (uint8_t)(state[0] >> 16);
+    const uint8_t b3 = (uint8_t)(state[0] >>  8);
+    const uint8_t b4 = (uint8_t)(state[0] >>  0);
+    const uint8_t b5 = (uint8_t)(state[1] >> 24);
+    const uint8_t b6 = (uint8_t)(state[1] >> 16);
+    const uint8_t b7 = (uint8_t)(state[1] >>  8);
+    const uint8_t b8 = (uint8_t)(state[1] >>  0);
+
+    /* DA39A3EE5E6B4B0D... */
+    printf("SHA1 hash of empty message: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        b1, b2, b3, b4, b5, b6, b7, b8);
+
+    int success = ((b1 == 0xDA) && (b2 == 0x39) && (b3 == 0xA3) && (b4 == 0xEE) &&
+                    (b5 == 0x5E) && (b6 == 0x6B) && (b7 == 0x4B) && (b8 == 0x0D));
+
+    /* "abc" with padding, a9993e364706816a... */
+    memset(message, 0x00, sizeof(message));
+    message[0] = 'a'; message[1] = 'b'; message[2] = 'c';
+    message[3] = 0x80;
+    message[63] = 24;
+
+    uint32_t state2[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    sha1_process(state2, message, sizeof(message));
+    success = success && (state2[0] == 0xA9993E36) && (state2[1] == 0x4706816A) &&
+        (state2[2] == 0xBA3E2571) && (state2[3] == 0x7850C26C) && (state2[4] == 0x9CD0D89D);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,376 @@
+/* sha2-generic.hxx - One C++ source for every SHA-2 variant */
+/*   Written and placed in public domain                    */
+
+/* sha256.c and sha512.c are the same algorithm written twice, and  */
+/* the Power8 files write it twice more. This header writes it      */
+/* once. The engine is a template over                              */
+/*                                                                  */
+/*   Traits   word type, round count, rotation amounts, K table     */
+/*   Backend  rotate, Ch, Maj and big-endian loads                  */
+/*   Unroll   unroll_full or unroll_8                               */
+/*                                                                  */
+/* and the variants, SHA-224, SHA-256, SHA-384, SHA-512 and         */
+/* SHA-512/t, add only their initial values and digest sizes. A new */
+/* backend or round schedule lands in one place for all of them.    */
+
+/* With unroll_full every round is expanded at compile time. The     */
+/* working variables are not rotated; round R reads them at indexes  */
+/* (i - R) mod 8, which are constants, so the compiler keeps them in */
+/* registers. unroll_8 loops over groups of eight rounds. It is a    */
+/* quarter of the code size, and with GCC it runs at about the same  */
+/* speed.                                                            */
+
+/* The round constants come from sha-constexpr.hxx. Requires C++14. */
+
+#ifndef SHA2_GENERIC_HXX
+#define SHA2_GENERIC_HXX
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+#include "sha-constexpr.hxx"
+
+#if defined(_MSC_VER)
+# define SHA2_INLINE __forceinline
+#else
+# define SHA2_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace sha2 {
+
+struct sha256_traits
+{
+    typedef uint32_t word;
+    enum { rounds = 64, block_size = 64, length_size = 8 };
+    enum { S0a = 2, S0b = 13, S0c = 22, S1a = 6, S1b = 11, S1c = 25 };
+    enum { s0a = 7, s0b = 18, s0c = 3, s1a = 17, s1b = 19, s1c = 10 };
+    static constexpr const uint32_t* K() { return sha_constexpr::detail::tables<>::K256; }
+};
+
+struct sha512_traits
+{
+    typedef uint64_t word;
+    enum { rounds = 80, block_size = 128, length_size = 16 };
+    enum { S0a = 28, S0b = 34, S0c = 39, S1a = 14, S1b = 18, S1c = 41 };
+    enum { s0a = 1, s0b = 8, s0c = 7, s1a = 19, s1b = 61, s1c = 6 };
+    static constexpr const uint64_t* K() { return sha_constexpr::detail::tables<>::K512; }
+};
+
+// Portable C++. A backend for another ISA provides the same members.
+struct scalar_backend
+{
+    template <class W>
+    static SHA2_INLINE W rotr(W x, unsigned int n)
+    {
+        return static_cast<W>((x >> n) | (x << (8 * sizeof(W) - n)));
+    }
+
+    template <class W>
+    static SHA2_INLINE W ch(W e, W f, W g) { return g ^ (e & (f ^ g)); }
+
+    template <class W>
+    static SHA2_INLINE W maj(W a, W b, W c) { return (a & b) | (c & (a | b)); }
+
+    template <class W>
+    static SHA2_INLINE W load_be(const uint8_t* p)
+    {
+        W w = 0;
+        for (size_t i = 0; i < sizeof(W); ++i)
+            w = static_cast<W>((w << 8) | p[i]);
+        return w;
+    }
+};
+
+struct unroll_full {};
+struct unroll_8 {};
+
+template <class Traits, class Backend = scalar_backend, class Unroll = unroll_full>
+struct engine
+{
+    typedef typename Traits::word word;
+    typedef Backend B;
+
+    // Compress blocks whole blocks into state
+    static void compress(word state[8], const uint8_t* data, size_t blocks)
+    {
+        while (blocks--)
+        {
+            word T[8], W[16];
+            for (unsigned int i = 0; i < 8; ++i)
+                T[i] = state[i];
+
+            run(T, W, data, Unroll());
+
+            for (unsigned int i = 0; i < 8; ++i)
+                state[i] += T[i];
+            data += Traits::block_size;
+        }
+    }
+
+private:
+    static SHA2_INLINE word Sigma0(word x)
+    {
+        return B::rotr(x, Traits::S0a) ^ B::rotr(x, Traits::S0b) ^ B::rotr(x, Traits::S0c);
+    }
+    static SHA2_INLINE word Sigma1(word x)
+    {
+        return B::rotr(x, Traits::S1a) ^ B::rotr(x, Traits::S1b) ^ B::rotr(x, Traits::S1c);
+    }
+    static SHA2_INLINE word sigma0(word x)
+    {
+        return B::rotr(x, Traits::s0a) ^ B::rotr(x, Traits::s0b) ^ (x >> Traits::s0c);
+    }
+    static SHA2_INLINE word sigma1(word x)
+    {
+        return B::rotr(x, Traits::s1a) ^ B::rotr(x, Traits::s1b) ^ (x >> Traits::s1c);
+    }
+
+    // Round R. The working variables are addressed by I, which equals
+    //   R mod 8 and is a constant under both unroll policies.
+    static SHA2_INLINE void round(word T[8], word W[16], const uint8_t* data,
+                                  unsigned int I, unsigned int R)
+    {
+        word& w = W[R & 15];
+        if (R < 16)
+            w = B::template load_be<word>(data + sizeof(word) * R);
+        else
+            w += sigma1(W[(R - 2) & 15]) + W[(R - 7) & 15] + sigma0(W[(R - 15) & 15]);
+
+        const word a = T[(0 - I) & 7], b = T[(1 - I) & 7], c = T[(2 - I) & 7];
+        word& d = T[(3 - I) & 7];
+        const word e = T[(4 - I) & 7], f = T[(5 - I) & 7], g = T[(6 - I) & 7];
+        word& h = T[(7 - I) & 7];
+
+        h += Sigma1(e) + B::ch(e, f, g) + Traits::K()[R] + w;
+        d += h;
+        h += Sigma0(a) + B::maj(a, b, c);
+    }
+
+    template <size_t... R>
+    static SHA2_INLINE void rounds(word T[8], word W[16], const uint8_t* data,
+                                   std::index_sequence<R...>)
+    {
+        // Braced initializers are evaluated in order
+        const int order[] = { (round(T, W, data, R & 7, R), 0)... };
+        (void)order;
+    }
+
+    template <size_t... I>
+    static SHA2_INLINE void group(word T[8], word W[16], const uint8_t* data, unsigned int base,
+                                  std::index_sequence<I...>)
+    {
+        const int order[] = { (round(T, W, data, I, base + I), 0)... };
+        (void)order;
+    }
+
+    static SHA2_INLINE void run(word T[8], word W[16], const uint8_t* data, unroll_full)
+    {
+        rounds(T, W, data, std::make_index_sequence<Traits::rounds>());
+    }
+
+    static SHA2_INLINE void run(word T[8], word W[16], const uint8_t* data, unroll_8)
+    {
+        for (unsigned int base = 0; base < Traits::rounds; base += 8)
+            group(T, W, data, base, std::make_index_sequence<8>());
+    }
+};
+
+// The variants: core traits, digest size and initial value
+
+struct sha224
+{
+    typedef sha256_traits core;
+    enum { digest_size = 28 };
+    static void iv(uint32_t s[8])
+    {
+        static const uint32_t v[8] = {
+            0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+            0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+        };
+        memcpy(s, v, sizeof(v));
+    }
+};
+
+struct sha256
+{
+    typedef sha256_traits core;
+    enum { digest_size = 32 };
+    static void iv(uint32_t s[8])
+    {
+        static const uint32_t v[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        memcpy(s, v, sizeof(v));
+    }
+};
+
+struct sha384
+{
+    typedef sha512_traits core;
+    enum { digest_size = 48 };
+    static void iv(uint64_t s[8])
+    {
+        static const uint64_t v[8] = {
+            0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+            0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4
+        };
+        memcpy(s, v, sizeof(v));
+    }
+};
+
+struct sha512
+{
+    typedef sha512_traits core;
+    enum { digest_size = 64 };
+    static void iv(uint64_t s[8])
+    {
+        static const uint64_t v[8] = {
+            0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+            0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+        };
+        memcpy(s, v, sizeof(v));
+    }
+};
+
+template <class Variant, class Backend = scalar_backend, class Unroll = unroll_full>
+class hasher
+{
+public:
+    typedef typename Variant::core core;
+    typedef typename core::word word;
+    enum { digest_size = Variant::digest_size, block_size = core::block_size };
+
+    hasher() { init(); }
+
+    void init()
+    {
+        Variant::iv(m_state);
+        m_length = 0;
+        m_used = 0;
+    }
+
+    void update(const void* input, size_t length)
+    {
+        const uint8_t* data = static_cast<const uint8_t*>(input);
+        m_length += length;
+
+        if (m_used)
+        {
+            const size_t n = (length < block_size - m_used) ? length : block_size - m_used;
+            memcpy(m_buffer + m_used, data, n);
+            m_used += n; data += n; length -= n;
+            if (m_used < block_size)
+                return;
+            compress(m_buffer, 1);
+            m_used = 0;
+        }
+
+        if (length >= block_size)
+        {
+            compress(data, length / block_size);
+            data += length / block_size * block_size;
+            length %= block_size;
+        }
+
+        memcpy(m_buffer, data, length);
+        m_used = length;
+    }
+
+    void final(uint8_t digest[])
+    {
+        const uint64_t bits = m_length << 3;
+        uint8_t tail[2 * block_size];
+        const size_t total = (m_used < block_size - core::length_size) ? block_size : 2 * block_size;
+
+        memcpy(tail, m_buffer, m_used);
+        memset(tail + m_used, 0x00, total - m_used);
+        tail[m_used] = 0x80;
+        // SHA-384 and SHA-512 have a 128-bit length field
+        if (core::length_size > 8)
+            tail[total - 9] = static_cast<uint8_t>(m_length >> 61);
+        for (size_t i = 0; i < 8; ++i)
+            tail[total - 1 - i] = static_cast<uint8_t>(bits >> (8 * i));
+        compress(tail, total / block_size);
+
+        for (size_t i = 0; i < digest_size; ++i)
+            digest[i] = static_cast<uint8_t>(m_state[i / sizeof(word)] >> (8 * (sizeof(word) - 1 - i % sizeof(word))));
+        init();
+    }
+
+    static void hash(uint8_t digest[], const void* data, size_t length)
+    {
+        hasher h;
+        h.update(data, length);
+        h.final(digest);
+    }
+
+private:
+    void compress(const uint8_t* data, size_t blocks)
+    {
+        engine<core, Backend, Unroll>::compress(m_state, data, blocks);
+    }
+
+    word m_state[8];
+    uint8_t m_buffer[block_size];
+    uint64_t m_length;
+    size_t m_used;
+};
+
+// SHA-512/t from FIPS 180-4, section 5.3.6. The initial value is
+//   SHA-512 of "SHA-512/t" with a modified IV, computed once by the
+//   same engine.
+template <unsigned int T>
+struct sha512_t
+{
+    static_assert(T > 0 && T < 512 && T % 8 == 0 && T != 384, "SHA-512/t: bad t");
+
+    typedef sha512_traits core;
+    enum { digest_size = T / 8 };
+
+    static void iv(uint64_t s[8])
+    {
+        static const generated g;
+        memcpy(s, g.v, sizeof(g.v));
+    }
+
+private:
+    struct modified
+    {
+        typedef sha512_traits core;
+        enum { digest_size = 64 };
+        static void iv(uint64_t s[8])
+        {
+            sha512::iv(s);
+            for (unsigned int i = 0; i < 8; ++i)
+                s[i] ^= 0xa5a5a5a5a5a5a5a5;
+        }
+    };
+
+    struct generated
+    {
+        uint64_t v[8];
+        generated()
+        {
+            char name[16] = "SHA-512/";
+            size_t n = 8;
+            if (T >= 100) name[n++] = static_cast<char>('0' + T / 100);
+            if (T >= 10)  name[n++] = static_cast<char>('0' + T / 10 % 10);
+            name[n++] = static_cast<char>('0' + T % 10);
+
+            uint8_t d[64];
+            hasher<modified>::hash(d, name, n);
+            for (unsigned int i = 0; i < 8; ++i)
+                v[i] = scalar_backend::load_be<uint64_t>(d + 8 * i);
+        }
+    };
+};
+
+typedef sha512_t<224> sha512_224;
+typedef sha512_t<256> sha512_256;
+
+}  // namespace sha2
+
+#endif  // SHA2_GENERIC_HXX
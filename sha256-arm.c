@@ -46,9 +46,40 @@ static const uint32_t K[] =
     0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
 };
 
-/* Process multiple blocks. The caller is responsible for setting the initial */
-/*  state, and the caller is responsible for padding the final block.        */
-void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length)
+/* K+W for the padding block of a 64-byte message. That block  */
+/*  is the same for every 64-byte message, so its whole message */
+/*  schedule is folded into the round constants.                */
+static const uint32_t KW_PAD64[] =
+{
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
+#if defined(_MSC_VER)
+# define SHA_FORCE_INLINE __forceinline
+#else
+# define SHA_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+/* The rounds. Byte input is big-endian and is reversed into words;  */
+/*  word input is already in host order. The callers pass a constant */
+/*  swap, so each gets its own copy without the test.                */
+static SHA_FORCE_INLINE void sha256_arm_blocks(uint32_t state[8], const uint8_t data[],
+                                               uint32_t length, const int swap)
 {
     uint32x4_t STATE0, STATE1, ABEF_SAVE, CDGH_SAVE;
     uint32x4_t MSG0, MSG1, MSG2, MSG3;
@@ -71,10 +102,13 @@ void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length
         MSG3 = vld1q_u32((const uint32_t *)(data + 48));
 
         /* Reverse for little endian */
-        MSG0 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG0)));
-        MSG1 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG1)));
-        MSG2 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG2)));
-        MSG3 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG3)));
+        if (swap)
+        {
+            MSG0 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG0)));
+            MSG1 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG1)));
+            MSG2 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG2)));
+            MSG3 = vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(MSG3)));
+        }
 
         TMP0 = vaddq_u32(MSG0, vld1q_u32(&K[0x00]));
 
@@ -210,6 +244,61 @@ void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length
     vst1q_u32(&state[4], STATE1);
 }
 
+/* Process multiple blocks. The caller is responsible for setting the initial */
+/*  state, and the caller is responsible for padding the final block.        */
+void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length)
+{
+    sha256_arm_blocks(state, data, length, 1);
+}
+
+/* Process multiple blocks given as host-order message words, like */
+/*  digests kept in word form. No byte reversal on the message.    */
+void sha256_process_words_arm(uint32_t state[8], const uint32_t data[], uint32_t length)
+{
+    sha256_arm_blocks(state, (const uint8_t*) data, length, 0);
+}
+
+/* SHA-256 of exactly 64 bytes, like two child digests. The first */
+/*  block is the message and the second block runs rounds only.  */
+void sha256_64_arm(uint8_t digest[32], const uint8_t data[64])
+{
+    uint32x4_t STATE0, STATE1, ABEF_SAVE, CDGH_SAVE;
+    uint32x4_t TMP0, TMP2;
+    unsigned int i;
+
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_process_arm(state, data, 64);
+
+    /* Load state */
+    STATE0 = vld1q_u32(&state[0]);
+    STATE1 = vld1q_u32(&state[4]);
+
+    /* Save state */
+    ABEF_SAVE = STATE0;
+    CDGH_SAVE = STATE1;
+
+    /* Padding block, no message schedule */
+    for (i = 0; i < 16; ++i)
+    {
+        TMP2 = STATE0;
+        TMP0 = vld1q_u32(&KW_PAD64[4*i]);
+        STATE0 = vsha256hq_u32(STATE0, STATE1, TMP0);
+        STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP0);
+    }
+
+    /* Combine state */
+    STATE0 = vaddq_u32(STATE0, ABEF_SAVE);
+    STATE1 = vaddq_u32(STATE1, CDGH_SAVE);
+
+    /* Save digest */
+    vst1q_u8(&digest[0], vrev32q_u8(vreinterpretq_u8_u32(STATE0)));
+    vst1q_u8(&digest[16], vrev32q_u8(vreinterpretq_u8_u32(STATE1)));
+}
+
 #if defined(TEST_MAIN)
 
 #include <stdio.h>
@@ -246,6 +335,52 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xE3) && (b2 == 0xB0) && (b3 == 0xC4) && (b4 == 0x42) &&
                     (b5 == 0x98) && (b6 == 0xFC) && (b7 == 0x1C) && (b8 == 0x14));
 
+    /* A 64-byte message through the specialized kernel must match */
+    /*  the message and its padding block through the generic one. */
+    uint8_t blocks[128], digest[32];
+    unsigned int i;
+    for (i = 0; i < 64; ++i)
+        blocks[i] = (uint8_t)(i * 29 + 7);
+    memset(blocks + 64, 0x00, 64);
+    blocks[64] = 0x80;
+    blocks[126] = 0x02;
+
+    uint32_t ref_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_process_arm(ref_state, blocks, sizeof(blocks));
+    sha256_64_arm(digest, blocks);
+    for (i = 0; i < 8; ++i)
+    {
+        success = success && (digest[4*i+0] == (uint8_t)(ref_state[i] >> 24));
+        success = success && (digest[4*i+1] == (uint8_t)(ref_state[i] >> 16));
+        success = success && (digest[4*i+2] == (uint8_t)(ref_state[i] >>  8));
+        success = success && (digest[4*i+3] == (uint8_t)(ref_state[i] >>  0));
+    }
+
+    /* The same blocks as host-order words */
+    uint32_t words[32];
+    uint32_t words_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    for (i = 0; i < 32; ++i)
+        words[i] = ((uint32_t)blocks[4*i+0] << 24) | ((uint32_t)blocks[4*i+1] << 16) |
+                   ((uint32_t)blocks[4*i+2] <<  8) | ((uint32_t)blocks[4*i+3] <<  0);
+    sha256_process_words_arm(words_state, words, sizeof(words));
+    success = success && (memcmp(words_state, ref_state, sizeof(ref_state)) == 0);
+
+    /* f5a5fd42d16a2030... */
+    memset(blocks, 0x00, 64);
+    sha256_64_arm(digest, blocks);
+    printf("SHA256 hash of 64 zero bytes: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        digest[0], digest[1], digest[2], digest[3],
+        digest[4], digest[5], digest[6], digest[7]);
+    success = success && (digest[0] == 0xF5) && (digest[1] == 0xA5) &&
+                         (digest[2] == 0xFD) && (digest[3] == 0x42);
+
     if (success)
         printf("Success!\n");
     else
@@ -0,0 +1,224 @@
+/* sha256-bmi2.c - SHA-256 in general purpose registers using BMI2 */
+/*   Written and placed in public domain                           */
+
+/* A scalar kernel for x86 hosts without SHA extensions. BMI2 rorx  */
+/* rotates into a new register without touching the flags, so each  */
+/* Sigma is three rorx and two xor instead of copies and rotates.    */
+/* GCC and Clang emit rorx for ROTR when compiled with -mbmi2. The   */
+/* rounds rename the working variables instead of moving them, and   */
+/* Maj reuses a ^ b from the previous round, where it was b ^ c.     */
+
+/* gcc -DTEST_MAIN -mbmi2 sha256-bmi2.c -o sha256-bmi2.exe */
+
+#include <stdint.h>
+#include <string.h>
+
+static const uint32_t K256[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* K+W for the padding block of a 64-byte message. That block  */
+/*  is the same for every 64-byte message, so its whole message */
+/*  schedule is folded into the round constants.                */
+/* Scalar rounds. GCC and Clang emit rorx for ROTR with -mbmi2. */
+#define ROTR(x,n)    (((x)>>(n)) | ((x)<<(32-(n))))
+#define Sigma0(x)    (ROTR((x), 2) ^ ROTR((x),13) ^ ROTR((x),22))
+#define Sigma1(x)    (ROTR((x), 6) ^ ROTR((x),11) ^ ROTR((x),25))
+#define sigma0(x)    (ROTR((x), 7) ^ ROTR((x),18) ^ ((x)>> 3))
+#define sigma1(x)    (ROTR((x),17) ^ ROTR((x),19) ^ ((x)>>10))
+#define Ch(x,y,z)    ((((y) ^ (z)) & (x)) ^ (z))
+
+#if defined(_MSC_VER)
+# include <stdlib.h>
+# define LOAD32_BE(p) _byteswap_ulong(*(const uint32_t*)(p))
+#else
+static inline uint32_t LOAD32_BE(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+}
+#endif
+
+static inline uint32_t LOAD32_HO(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+#if defined(_MSC_VER)
+# define SHA_FORCE_INLINE __forceinline
+#else
+# define SHA_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+/* One round. h receives the new a and d the new e. x holds b ^ c */
+/*  on entry, and y receives a ^ b, which is b ^ c next round.    */
+#define ROUND(a,b,c,d,e,f,g,h,k,w,x,y)                                 \
+    h += Sigma1(e) + Ch(e,f,g) + (k) + (w);                            \
+    d += h;                                                            \
+    y = (a) ^ (b);                                                     \
+    h += Sigma0(a) + ((b) ^ (y & x));
+
+/* Message schedule word i, in place in the 16-word window */
+#define SCHEDULE(i)  (X[(i)&15] += sigma1(X[((i)+14)&15]) + X[((i)+9)&15] + sigma0(X[((i)+1)&15]))
+
+/* Message word i of the block. Byte input is big-endian; word */
+/*  input is already in host order.                             */
+#define LOAD(i)      (X[i] = swap ? LOAD32_BE(data + 4*(i)) : LOAD32_HO(data + 4*(i)))
+
+/* Sixteen rounds from round r. W(i) yields message word r + i. */
+#define ROUNDS16(r, W)                                                 \
+    ROUND(a,b,c,d,e,f,g,h, K256[(r)+ 0], W( 0), x,y);                  \
+    ROUND(h,a,b,c,d,e,f,g, K256[(r)+ 1], W( 1), y,x);                  \
+    ROUND(g,h,a,b,c,d,e,f, K256[(r)+ 2], W( 2), x,y);                  \
+    ROUND(f,g,h,a,b,c,d,e, K256[(r)+ 3], W( 3), y,x);                  \
+    ROUND(e,f,g,h,a,b,c,d, K256[(r)+ 4], W( 4), x,y);                  \
+    ROUND(d,e,f,g,h,a,b,c, K256[(r)+ 5], W( 5), y,x);                  \
+    ROUND(c,d,e,f,g,h,a,b, K256[(r)+ 6], W( 6), x,y);                  \
+    ROUND(b,c,d,e,f,g,h,a, K256[(r)+ 7], W( 7), y,x);                  \
+    ROUND(a,b,c,d,e,f,g,h, K256[(r)+ 8], W( 8), x,y);                  \
+    ROUND(h,a,b,c,d,e,f,g, K256[(r)+ 9], W( 9), y,x);                  \
+    ROUND(g,h,a,b,c,d,e,f, K256[(r)+10], W(10), x,y);                  \
+    ROUND(f,g,h,a,b,c,d,e, K256[(r)+11], W(11), y,x);                  \
+    ROUND(e,f,g,h,a,b,c,d, K256[(r)+12], W(12), x,y);                  \
+    ROUND(d,e,f,g,h,a,b,c, K256[(r)+13], W(13), y,x);                  \
+    ROUND(c,d,e,f,g,h,a,b, K256[(r)+14], W(14), x,y);                  \
+    ROUND(b,c,d,e,f,g,h,a, K256[(r)+15], W(15), y,x);
+
+/* The callers pass a constant swap, so each gets its own copy */
+static SHA_FORCE_INLINE void sha256_bmi2_blocks(uint32_t state[8], const uint8_t data[],
+                                                uint32_t length, const int swap)
+{
+    uint32_t a, b, c, d, e, f, g, h, x, y;
+    uint32_t X[16];
+    unsigned int r;
+
+    size_t blocks = length / 64;
+    while (blocks--)
+    {
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+        x = b ^ c;
+
+        /* Sixteen rounds per step, so every window index is a constant */
+        /*  and the variables return to their names after each step.   */
+        ROUNDS16(0, LOAD);
+        for (r = 16; r < 64; r += 16)
+        {
+            ROUNDS16(r, SCHEDULE);
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        data += 64;
+    }
+}
+
+/* Process multiple blocks. The caller is responsible for setting the initial */
+/*  state, and the caller is responsible for padding the final block.        */
+void sha256_process_bmi2(uint32_t state[8], const uint8_t data[], uint32_t length)
+{
+    sha256_bmi2_blocks(state, data, length, 1);
+}
+
+/* Process multiple blocks given as host-order message words */
+void sha256_process_words_bmi2(uint32_t state[8], const uint32_t data[], uint32_t length)
+{
+    sha256_bmi2_blocks(state, (const uint8_t*) data, length, 0);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[128];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state */
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_process_bmi2(state, message, 64);
+
+    /* e3b0c44298fc1c14... */
+    printf("SHA256 hash of empty message: %08X%08X...\n", state[0], state[1]);
+    int success = (state[0] == 0xE3B0C442 && state[1] == 0x98FC1C14);
+
+    /* Two blocks, "abcdbcde...nopq" from FIPS 180-2 */
+    static const char text[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    uint32_t state2[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memset(message, 0x00, sizeof(message));
+    memcpy(message, text, 56);
+    message[56] = 0x80;
+    message[126] = 0x01;
+    message[127] = 0xC0;
+
+    sha256_process_bmi2(state2, message, 128);
+
+    /* 248d6a61d20638b8... */
+    printf("SHA256 hash of two blocks: %08X%08X...\n", state2[0], state2[1]);
+    success = success && (state2[0] == 0x248D6A61 && state2[1] == 0xD20638B8 && state2[7] == 0x19DB06C1);
+
+    /* The same blocks as host-order words */
+    uint32_t words[32];
+    uint32_t state3[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    unsigned int i;
+    for (i = 0; i < 32; ++i)
+        words[i] = ((uint32_t)message[4*i+0] << 24) | ((uint32_t)message[4*i+1] << 16) |
+                   ((uint32_t)message[4*i+2] <<  8) | ((uint32_t)message[4*i+3] <<  0);
+
+    sha256_process_words_bmi2(state3, words, sizeof(words));
+    success = success && (memcmp(state3, state2, sizeof(state2)) == 0);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,251 @@
+/* sha256-mb-avx2.c - 8-lane multi-buffer SHA-256 using AVX2    */
+/*   Written and placed in public domain                        */
+
+/* Each 32-bit lane of a YMM register carries one message. The  */
+/* rounds are the same as sha256_process, but every operation   */
+/* works on eight messages. The message words are loaded one    */
+/* lane at a time and transposed into word-major order.          */
+
+/* gcc -DTEST_MAIN -mavx2 sha256-mb-avx2.c -o sha256-mb-avx2.exe */
+
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <immintrin.h>
+#endif
+
+#include "sha256-mb.h"
+
+static const uint32_t K256[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* Inactive lanes read this block so the loads never fault */
+static const uint8_t ZERO_BLOCK[64] = {0};
+
+#define ROTR(x,n)    _mm256_or_si256(_mm256_srli_epi32((x),(n)), _mm256_slli_epi32((x),32-(n)))
+#define SHR(x,n)     _mm256_srli_epi32((x),(n))
+#define XOR3(x,y,z)  _mm256_xor_si256(_mm256_xor_si256((x),(y)),(z))
+#define ADD(x,y)     _mm256_add_epi32((x),(y))
+
+#define Sigma0(x)    XOR3(ROTR((x), 2), ROTR((x),13), ROTR((x),22))
+#define Sigma1(x)    XOR3(ROTR((x), 6), ROTR((x),11), ROTR((x),25))
+#define sigma0(x)    XOR3(ROTR((x), 7), ROTR((x),18), SHR((x), 3))
+#define sigma1(x)    XOR3(ROTR((x),17), ROTR((x),19), SHR((x),10))
+
+#define Ch(x,y,z)    _mm256_xor_si256(_mm256_and_si256((x),(y)), _mm256_andnot_si256((x),(z)))
+#define Maj(x,y,z)   _mm256_or_si256(_mm256_and_si256((x),(y)), _mm256_and_si256(_mm256_or_si256((x),(y)),(z)))
+
+/* One round. The caller renames the working variables instead of */
+/*  moving them, so only d and h are written.                     */
+#define ROUND(a,b,c,d,e,f,g,h,i) do { \
+    const __m256i T1 = ADD(ADD(ADD(h, Sigma1(e)), ADD(Ch(e,f,g), _mm256_set1_epi32((int)K256[i]))), W[(i)&15]); \
+    const __m256i T2 = ADD(Sigma0(a), Maj(a,b,c)); \
+    d = ADD(d, T1); \
+    h = ADD(T1, T2); \
+} while (0)
+
+#define SCHEDULE(i) \
+    W[(i)&15] = ADD(ADD(sigma1(W[((i)-2)&15]), W[((i)-7)&15]), ADD(sigma0(W[((i)-15)&15]), W[(i)&15]))
+
+/* Load eight words from each lane and transpose them so the */
+/*  result holds word i of every lane in W[i].               */
+static inline void load_transpose(__m256i W[8], const uint8_t* ptr[8], size_t offset)
+{
+    const __m256i MASK = _mm256_set_epi64x(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m256i r0 = _mm256_loadu_si256((const __m256i*)(ptr[0] + offset));
+    __m256i r1 = _mm256_loadu_si256((const __m256i*)(ptr[1] + offset));
+    __m256i r2 = _mm256_loadu_si256((const __m256i*)(ptr[2] + offset));
+    __m256i r3 = _mm256_loadu_si256((const __m256i*)(ptr[3] + offset));
+    __m256i r4 = _mm256_loadu_si256((const __m256i*)(ptr[4] + offset));
+    __m256i r5 = _mm256_loadu_si256((const __m256i*)(ptr[5] + offset));
+    __m256i r6 = _mm256_loadu_si256((const __m256i*)(ptr[6] + offset));
+    __m256i r7 = _mm256_loadu_si256((const __m256i*)(ptr[7] + offset));
+
+    const __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+    const __m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+    const __m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+    const __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+    const __m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+    const __m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+    const __m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+    const __m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+    r0 = _mm256_unpacklo_epi64(t0, t2);
+    r1 = _mm256_unpackhi_epi64(t0, t2);
+    r2 = _mm256_unpacklo_epi64(t1, t3);
+    r3 = _mm256_unpackhi_epi64(t1, t3);
+    r4 = _mm256_unpacklo_epi64(t4, t6);
+    r5 = _mm256_unpackhi_epi64(t4, t6);
+    r6 = _mm256_unpacklo_epi64(t5, t7);
+    r7 = _mm256_unpackhi_epi64(t5, t7);
+
+    W[0] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x20), MASK);
+    W[1] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x20), MASK);
+    W[2] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x20), MASK);
+    W[3] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x20), MASK);
+    W[4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r0, r4, 0x31), MASK);
+    W[5] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r1, r5, 0x31), MASK);
+    W[6] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r2, r6, 0x31), MASK);
+    W[7] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r3, r7, 0x31), MASK);
+}
+
+/* Process blocks for the lanes set in mask. The caller is responsible */
+/*  for setting the initial state and padding each lane's message.    */
+void sha256_mb_avx2(sha256_mb_args* args, uint32_t mask, size_t blocks)
+{
+    const uint8_t* ptr[8];
+    size_t stride[8];
+    unsigned int i;
+
+    if (blocks == 0 || (mask & 0xff) == 0)
+        return;
+
+    /* Inactive lanes spin on the zero block */
+    for (i = 0; i < 8; ++i)
+    {
+        const int active = (mask >> i) & 1;
+        ptr[i] = active ? args->data[i] : ZERO_BLOCK;
+        stride[i] = active ? 64 : 0;
+    }
+
+    const __m256i LANES = _mm256_cmpgt_epi32(
+        _mm256_and_si256(_mm256_set1_epi32((int)mask), _mm256_set_epi32(128,64,32,16,8,4,2,1)),
+        _mm256_setzero_si256());
+
+    const __m256i A0 = _mm256_loadu_si256((const __m256i*)args->digest[0]);
+    const __m256i B0 = _mm256_loadu_si256((const __m256i*)args->digest[1]);
+    const __m256i C0 = _mm256_loadu_si256((const __m256i*)args->digest[2]);
+    const __m256i D0 = _mm256_loadu_si256((const __m256i*)args->digest[3]);
+    const __m256i E0 = _mm256_loadu_si256((const __m256i*)args->digest[4]);
+    const __m256i F0 = _mm256_loadu_si256((const __m256i*)args->digest[5]);
+    const __m256i G0 = _mm256_loadu_si256((const __m256i*)args->digest[6]);
+    const __m256i H0 = _mm256_loadu_si256((const __m256i*)args->digest[7]);
+
+    __m256i SA = A0, SB = B0, SC = C0, SD = D0;
+    __m256i SE = E0, SF = F0, SG = G0, SH = H0;
+
+    while (blocks--)
+    {
+        __m256i a = SA, b = SB, c = SC, d = SD;
+        __m256i e = SE, f = SF, g = SG, h = SH;
+        __m256i W[16];
+
+        load_transpose(W+0, ptr, 0);
+        load_transpose(W+8, ptr, 32);
+
+        for (i = 0; i < 64; i += 8)
+        {
+            if (i >= 16)
+            {
+                SCHEDULE(i+0); SCHEDULE(i+1); SCHEDULE(i+2); SCHEDULE(i+3);
+                SCHEDULE(i+4); SCHEDULE(i+5); SCHEDULE(i+6); SCHEDULE(i+7);
+            }
+
+            ROUND(a,b,c,d,e,f,g,h,i+0);
+            ROUND(h,a,b,c,d,e,f,g,i+1);
+            ROUND(g,h,a,b,c,d,e,f,i+2);
+            ROUND(f,g,h,a,b,c,d,e,i+3);
+            ROUND(e,f,g,h,a,b,c,d,i+4);
+            ROUND(d,e,f,g,h,a,b,c,i+5);
+            ROUND(c,d,e,f,g,h,a,b,i+6);
+            ROUND(b,c,d,e,f,g,h,a,i+7);
+        }
+
+        SA = ADD(SA, a); SB = ADD(SB, b); SC = ADD(SC, c); SD = ADD(SD, d);
+        SE = ADD(SE, e); SF = ADD(SF, f); SG = ADD(SG, g); SH = ADD(SH, h);
+
+        for (i = 0; i < 8; ++i)
+            ptr[i] += stride[i];
+    }
+
+    /* Keep the old digest in the inactive lanes */
+    _mm256_storeu_si256((__m256i*)args->digest[0], _mm256_blendv_epi8(A0, SA, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[1], _mm256_blendv_epi8(B0, SB, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[2], _mm256_blendv_epi8(C0, SC, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[3], _mm256_blendv_epi8(D0, SD, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[4], _mm256_blendv_epi8(E0, SE, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[5], _mm256_blendv_epi8(F0, SF, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[6], _mm256_blendv_epi8(G0, SG, LANES));
+    _mm256_storeu_si256((__m256i*)args->digest[7], _mm256_blendv_epi8(H0, SH, LANES));
+
+    for (i = 0; i < 8; ++i)
+    {
+        if ((mask >> i) & 1)
+            args->data[i] = ptr[i];
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state in every lane */
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_mb_args args;
+    unsigned int i, j;
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < 8; ++j)
+            args.digest[i][j] = iv[i];
+    for (j = 0; j < 8; ++j)
+        args.data[j] = message;
+
+    /* Lane 5 is inactive and keeps the initial state */
+    sha256_mb_avx2(&args, 0xDF, 1);
+
+    /* e3b0c44298fc1c14... */
+    printf("SHA256 hash of empty message: %08X%08X...\n",
+        args.digest[0][0], args.digest[1][0]);
+
+    int success = 1;
+    for (j = 0; j < 8; ++j)
+    {
+        if (j == 5)
+            success &= (args.digest[0][j] == iv[0] && args.data[j] == message);
+        else
+            success &= (args.digest[0][j] == 0xE3B0C442 && args.digest[1][j] == 0x98FC1C14 &&
+                        args.digest[7][j] == 0x7852B855 && args.data[j] == message + 64);
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
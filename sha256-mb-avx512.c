@@ -0,0 +1,248 @@
+/* sha256-mb-avx512.c - 16-lane multi-buffer SHA-256 using AVX-512 */
+/*   Written and placed in public domain                            */
+
+/* Each 32-bit lane of a ZMM register carries one message. AVX-512  */
+/* has a native rotate, vprord, and vpternlogd computes Ch, Maj and */
+/* the three-way XORs of the Sigma functions in one instruction.    */
+
+/* gcc -DTEST_MAIN -mavx512f -mavx512bw sha256-mb-avx512.c -o sha256-mb-avx512.exe */
+
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <immintrin.h>
+#endif
+
+#include "sha256-mb.h"
+
+static const uint32_t K256[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* Inactive lanes read this block so the loads never fault */
+static const uint8_t ZERO_BLOCK[64] = {0};
+
+#define ROTR(x,n)    _mm512_ror_epi32((x),(n))
+#define SHR(x,n)     _mm512_srli_epi32((x),(n))
+#define XOR3(x,y,z)  _mm512_ternarylogic_epi32((x),(y),(z),0x96)
+#define ADD(x,y)     _mm512_add_epi32((x),(y))
+
+#define Sigma0(x)    XOR3(ROTR((x), 2), ROTR((x),13), ROTR((x),22))
+#define Sigma1(x)    XOR3(ROTR((x), 6), ROTR((x),11), ROTR((x),25))
+#define sigma0(x)    XOR3(ROTR((x), 7), ROTR((x),18), SHR((x), 3))
+#define sigma1(x)    XOR3(ROTR((x),17), ROTR((x),19), SHR((x),10))
+
+/* x ? y : z and the majority of x, y and z */
+#define Ch(x,y,z)    _mm512_ternarylogic_epi32((x),(y),(z),0xCA)
+#define Maj(x,y,z)   _mm512_ternarylogic_epi32((x),(y),(z),0xE8)
+
+/* One round. The caller renames the working variables instead of */
+/*  moving them, so only d and h are written.                     */
+#define ROUND(a,b,c,d,e,f,g,h,i) do { \
+    const __m512i T1 = ADD(ADD(ADD(h, Sigma1(e)), ADD(Ch(e,f,g), _mm512_set1_epi32((int)K256[i]))), W[(i)&15]); \
+    const __m512i T2 = ADD(Sigma0(a), Maj(a,b,c)); \
+    d = ADD(d, T1); \
+    h = ADD(T1, T2); \
+} while (0)
+
+#define SCHEDULE(i) \
+    W[(i)&15] = ADD(ADD(sigma1(W[((i)-2)&15]), W[((i)-7)&15]), ADD(sigma0(W[((i)-15)&15]), W[(i)&15]))
+
+/* Load a block from each lane and transpose it so the */
+/*  result holds word i of every lane in W[i].         */
+static inline void load_transpose(__m512i W[16], const uint8_t* ptr[16])
+{
+    const __m512i MASK = _mm512_set_epi64(
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+        0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m512i r[16], t[16];
+    unsigned int i;
+
+    for (i = 0; i < 16; ++i)
+        r[i] = _mm512_loadu_si512((const void*)ptr[i]);
+
+    /* 2x2 blocks of words, then 4x4 blocks within each 128-bit chunk */
+    for (i = 0; i < 16; i += 2)
+    {
+        t[i+0] = _mm512_unpacklo_epi32(r[i], r[i+1]);
+        t[i+1] = _mm512_unpackhi_epi32(r[i], r[i+1]);
+    }
+    for (i = 0; i < 16; i += 4)
+    {
+        r[i+0] = _mm512_unpacklo_epi64(t[i+0], t[i+2]);
+        r[i+1] = _mm512_unpackhi_epi64(t[i+0], t[i+2]);
+        r[i+2] = _mm512_unpacklo_epi64(t[i+1], t[i+3]);
+        r[i+3] = _mm512_unpackhi_epi64(t[i+1], t[i+3]);
+    }
+
+    /* Chunk k of r[4g+m] holds word 4k+m of lanes 4g..4g+3 */
+    for (i = 0; i < 4; ++i)
+    {
+        const __m512i x0 = _mm512_shuffle_i32x4(r[i+0], r[i+4], 0x44);
+        const __m512i x1 = _mm512_shuffle_i32x4(r[i+0], r[i+4], 0xEE);
+        const __m512i y0 = _mm512_shuffle_i32x4(r[i+8], r[i+12], 0x44);
+        const __m512i y1 = _mm512_shuffle_i32x4(r[i+8], r[i+12], 0xEE);
+
+        W[i+ 0] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x0, y0, 0x88), MASK);
+        W[i+ 4] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x0, y0, 0xDD), MASK);
+        W[i+ 8] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x1, y1, 0x88), MASK);
+        W[i+12] = _mm512_shuffle_epi8(_mm512_shuffle_i32x4(x1, y1, 0xDD), MASK);
+    }
+}
+
+/* Process blocks for the lanes set in mask. The caller is responsible */
+/*  for setting the initial state and padding each lane's message.    */
+void sha256_mb_avx512(sha256_mb_args* args, uint32_t mask, size_t blocks)
+{
+    const uint8_t* ptr[16];
+    size_t stride[16];
+    unsigned int i;
+
+    if (blocks == 0 || (mask & 0xffff) == 0)
+        return;
+
+    /* Inactive lanes spin on the zero block */
+    for (i = 0; i < 16; ++i)
+    {
+        const int active = (mask >> i) & 1;
+        ptr[i] = active ? args->data[i] : ZERO_BLOCK;
+        stride[i] = active ? 64 : 0;
+    }
+
+    const __mmask16 LANES = (__mmask16)mask;
+
+    const __m512i A0 = _mm512_loadu_si512((const void*)args->digest[0]);
+    const __m512i B0 = _mm512_loadu_si512((const void*)args->digest[1]);
+    const __m512i C0 = _mm512_loadu_si512((const void*)args->digest[2]);
+    const __m512i D0 = _mm512_loadu_si512((const void*)args->digest[3]);
+    const __m512i E0 = _mm512_loadu_si512((const void*)args->digest[4]);
+    const __m512i F0 = _mm512_loadu_si512((const void*)args->digest[5]);
+    const __m512i G0 = _mm512_loadu_si512((const void*)args->digest[6]);
+    const __m512i H0 = _mm512_loadu_si512((const void*)args->digest[7]);
+
+    __m512i SA = A0, SB = B0, SC = C0, SD = D0;
+    __m512i SE = E0, SF = F0, SG = G0, SH = H0;
+
+    while (blocks--)
+    {
+        __m512i a = SA, b = SB, c = SC, d = SD;
+        __m512i e = SE, f = SF, g = SG, h = SH;
+        __m512i W[16];
+
+        load_transpose(W, ptr);
+
+        for (i = 0; i < 64; i += 8)
+        {
+            if (i >= 16)
+            {
+                SCHEDULE(i+0); SCHEDULE(i+1); SCHEDULE(i+2); SCHEDULE(i+3);
+                SCHEDULE(i+4); SCHEDULE(i+5); SCHEDULE(i+6); SCHEDULE(i+7);
+            }
+
+            ROUND(a,b,c,d,e,f,g,h,i+0);
+            ROUND(h,a,b,c,d,e,f,g,i+1);
+            ROUND(g,h,a,b,c,d,e,f,i+2);
+            ROUND(f,g,h,a,b,c,d,e,i+3);
+            ROUND(e,f,g,h,a,b,c,d,i+4);
+            ROUND(d,e,f,g,h,a,b,c,i+5);
+            ROUND(c,d,e,f,g,h,a,b,i+6);
+            ROUND(b,c,d,e,f,g,h,a,i+7);
+        }
+
+        SA = ADD(SA, a); SB = ADD(SB, b); SC = ADD(SC, c); SD = ADD(SD, d);
+        SE = ADD(SE, e); SF = ADD(SF, f); SG = ADD(SG, g); SH = ADD(SH, h);
+
+        for (i = 0; i < 16; ++i)
+            ptr[i] += stride[i];
+    }
+
+    /* Keep the old digest in the inactive lanes */
+    _mm512_storeu_si512((void*)args->digest[0], _mm512_mask_mov_epi32(A0, LANES, SA));
+    _mm512_storeu_si512((void*)args->digest[1], _mm512_mask_mov_epi32(B0, LANES, SB));
+    _mm512_storeu_si512((void*)args->digest[2], _mm512_mask_mov_epi32(C0, LANES, SC));
+    _mm512_storeu_si512((void*)args->digest[3], _mm512_mask_mov_epi32(D0, LANES, SD));
+    _mm512_storeu_si512((void*)args->digest[4], _mm512_mask_mov_epi32(E0, LANES, SE));
+    _mm512_storeu_si512((void*)args->digest[5], _mm512_mask_mov_epi32(F0, LANES, SF));
+    _mm512_storeu_si512((void*)args->digest[6], _mm512_mask_mov_epi32(G0, LANES, SG));
+    _mm512_storeu_si512((void*)args->digest[7], _mm512_mask_mov_epi32(H0, LANES, SH));
+
+    for (i = 0; i < 16; ++i)
+    {
+        if ((mask >> i) & 1)
+            args->data[i] = ptr[i];
+    }
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[64];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state in every lane */
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_mb_args args;
+    unsigned int i, j;
+    for (i = 0; i < 8; ++i)
+        for (j = 0; j < 16; ++j)
+            args.digest[i][j] = iv[i];
+    for (j = 0; j < 16; ++j)
+        args.data[j] = message;
+
+    /* Lane 5 is inactive and keeps the initial state */
+    sha256_mb_avx512(&args, 0xFFDF, 1);
+
+    /* e3b0c44298fc1c14... */
+    printf("SHA256 hash of empty message: %08X%08X...\n",
+        args.digest[0][0], args.digest[1][0]);
+
+    int success = 1;
+    for (j = 0; j < 16; ++j)
+    {
+        if (j == 5)
+            success &= (args.digest[0][j] == iv[0] && args.data[j] == message);
+        else
+            success &= (args.digest[0][j] == 0xE3B0C442 && args.digest[1][j] == 0x98FC1C14 &&
+                        args.digest[7][j] == 0x7852B855 && args.data[j] == message + 64);
+    }
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,436 @@
+/* sha256-mb.c - Job manager for the multi-buffer SHA-256 kernels */
+/*   Written and placed in public domain                          */
+
+/* The manager keeps one job per lane. A job runs in two segments:  */
+/* the whole blocks of the message, read in place, and then one or  */
+/* two padded blocks built in the lane's tail buffer. A job with a  */
+/* prefix byte starts with a third segment: the prefix and the      */
+/* first 63 bytes of data in the lane's head buffer, after which    */
+/* the body is read in place one byte into the data. Each kernel    */
+/* call runs the smallest segment among the busy lanes, so no lane  */
+/* does wasted work. A finished lane is handed back and refilled by */
+/* the next submit.                                                 */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -c -mavx2 sha256-mb-avx2.c                                       */
+/* gcc -c -mavx512f -mavx512bw sha256-mb-avx512.c                       */
+/* gcc -DTEST_MAIN sha256-mb.c sha256-mb-avx2.o sha256-mb-avx512.o \   */
+/*     sha-ctx.o sha-dispatch.o <ISA objects> -o sha256-mb.exe          */
+
+#include <string.h>
+
+#include "sha256-mb.h"
+#include "sha-dispatch.h"
+
+enum { LANE_HEAD, LANE_BODY, LANE_TAIL, LANE_DONE };
+
+static const uint32_t IV256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8); p[3] = (uint8_t)(v >>  0);
+}
+
+/* One lane at a time through the dispatched compress function */
+static void sha256_mb_single(sha256_mb_args* args, uint32_t mask, size_t blocks)
+{
+    unsigned int lane, i;
+    for (lane = 0; lane < SHA256_MB_MAX_LANES; ++lane)
+    {
+        if (((mask >> lane) & 1) == 0)
+            continue;
+
+        uint32_t state[8];
+        for (i = 0; i < 8; ++i)
+            state[i] = args->digest[i][lane];
+
+        size_t left = blocks;
+        while (left)
+        {
+            const size_t n = (left > (1 << 24)) ? (1 << 24) : left;
+            sha256_process_dispatch(state, args->data[lane], (uint32_t)(n * 64));
+            args->data[lane] += n * 64;
+            left -= n;
+        }
+
+        for (i = 0; i < 8; ++i)
+            args->digest[i][lane] = state[i];
+    }
+}
+
+#if defined(SHA_DISPATCH_X86)
+/* Two lanes at a time through sha256_process_x86_x2 */
+static void sha256_mb_x2(sha256_mb_args* args, uint32_t mask, size_t blocks)
+{
+    uint32_t state1[8], state2[8];
+    unsigned int i;
+
+    if ((mask & 3) != 3)
+    {
+        sha256_mb_single(args, mask, blocks);
+        return;
+    }
+
+    for (i = 0; i < 8; ++i)
+    {
+        state1[i] = args->digest[i][0];
+        state2[i] = args->digest[i][1];
+    }
+
+    size_t left = blocks;
+    while (left)
+    {
+        const size_t n = (left > (1 << 24)) ? (1 << 24) : left;
+        sha256_process_x86_x2(state1, state2, args->data[0], args->data[1], (uint32_t)(n * 64));
+        args->data[0] += n * 64;
+        args->data[1] += n * 64;
+        left -= n;
+    }
+
+    for (i = 0; i < 8; ++i)
+    {
+        args->digest[i][0] = state1[i];
+        args->digest[i][1] = state2[i];
+    }
+}
+#endif
+
+int sha256_mb_init(sha256_mb_mgr* mgr, int kernel)
+{
+    const unsigned int features = sha_cpu_features();
+    memset(mgr, 0x00, sizeof(*mgr));
+
+    if (kernel == SHA256_MB_AUTO)
+    {
+        /* Two interleaved SHA-NI streams beat eight AVX2 lanes. */
+        /*  Ask for SHA256_MB_AVX512 explicitly to measure it on */
+        /*  SHA-NI.                                              */
+        if (features & SHA_CPU_X86_SHA)
+            kernel = SHA256_MB_X2;
+        else if (features & SHA_CPU_X86_AVX512)
+            kernel = SHA256_MB_AVX512;
+        else if (features & SHA_CPU_X86_AVX2)
+            kernel = SHA256_MB_AVX2;
+        else
+            kernel = SHA256_MB_SINGLE;
+    }
+
+    switch (kernel)
+    {
+#if defined(SHA_DISPATCH_X86)
+    case SHA256_MB_AVX2:
+        if (!(features & SHA_CPU_X86_AVX2))
+            return -1;
+        mgr->kernel = sha256_mb_avx2;
+        mgr->lanes = 8;
+        return 0;
+    case SHA256_MB_AVX512:
+        if (!(features & SHA_CPU_X86_AVX512))
+            return -1;
+        mgr->kernel = sha256_mb_avx512;
+        mgr->lanes = 16;
+        return 0;
+    case SHA256_MB_X2:
+        if (!(features & SHA_CPU_X86_SHA))
+            return -1;
+        mgr->kernel = sha256_mb_x2;
+        mgr->lanes = 2;
+        return 0;
+#endif
+    case SHA256_MB_SINGLE:
+        mgr->kernel = sha256_mb_single;
+        mgr->lanes = 1;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/* Hashed length of a job, counting the prefix byte */
+static inline size_t job_length(const sha256_mb_job* job)
+{
+    return job->length + (job->prefix >= 0 ? 1 : 0);
+}
+
+/* Pad the last partial block into the lane's tail buffer. The   */
+/*  length % 64 bytes after the whole blocks of the message start */
+/*  at data + offset. Returns the number of tail blocks, 1 or 2.  */
+static size_t build_tail(uint8_t tail[128], const uint8_t* data, size_t offset, size_t length)
+{
+    const size_t rem = length % 64;
+    const size_t total = (rem < 56) ? 64 : 128;
+    const uint64_t bits = (uint64_t)length << 3;
+
+    if (rem)
+        memcpy(tail, data + offset, rem);
+    memset(tail + rem, 0x00, total - rem);
+    tail[rem] = 0x80;
+    store_be32(tail + total - 8, (uint32_t)(bits >> 32));
+    store_be32(tail + total - 4, (uint32_t)(bits >>  0));
+
+    return total / 64;
+}
+
+static void lane_start(sha256_mb_mgr* mgr, unsigned int lane, sha256_mb_job* job)
+{
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        mgr->args.digest[i][lane] = IV256[i];
+
+    mgr->job[lane] = job;
+    const size_t length = job_length(job);
+
+    if (job->prefix >= 0)
+    {
+        uint8_t* head = mgr->head[lane];
+        head[0] = (uint8_t)job->prefix;
+
+        /* Shorter than a block: the whole message goes in the tail */
+        if (length < 64)
+        {
+            if (job->length)
+                memcpy(head + 1, job->data, job->length);
+            mgr->phase[lane] = LANE_TAIL;
+            mgr->args.data[lane] = mgr->tail[lane];
+            mgr->blocks[lane] = build_tail(mgr->tail[lane], head, 0, length);
+            return;
+        }
+
+        memcpy(head + 1, job->data, 63);
+        build_tail(mgr->tail[lane], job->data, length - length % 64 - 1, length);
+        mgr->phase[lane] = LANE_HEAD;
+        mgr->args.data[lane] = head;
+        mgr->blocks[lane] = 1;
+        return;
+    }
+
+    const size_t body = length / 64;
+    const size_t tail = build_tail(mgr->tail[lane], job->data, length - length % 64, length);
+
+    if (body)
+    {
+        mgr->phase[lane] = LANE_BODY;
+        mgr->args.data[lane] = job->data;
+        mgr->blocks[lane] = body;
+    }
+    else
+    {
+        mgr->phase[lane] = LANE_TAIL;
+        mgr->args.data[lane] = mgr->tail[lane];
+        mgr->blocks[lane] = tail;
+    }
+}
+
+static void lane_finish(sha256_mb_mgr* mgr, unsigned int lane)
+{
+    sha256_mb_job* job = mgr->job[lane];
+    unsigned int i;
+    for (i = 0; i < 8; ++i)
+        store_be32(job->digest + 4*i, mgr->args.digest[i][lane]);
+    mgr->phase[lane] = LANE_DONE;
+}
+
+static uint32_t busy_lanes(const sha256_mb_mgr* mgr)
+{
+    uint32_t mask = 0;
+    unsigned int lane;
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] && mgr->phase[lane] != LANE_DONE)
+            mask |= (uint32_t)1 << lane;
+    }
+    return mask;
+}
+
+/* Run the kernel until at least one lane finishes */
+static void run_lanes(sha256_mb_mgr* mgr)
+{
+    int finished = 0;
+    while (!finished)
+    {
+        const uint32_t mask = busy_lanes(mgr);
+        unsigned int lane;
+        size_t blocks = 0;
+
+        if (mask == 0)
+            return;
+
+        for (lane = 0; lane < mgr->lanes; ++lane)
+        {
+            if (((mask >> lane) & 1) && (blocks == 0 || mgr->blocks[lane] < blocks))
+                blocks = mgr->blocks[lane];
+        }
+
+        mgr->kernel(&mgr->args, mask, blocks);
+
+        for (lane = 0; lane < mgr->lanes; ++lane)
+        {
+            if (((mask >> lane) & 1) == 0)
+                continue;
+            if ((mgr->blocks[lane] -= blocks) != 0)
+                continue;
+
+            const sha256_mb_job* job = mgr->job[lane];
+            const size_t length = job_length(job);
+
+            /* After the head block, the body resumes 63 bytes into the data */
+            if (mgr->phase[lane] == LANE_HEAD && length / 64 > 1)
+            {
+                mgr->phase[lane] = LANE_BODY;
+                mgr->args.data[lane] = job->data + 63;
+                mgr->blocks[lane] = length / 64 - 1;
+            }
+            else if (mgr->phase[lane] != LANE_TAIL)
+            {
+                mgr->phase[lane] = LANE_TAIL;
+                mgr->args.data[lane] = mgr->tail[lane];
+                mgr->blocks[lane] = ((length % 64) < 56) ? 1 : 2;
+            }
+            else
+            {
+                lane_finish(mgr, lane);
+                finished = 1;
+            }
+        }
+    }
+}
+
+static sha256_mb_job* take_finished(sha256_mb_mgr* mgr)
+{
+    unsigned int lane;
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] && mgr->phase[lane] == LANE_DONE)
+        {
+            sha256_mb_job* job = mgr->job[lane];
+            mgr->job[lane] = NULL;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+sha256_mb_job* sha256_mb_submit(sha256_mb_mgr* mgr, sha256_mb_job* job)
+{
+    unsigned int lane, free_lanes = 0;
+    int placed = 0;
+
+    for (lane = 0; lane < mgr->lanes; ++lane)
+    {
+        if (mgr->job[lane] != NULL)
+            continue;
+        if (!placed)
+        {
+            lane_start(mgr, lane, job);
+            placed = 1;
+        }
+        else
+            free_lanes++;
+    }
+
+    sha256_mb_job* done = take_finished(mgr);
+    if (done || free_lanes)
+        return done;
+
+    /* Every lane is busy. Run until one finishes. */
+    run_lanes(mgr);
+    return take_finished(mgr);
+}
+
+sha256_mb_job* sha256_mb_flush(sha256_mb_mgr* mgr)
+{
+    sha256_mb_job* done = take_finished(mgr);
+    if (done)
+        return done;
+
+    run_lanes(mgr);
+    return take_finished(mgr);
+}
+
+void sha256_mb_run(sha256_mb_mgr* mgr, sha256_mb_job jobs[], size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; ++i)
+        sha256_mb_submit(mgr, &jobs[i]);
+    while (sha256_mb_flush(mgr) != NULL)
+        continue;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sha-ctx.h"
+
+/* Hash 100 messages of mixed lengths and compare with sha256_ctx */
+static int test_kernel(int kernel, const char* name)
+{
+    enum { COUNT = 100 };
+    static uint8_t buffer[COUNT * 300];
+    static sha256_mb_job jobs[COUNT];
+    sha256_mb_mgr mgr;
+    unsigned int i, returned = 0;
+    int success = 1;
+
+    if (sha256_mb_init(&mgr, kernel) != 0)
+    {
+        printf("%s: not available\n", name);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(i * 7 + 3);
+
+    for (i = 0; i < COUNT; ++i)
+    {
+        jobs[i].length = (i * 37) % 300;
+        jobs[i].data = jobs[i].length ? buffer + i * 300 : NULL;
+        jobs[i].prefix = (i % 3 == 0) ? (int)(i & 0xff) : -1;
+        jobs[i].user = &jobs[i];
+
+        sha256_mb_job* job = sha256_mb_submit(&mgr, &jobs[i]);
+        if (job) returned++;
+    }
+    while (sha256_mb_flush(&mgr) != NULL)
+        returned++;
+
+    for (i = 0; i < COUNT; ++i)
+    {
+        uint8_t digest[32];
+        sha256_ctx ctx;
+        const uint8_t prefix = (uint8_t)jobs[i].prefix;
+        sha256_init(&ctx);
+        if (jobs[i].prefix >= 0)
+            sha256_update(&ctx, &prefix, 1);
+        sha256_update(&ctx, jobs[i].data, jobs[i].length);
+        sha256_final(&ctx, digest);
+        success &= (memcmp(digest, jobs[i].digest, 32) == 0);
+    }
+    success &= (returned == COUNT);
+
+    printf("%s, %u lanes: %s\n", name, mgr.lanes, success ? "pass" : "fail");
+    return success;
+}
+
+int main(int argc, char* argv[])
+{
+    int success = 1;
+    success &= test_kernel(SHA256_MB_SINGLE, "single");
+    success &= test_kernel(SHA256_MB_AVX2, "avx2");
+    success &= test_kernel(SHA256_MB_AVX512, "avx512");
+    success &= test_kernel(SHA256_MB_X2, "x2");
+    success &= test_kernel(SHA256_MB_AUTO, "auto");
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
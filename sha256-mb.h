@@ -0,0 +1,90 @@
+/* sha256-mb.h - Multi-buffer SHA-256 over independent messages */
+/*   Written and placed in public domain                       */
+
+/* The multi-buffer kernels run the SHA-256 rounds on several       */
+/* messages at once, one message per 32-bit vector lane. The job    */
+/* manager fills the lanes, pads each message in its own lane and   */
+/* hands back jobs as they finish. This is the approach Intel uses  */
+/* in ISA-L.                                                        */
+
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHA256_MB_MAX_LANES 16
+
+/* Kernel arguments. The digest is transposed so word w of every */
+/*  lane is contiguous and loads straight into a vector.          */
+typedef struct sha256_mb_args
+{
+    uint32_t digest[8][SHA256_MB_MAX_LANES];
+    const uint8_t* data[SHA256_MB_MAX_LANES];
+} sha256_mb_args;
+
+/* Process blocks for the lanes set in mask. Lanes not in mask are  */
+/*  left untouched and their data pointer is not read. The data     */
+/*  pointers of the active lanes are advanced past the blocks.      */
+typedef void (*sha256_mb_fn)(sha256_mb_args* args, uint32_t mask, size_t blocks);
+
+void sha256_mb_avx2(sha256_mb_args* args, uint32_t mask, size_t blocks);
+void sha256_mb_avx512(sha256_mb_args* args, uint32_t mask, size_t blocks);
+
+typedef struct sha256_mb_job
+{
+    const uint8_t* data;   /* message, owned by the caller */
+    size_t length;         /* message length in bytes */
+    int prefix;            /* byte hashed before data, or -1 for none */
+    uint8_t digest[32];    /* set when the job is returned */
+    void* user;            /* caller's cookie */
+} sha256_mb_job;
+
+/* Kernel selection for sha256_mb_init */
+enum {
+    SHA256_MB_AUTO = 0,
+    SHA256_MB_SINGLE,   /* one message at a time through sha256_process_dispatch */
+    SHA256_MB_AVX2,
+    SHA256_MB_AVX512,
+    SHA256_MB_X2        /* two lanes through the interleaved SHA-NI kernel */
+};
+
+typedef struct sha256_mb_mgr
+{
+    sha256_mb_args args;
+    sha256_mb_fn kernel;
+    unsigned int lanes;
+
+    sha256_mb_job* job[SHA256_MB_MAX_LANES];  /* NULL if the lane is free */
+    size_t blocks[SHA256_MB_MAX_LANES];       /* blocks left in the segment */
+    int phase[SHA256_MB_MAX_LANES];           /* head, body, tail or done */
+    uint8_t head[SHA256_MB_MAX_LANES][64];    /* prefix and the first bytes of data */
+    uint8_t tail[SHA256_MB_MAX_LANES][128];   /* padded final blocks */
+} sha256_mb_mgr;
+
+/* Returns 0 on success, -1 if the requested kernel is not */
+/*  available on this host.                                */
+int sha256_mb_init(sha256_mb_mgr* mgr, int kernel);
+
+/* Submit a job. Returns a finished job, or NULL if no job has  */
+/*  finished yet. The returned job is not necessarily the one   */
+/*  just submitted.                                             */
+sha256_mb_job* sha256_mb_submit(sha256_mb_mgr* mgr, sha256_mb_job* job);
+
+/* Run the partially filled lanes. Returns a finished job, or NULL */
+/*  when the manager is empty. Call until it returns NULL.         */
+sha256_mb_job* sha256_mb_flush(sha256_mb_mgr* mgr);
+
+/* Hash a batch of jobs with the manager's kernel. Submits every */
+/*  job and flushes the manager.                                 */
+void sha256_mb_run(sha256_mb_mgr* mgr, sha256_mb_job jobs[], size_t count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA256_MB_H */
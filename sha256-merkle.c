@@ -0,0 +1,397 @@
+/* sha256-merkle.c - Merkle tree hashing over the SHA-256 kernels */
+/*   Written and placed in public domain                         */
+
+/* Each level is hashed breadth-first. A worker collects the nodes  */
+/* of its range into a batch of jobs and runs them through its own  */
+/* multi-buffer manager. The jobs read the leaves and the child     */
+/* hashes in place. An RFC 6962 prefix byte is passed with the job,  */
+/* and the manager hashes it with the first bytes of the message in  */
+/* the lane's head block.                                            */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* Build the multi-buffer objects as shown in sha256-mb.c              */
+/* gcc -DTEST_MAIN sha256-merkle.c sha256-mb.o sha256-mb-avx2.o \     */
+/*     sha256-mb-avx512.o sha-ctx.o sha-dispatch.o <ISA objects> \     */
+/*     -lpthread -o sha256-merkle.exe                                  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+# include <pthread.h>
+#endif
+
+#include "sha256-merkle.h"
+#include "sha256-mb.h"
+#include "sha-ctx.h"
+
+#define MERKLE_BATCH    256           /* jobs per manager run */
+#define MERKLE_MIN_WORK 256           /* nodes per thread before a level is split */
+
+typedef struct merkle_worker
+{
+    sha256_mb_mgr mgr;
+    sha256_mb_job jobs[MERKLE_BATCH];
+    size_t njobs;
+
+    int rfc6962;
+    unsigned int fanout;
+
+    /* Leaves when hashing level 0, otherwise the child hashes */
+    const uint8_t* const* leaves;
+    const size_t* lengths;
+    const uint8_t* children;
+    size_t nchildren;
+
+    uint8_t* dest;
+    size_t begin, end;
+} merkle_worker;
+
+void sha256_merkle_defaults(sha256_merkle_params* params)
+{
+    params->fanout = 2;
+    params->threads = 1;
+    params->rfc6962 = 1;
+    params->kernel = SHA256_MB_AUTO;
+}
+
+static void merkle_flush(merkle_worker* w)
+{
+    size_t i;
+    if (w->njobs == 0)
+        return;
+
+    sha256_mb_run(&w->mgr, w->jobs, w->njobs);
+    for (i = 0; i < w->njobs; ++i)
+        memcpy(w->jobs[i].user, w->jobs[i].digest, 32);
+
+    w->njobs = 0;
+}
+
+/* Queue SHA-256(prefix || data) into dest. A negative prefix means none. */
+static void merkle_add(merkle_worker* w, int prefix, const uint8_t* data, size_t length, uint8_t* dest)
+{
+    sha256_mb_job* job = &w->jobs[w->njobs++];
+    job->data = data;
+    job->length = length;
+    job->prefix = prefix;
+    job->user = dest;
+
+    if (w->njobs == MERKLE_BATCH)
+        merkle_flush(w);
+}
+
+static void* merkle_work(void* arg)
+{
+    merkle_worker* w = (merkle_worker*)arg;
+    size_t i;
+
+    if (w->leaves)
+    {
+        for (i = w->begin; i < w->end; ++i)
+            merkle_add(w, w->rfc6962 ? 0x00 : -1, w->leaves[i], w->lengths[i], w->dest + 32*i);
+    }
+    else
+    {
+        for (i = w->begin; i < w->end; ++i)
+        {
+            const size_t first = i * w->fanout;
+            const size_t n = (w->nchildren - first < w->fanout) ? w->nchildren - first : w->fanout;
+
+            /* A lone child is promoted, not hashed */
+            if (n == 1)
+                memcpy(w->dest + 32*i, w->children + 32*first, 32);
+            else
+                merkle_add(w, w->rfc6962 ? 0x01 : -1, w->children + 32*first, 32*n, w->dest + 32*i);
+        }
+    }
+
+    merkle_flush(w);
+    return NULL;
+}
+
+/* Split count outputs across the workers and wait for them */
+static void merkle_level(merkle_worker* workers, unsigned int threads, size_t count)
+{
+    size_t t = (count + MERKLE_MIN_WORK - 1) / MERKLE_MIN_WORK;
+    size_t i;
+
+    if (t > threads) t = threads;
+    if (t == 0) t = 1;
+
+    for (i = 0; i < t; ++i)
+    {
+        workers[i].leaves = workers[0].leaves;
+        workers[i].lengths = workers[0].lengths;
+        workers[i].children = workers[0].children;
+        workers[i].nchildren = workers[0].nchildren;
+        workers[i].dest = workers[0].dest;
+        workers[i].begin = count * i / t;
+        workers[i].end = count * (i + 1) / t;
+    }
+
+#if !defined(_WIN32)
+    pthread_t tid[SHA256_MERKLE_MAX_THREADS];
+    int started[SHA256_MERKLE_MAX_THREADS];
+
+    for (i = 1; i < t; ++i)
+        started[i] = (pthread_create(&tid[i], NULL, merkle_work, &workers[i]) == 0);
+
+    merkle_work(&workers[0]);
+
+    for (i = 1; i < t; ++i)
+    {
+        if (started[i])
+            pthread_join(tid[i], NULL);
+        else
+            merkle_work(&workers[i]);
+    }
+#else
+    for (i = 0; i < t; ++i)
+        merkle_work(&workers[i]);
+#endif
+}
+
+void sha256_merkle_free(sha256_merkle_tree* tree)
+{
+    unsigned int i;
+    for (i = 0; i < tree->depth; ++i)
+        free(tree->level[i]);
+    memset(tree, 0x00, sizeof(*tree));
+}
+
+int sha256_merkle_root(const uint8_t* const leaves[], const size_t lengths[], size_t count,
+                       const sha256_merkle_params* params, uint8_t root[32],
+                       sha256_merkle_tree* tree)
+{
+    sha256_merkle_params defaults;
+    merkle_worker* workers = NULL;
+    uint8_t* level = NULL;
+    unsigned int i, threads;
+    int result = -1;
+
+    if (params == NULL)
+    {
+        sha256_merkle_defaults(&defaults);
+        params = &defaults;
+    }
+    if (tree)
+        memset(tree, 0x00, sizeof(*tree));
+
+    if (params->fanout < 2 || (count && (leaves == NULL || lengths == NULL)))
+        return -1;
+
+    if (count == 0)
+    {
+        sha256_ctx ctx;
+        sha256_init(&ctx);
+        sha256_final(&ctx, root);
+        return 0;
+    }
+
+    threads = params->threads ? params->threads : 1;
+    if (threads > SHA256_MERKLE_MAX_THREADS)
+        threads = SHA256_MERKLE_MAX_THREADS;
+
+    workers = (merkle_worker*)calloc(threads, sizeof(merkle_worker));
+    if (workers == NULL)
+        return -1;
+
+    for (i = 0; i < threads; ++i)
+    {
+        workers[i].rfc6962 = params->rfc6962;
+        workers[i].fanout = params->fanout;
+        if (sha256_mb_init(&workers[i].mgr, params->kernel) != 0)
+            goto cleanup;
+    }
+
+    /* Leaf hashes */
+    if ((level = (uint8_t*)malloc(32 * count)) == NULL)
+        goto cleanup;
+
+    workers[0].leaves = leaves;
+    workers[0].lengths = lengths;
+    workers[0].dest = level;
+    merkle_level(workers, threads, count);
+
+    /* Interior levels, up to the root */
+    for (;;)
+    {
+        if (tree)
+        {
+            tree->level[tree->depth] = level;
+            tree->count[tree->depth] = count;
+            tree->depth++;
+        }
+        if (count == 1)
+            break;
+
+        const size_t parents = (count + params->fanout - 1) / params->fanout;
+        uint8_t* next = (uint8_t*)malloc(32 * parents);
+        if (next == NULL)
+            goto cleanup;
+
+        workers[0].leaves = NULL;
+        workers[0].lengths = NULL;
+        workers[0].children = level;
+        workers[0].nchildren = count;
+        workers[0].dest = next;
+        merkle_level(workers, threads, parents);
+
+        if (tree == NULL)
+            free(level);
+        level = next;
+        count = parents;
+    }
+
+    memcpy(root, level, 32);
+    if (tree == NULL)
+        free(level);
+    level = NULL;
+    result = 0;
+
+cleanup:
+    if (result != 0)
+    {
+        if (tree == NULL || tree->depth == 0 || tree->level[tree->depth-1] != level)
+            free(level);
+        if (tree)
+            sha256_merkle_free(tree);
+    }
+    free(workers);
+    return result;
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+
+/* RFC 6962, section 2.1, straight from the definition */
+static void reference_mth(const uint8_t* const leaves[], const size_t lengths[], size_t n, uint8_t out[32])
+{
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+
+    if (n == 1)
+    {
+        const uint8_t p = 0x00;
+        sha256_update(&ctx, &p, 1);
+        sha256_update(&ctx, leaves[0], lengths[0]);
+    }
+    else if (n > 1)
+    {
+        uint8_t left[32], right[32];
+        const uint8_t p = 0x01;
+        size_t k = 1;
+        while (k * 2 < n)
+            k *= 2;
+
+        reference_mth(leaves, lengths, k, left);
+        reference_mth(leaves + k, lengths + k, n - k, right);
+        sha256_update(&ctx, &p, 1);
+        sha256_update(&ctx, left, 32);
+        sha256_update(&ctx, right, 32);
+    }
+
+    sha256_final(&ctx, out);
+}
+
+int main(int argc, char* argv[])
+{
+    enum { COUNT = 1000 };
+    static const uint8_t* leaves[COUNT];
+    static size_t lengths[COUNT];
+    static uint8_t buffer[COUNT * 200];
+    uint8_t root[32], expected[32];
+    sha256_merkle_params params;
+    sha256_merkle_tree tree;
+    size_t i, n;
+    int success = 1;
+
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(i * 13 + 5);
+    for (i = 0; i < COUNT; ++i)
+    {
+        leaves[i] = buffer + i * 200;
+        lengths[i] = (i * 61) % 200;
+    }
+
+    /* The tree of one empty leaf, 6e340b9cffb37a98... */
+    static const uint8_t empty_leaf[8] = {0x6e,0x34,0x0b,0x9c,0xff,0xb3,0x7a,0x98};
+    sha256_merkle_defaults(&params);
+    lengths[0] = 0;
+    sha256_merkle_root(leaves, lengths, 1, &params, root, NULL);
+    success &= (memcmp(root, empty_leaf, 8) == 0);
+    printf("RFC 6962 empty leaf: %s\n", success ? "pass" : "fail");
+
+    /* RFC 6962 trees of every size up to 70, and one large one */
+    for (n = 0; n <= 70 && success; ++n)
+    {
+        reference_mth(leaves, lengths, n, expected);
+        success &= (sha256_merkle_root(leaves, lengths, n, &params, root, NULL) == 0);
+        success &= (memcmp(root, expected, 32) == 0);
+    }
+    reference_mth(leaves, lengths, COUNT, expected);
+    params.threads = 3;
+    success &= (sha256_merkle_root(leaves, lengths, COUNT, &params, root, &tree) == 0);
+    success &= (memcmp(root, expected, 32) == 0);
+    success &= (tree.depth == 11 && tree.count[0] == COUNT && tree.count[10] == 1);
+    success &= (memcmp(tree.level[10], root, 32) == 0);
+    sha256_merkle_free(&tree);
+    printf("RFC 6962 trees: %s\n", success ? "pass" : "fail");
+
+    /* Fan-out 4 without prefixes. Every kernel and thread count agrees. */
+    uint8_t first[32];
+    int kernel, have_first = 0;
+    params.fanout = 4;
+    params.rfc6962 = 0;
+    for (kernel = SHA256_MB_AUTO; kernel <= SHA256_MB_X2; ++kernel)
+    {
+        for (params.threads = 1; params.threads <= 4; params.threads += 3)
+        {
+            params.kernel = kernel;
+            if (sha256_merkle_root(leaves, lengths, COUNT, &params, root, NULL) != 0)
+                continue;
+            if (!have_first)
+                memcpy(first, root, 32), have_first = 1;
+            success &= (memcmp(root, first, 32) == 0);
+        }
+    }
+
+    /* Root of two leaves by hand */
+    {
+        uint8_t node[64];
+        sha256_ctx ctx;
+        params.kernel = SHA256_MB_AUTO;
+        params.threads = 1;
+        sha256_init(&ctx); sha256_update(&ctx, leaves[1], lengths[1]); sha256_final(&ctx, node);
+        sha256_init(&ctx); sha256_update(&ctx, leaves[2], lengths[2]); sha256_final(&ctx, node + 32);
+        sha256_init(&ctx); sha256_update(&ctx, node, 64); sha256_final(&ctx, expected);
+        success &= (sha256_merkle_root(leaves + 1, lengths + 1, 2, &params, root, NULL) == 0);
+        success &= (memcmp(root, expected, 32) == 0);
+    }
+    printf("Fan-out 4 trees: %s\n", success ? "pass" : "fail");
+
+    /* Leaves of several MiB are read in place, one byte past the prefix */
+    {
+        const size_t big = ((size_t)1 << 22) + 100;
+        uint8_t* data = (uint8_t*)calloc(1, big);
+        const uint8_t* big_leaves[3] = {data, data + 1, data};
+        const size_t big_lengths[3] = {big, 10, 99};
+        sha256_merkle_defaults(&params);
+        reference_mth(big_leaves, big_lengths, 3, expected);
+        success &= (sha256_merkle_root(big_leaves, big_lengths, 3, &params, root, NULL) == 0);
+        success &= (memcmp(root, expected, 32) == 0);
+        free(data);
+    }
+    printf("Large leaf: %s\n", success ? "pass" : "fail");
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -0,0 +1,62 @@
+/* sha256-merkle.h - Merkle tree hashing over the SHA-256 kernels */
+/*   Written and placed in public domain                         */
+
+/* The tree is hashed one level at a time. The nodes of a level are  */
+/* independent, so they go through the multi-buffer job manager      */
+/* together instead of one compress call per node. Large levels are  */
+/* split across worker threads.                                      */
+
+/* With rfc6962 set, leaves are hashed as SHA-256(0x00 || leaf) and  */
+/* nodes as SHA-256(0x01 || children). A node with a single child    */
+/* is not hashed; the child is promoted to the next level. For a     */
+/* fan-out of 2 this gives the RFC 6962 Merkle Tree Hash. An empty   */
+/* tree hashes to SHA-256 of the empty string.                       */
+
+#ifndef SHA256_MERKLE_H
+#define SHA256_MERKLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SHA256_MERKLE_MAX_DEPTH   65
+#define SHA256_MERKLE_MAX_THREADS 64
+
+typedef struct sha256_merkle_params
+{
+    unsigned int fanout;    /* children per node, at least 2 */
+    unsigned int threads;   /* worker threads, 0 or 1 for the caller's thread only */
+    int rfc6962;            /* 0x00 leaf and 0x01 node prefixes */
+    int kernel;             /* SHA256_MB_* kernel for the job manager */
+} sha256_merkle_params;
+
+/* Fan-out 2, one thread, RFC 6962 prefixes, SHA256_MB_AUTO */
+void sha256_merkle_defaults(sha256_merkle_params* params);
+
+/* Every level of the tree. level[0] holds the leaf hashes and */
+/*  level[depth-1] holds the root. Each hash is 32 bytes.      */
+typedef struct sha256_merkle_tree
+{
+    unsigned int depth;
+    size_t count[SHA256_MERKLE_MAX_DEPTH];
+    uint8_t* level[SHA256_MERKLE_MAX_DEPTH];
+} sha256_merkle_tree;
+
+/* Hash count leaves into root. If tree is not NULL it receives */
+/*  every level, and the caller releases it with                */
+/*  sha256_merkle_free. Returns 0 on success, -1 on bad          */
+/*  parameters, an unavailable kernel or an allocation failure.  */
+int sha256_merkle_root(const uint8_t* const leaves[], const size_t lengths[], size_t count,
+                       const sha256_merkle_params* params, uint8_t root[32],
+                       sha256_merkle_tree* tree);
+
+void sha256_merkle_free(sha256_merkle_tree* tree);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA256_MERKLE_H */
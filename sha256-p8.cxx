@@ -63,6 +63,29 @@ static const ALIGN16 uint32_t KEY256[] =
     0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
 };
 
+// K+W for the padding block of a 64-byte message. That block
+//   is the same for every 64-byte message, so its whole message
+//   schedule is folded into the round constants.
+static const ALIGN16 uint32_t KW_PAD64[] =
+{
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
 // More succinct, but not optimized as well
 #if 0
 uint32x4_p8 VEC_XL_BE(int offset, const uint8_t* data)
@@ -253,8 +276,26 @@ void SHA256_ROUND2(uint32x4_p8 X[16], uint32x4_p8 S[8], const uint32x4_p8 K)
     S[A] = T1 + T2;
 }
 
+// One round with K+W already added. There is no message
+//   word to schedule.
+static inline
+void SHA256_ROUND3(uint32x4_p8 S[8], const uint32x4_p8 KW)
+{
+    uint32x4_p8 T1, T2;
+
+    T1 = S[H] + VectorSigma1(S[E]) + VectorCh(S[E],S[F],S[G]) + KW;
+    T2 = VectorSigma0(S[A]) + VectorMaj(S[A],S[B],S[C]);
+
+    S[H] = S[G]; S[G] = S[F]; S[F] = S[E];
+    S[E] = S[D] + T1;
+    S[D] = S[C]; S[C] = S[B]; S[B] = S[A];
+    S[A] = T1 + T2;
+}
+
 /* Process multiple blocks. The caller is responsible for setting the initial */
 /*  state, and the caller is responsible for padding the final block.        */
+/*  C linkage so the C dispatcher can bind the function.                     */
+extern "C"
 void sha256_process_p8(uint32_t state[8], const uint8_t data[], uint32_t length)
 {
     uint32_t blocks = length / 64;
@@ -393,6 +434,60 @@ void sha256_process_p8(uint32_t state[8], const uint8_t data[], uint32_t length)
     VectorStore32x4u(efgh, state+4, 0);
 }
 
+/* SHA-256 of exactly 64 bytes, like two child digests. The first */
+/*  block is the message and the second block runs rounds only.  */
+extern "C"
+void sha256_64_p8(uint8_t digest[32], const uint8_t data[64])
+{
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_process_p8(state, data, 64);
+
+    const uint32_t* kw = reinterpret_cast<const uint32_t*>(KW_PAD64);
+
+    uint32x4_p8 abcd = VectorLoad32x4u(state+0, 0);
+    uint32x4_p8 efgh = VectorLoad32x4u(state+4, 0);
+
+    uint32x4_p8 S[8], vk;
+    unsigned int i, offset=0;
+
+    S[A] = abcd; S[E] = efgh;
+    S[B] = VectorShiftLeft<4>(S[A]);
+    S[F] = VectorShiftLeft<4>(S[E]);
+    S[C] = VectorShiftLeft<4>(S[B]);
+    S[G] = VectorShiftLeft<4>(S[F]);
+    S[D] = VectorShiftLeft<4>(S[C]);
+    S[H] = VectorShiftLeft<4>(S[G]);
+
+    // Padding block, no message schedule
+    for (i=0; i<64; i+=4)
+    {
+        vk = VectorLoad32x4(kw, offset);
+        SHA256_ROUND3(S, vk);
+        SHA256_ROUND3(S, VectorShiftLeft<4>(vk));
+        SHA256_ROUND3(S, VectorShiftLeft<8>(vk));
+        SHA256_ROUND3(S, VectorShiftLeft<12>(vk));
+        offset+=16;
+    }
+
+    abcd += VectorPack(S[A],S[B],S[C],S[D]);
+    efgh += VectorPack(S[E],S[F],S[G],S[H]);
+
+    VectorStore32x4u(abcd, state+0, 0);
+    VectorStore32x4u(efgh, state+4, 0);
+
+    for (i=0; i<8; ++i)
+    {
+        digest[4*i+0] = (uint8_t)(state[i] >> 24);
+        digest[4*i+1] = (uint8_t)(state[i] >> 16);
+        digest[4*i+2] = (uint8_t)(state[i] >>  8);
+        digest[4*i+3] = (uint8_t)(state[i] >>  0);
+    }
+}
+
 #if defined(TEST_MAIN)
 
 #include <stdio.h>
@@ -429,6 +524,40 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xE3) && (b2 == 0xB0) && (b3 == 0xC4) && (b4 == 0x42) &&
                     (b5 == 0x98) && (b6 == 0xFC) && (b7 == 0x1C) && (b8 == 0x14));
 
+    /* A 64-byte message through the specialized kernel must match */
+    /*  the message and its padding block through the generic one. */
+    uint8_t blocks[128], digest[32];
+    unsigned int i;
+    for (i = 0; i < 64; ++i)
+        blocks[i] = (uint8_t)(i * 29 + 7);
+    memset(blocks + 64, 0x00, 64);
+    blocks[64] = 0x80;
+    blocks[126] = 0x02;
+
+    uint32_t ref_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_process_p8(ref_state, blocks, sizeof(blocks));
+    sha256_64_p8(digest, blocks);
+    for (i = 0; i < 8; ++i)
+    {
+        success = success && (digest[4*i+0] == (uint8_t)(ref_state[i] >> 24));
+        success = success && (digest[4*i+1] == (uint8_t)(ref_state[i] >> 16));
+        success = success && (digest[4*i+2] == (uint8_t)(ref_state[i] >>  8));
+        success = success && (digest[4*i+3] == (uint8_t)(ref_state[i] >>  0));
+    }
+
+    /* f5a5fd42d16a2030... */
+    memset(blocks, 0x00, 64);
+    sha256_64_p8(digest, blocks);
+    printf("SHA256 hash of 64 zero bytes: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        digest[0], digest[1], digest[2], digest[3],
+        digest[4], digest[5], digest[6], digest[7]);
+    success = success && (digest[0] == 0xF5) && (digest[1] == 0xA5) &&
+                         (digest[2] == 0xFD) && (digest[3] == 0x42);
+
     if (success)
         printf("Success!\n");
     else
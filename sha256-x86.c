@@ -20,26 +20,54 @@ typedef UINT32 uint32_t;
 typedef UINT8 uint8_t;
 #endif
 
-/* Process multiple blocks. The caller is responsible for setting the initial */
-/*  state, and the caller is responsible for padding the final block.        */
-void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length)
+/* K+W for the padding block of a 64-byte message. That block  */
+/*  is the same for every 64-byte message, so its whole message */
+/*  schedule is folded into the round constants.                */
+static const uint32_t KW_PAD64[] =
 {
-    __m128i STATE0, STATE1;
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
+#if defined(_MSC_VER)
+# define SHA_FORCE_INLINE __forceinline
+#else
+# define SHA_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+/* Load 16 bytes of message. Byte input is big-endian and is swapped */
+/*  into words; word input is already in host order.                */
+static SHA_FORCE_INLINE __m128i load_msg(const uint8_t* p, const __m128i MASK, const int swap)
+{
+    const __m128i MSG = _mm_loadu_si128((const __m128i*) p);
+    return swap ? _mm_shuffle_epi8(MSG, MASK) : MSG;
+}
+
+/* The rounds on the ABEF and CDGH state registers. The callers pass */
+/*  a constant swap, so each gets its own copy without the test.     */
+static SHA_FORCE_INLINE void sha256_x86_blocks(__m128i* ABEF, __m128i* CDGH,
+                                               const uint8_t data[], uint32_t length, const int swap)
+{
+    __m128i STATE0 = *ABEF, STATE1 = *CDGH;
     __m128i MSG, TMP;
     __m128i MSG0, MSG1, MSG2, MSG3;
     __m128i ABEF_SAVE, CDGH_SAVE;
     const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
 
-    /* Load initial values */
-    TMP = _mm_loadu_si128((const __m128i*) &state[0]);
-    STATE1 = _mm_loadu_si128((const __m128i*) &state[4]);
-
-
-    TMP = _mm_shuffle_epi32(TMP, 0xB1);          /* CDAB */
-    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);    /* EFGH */
-    STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);    /* ABEF */
-    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0); /* CDGH */
-
     while (length >= 64)
     {
         /* Save current state */
@@ -47,16 +75,14 @@ void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length
         CDGH_SAVE = STATE1;
 
         /* Rounds 0-3 */
-        MSG = _mm_loadu_si128((const __m128i*) (data+0));
-        MSG0 = _mm_shuffle_epi8(MSG, MASK);
+        MSG0 = load_msg(data+0, MASK, swap);
         MSG = _mm_add_epi32(MSG0, _mm_set_epi64x(0xE9B5DBA5B5C0FBCFULL, 0x71374491428A2F98ULL));
         STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
         MSG = _mm_shuffle_epi32(MSG, 0x0E);
         STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
 
         /* Rounds 4-7 */
-        MSG1 = _mm_loadu_si128((const __m128i*) (data+16));
-        MSG1 = _mm_shuffle_epi8(MSG1, MASK);
+        MSG1 = load_msg(data+16, MASK, swap);
         MSG = _mm_add_epi32(MSG1, _mm_set_epi64x(0xAB1C5ED5923F82A4ULL, 0x59F111F13956C25BULL));
         STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
         MSG = _mm_shuffle_epi32(MSG, 0x0E);
@@ -64,8 +90,7 @@ void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length
         MSG0 = _mm_sha256msg1_epu32(MSG0, MSG1);
 
         /* Rounds 8-11 */
-        MSG2 = _mm_loadu_si128((const __m128i*) (data+32));
-        MSG2 = _mm_shuffle_epi8(MSG2, MASK);
+        MSG2 = load_msg(data+32, MASK, swap);
         MSG = _mm_add_epi32(MSG2, _mm_set_epi64x(0x550C7DC3243185BEULL, 0x12835B01D807AA98ULL));
         STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
         MSG = _mm_shuffle_epi32(MSG, 0x0E);
@@ -73,8 +98,7 @@ void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length
         MSG1 = _mm_sha256msg1_epu32(MSG1, MSG2);
 
         /* Rounds 12-15 */
-        MSG3 = _mm_loadu_si128((const __m128i*) (data+48));
-        MSG3 = _mm_shuffle_epi8(MSG3, MASK);
+        MSG3 = load_msg(data+48, MASK, swap);
         MSG = _mm_add_epi32(MSG3, _mm_set_epi64x(0xC19BF1749BDC06A7ULL, 0x80DEB1FE72BE5D74ULL));
         STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
         TMP = _mm_alignr_epi8(MSG3, MSG2, 4);
@@ -206,14 +230,473 @@ void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length
         length -= 64;
     }
 
+    *ABEF = STATE0;
+    *CDGH = STATE1;
+}
+
+/* Convert between state[8] in word order and the ABEF and CDGH */
+/*  registers that sha256rnds2 works on.                       */
+static SHA_FORCE_INLINE void load_state(const uint32_t state[8], __m128i* ABEF, __m128i* CDGH)
+{
+    __m128i TMP = _mm_loadu_si128((const __m128i*) &state[0]);
+    __m128i STATE1 = _mm_loadu_si128((const __m128i*) &state[4]);
+
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);          /* CDAB */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);    /* EFGH */
+    *ABEF = _mm_alignr_epi8(TMP, STATE1, 8);     /* ABEF */
+    *CDGH = _mm_blend_epi16(STATE1, TMP, 0xF0);  /* CDGH */
+}
+
+static SHA_FORCE_INLINE void store_state(uint32_t state[8], __m128i STATE0, __m128i STATE1)
+{
+    __m128i TMP = _mm_shuffle_epi32(STATE0, 0x1B); /* FEBA */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);      /* DCHG */
+    STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);   /* DCBA */
+    STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);      /* ABEF */
+
+    /* Save state */
+    _mm_storeu_si128((__m128i*) &state[0], STATE0);
+    _mm_storeu_si128((__m128i*) &state[4], STATE1);
+}
+
+/* Process multiple blocks. The caller is responsible for setting the initial */
+/*  state, and the caller is responsible for padding the final block.        */
+void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length)
+{
+    __m128i STATE0, STATE1;
+
+    load_state(state, &STATE0, &STATE1);
+    sha256_x86_blocks(&STATE0, &STATE1, data, length, 1);
+    store_state(state, STATE0, STATE1);
+}
+
+/* Process multiple blocks given as host-order message words, like */
+/*  digests kept in word form. No byte shuffles on the message.    */
+void sha256_process_words_x86(uint32_t state[8], const uint32_t data[], uint32_t length)
+{
+    __m128i STATE0, STATE1;
+
+    load_state(state, &STATE0, &STATE1);
+    sha256_x86_blocks(&STATE0, &STATE1, (const uint8_t*) data, length, 0);
+    store_state(state, STATE0, STATE1);
+}
+
+/* The state in native layout is ABEF in native[0..3] and CDGH in */
+/*  native[4..7]. A context that keeps it this way between calls   */
+/*  skips the state shuffles, and converts only at the end.        */
+void sha256_to_native_x86(uint32_t native[8], const uint32_t state[8])
+{
+    __m128i STATE0, STATE1;
+
+    load_state(state, &STATE0, &STATE1);
+    _mm_storeu_si128((__m128i*) &native[0], STATE0);
+    _mm_storeu_si128((__m128i*) &native[4], STATE1);
+}
+
+void sha256_from_native_x86(uint32_t state[8], const uint32_t native[8])
+{
+    store_state(state, _mm_loadu_si128((const __m128i*) &native[0]),
+                       _mm_loadu_si128((const __m128i*) &native[4]));
+}
+
+void sha256_process_native_x86(uint32_t native[8], const uint8_t data[], uint32_t length)
+{
+    __m128i STATE0 = _mm_loadu_si128((const __m128i*) &native[0]);
+    __m128i STATE1 = _mm_loadu_si128((const __m128i*) &native[4]);
+
+    sha256_x86_blocks(&STATE0, &STATE1, data, length, 1);
+    _mm_storeu_si128((__m128i*) &native[0], STATE0);
+    _mm_storeu_si128((__m128i*) &native[4], STATE1);
+}
+
+/* Process multiple blocks of two independent messages. The rounds of  */
+/*  the two messages are interleaved so one stream runs while the      */
+/*  other waits on sha256rnds2 latency. Both messages have the same    */
+/*  length. The caller is responsible for setting the initial states,  */
+/*  and the caller is responsible for padding the final blocks.        */
+void sha256_process_x86_x2(uint32_t state1[8], uint32_t state2[8],
+                           const uint8_t data1[], const uint8_t data2[], uint32_t length)
+{
+    __m128i STATE0A, STATE1A, STATE0B, STATE1B;
+    __m128i MSGA, TMPA, MSGB, TMPB;
+    __m128i MSG0A, MSG1A, MSG2A, MSG3A;
+    __m128i MSG0B, MSG1B, MSG2B, MSG3B;
+    __m128i ABEF_SAVEA, CDGH_SAVEA, ABEF_SAVEB, CDGH_SAVEB;
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    /* Load initial values */
+    TMPA = _mm_loadu_si128((const __m128i*) &state1[0]);
+    STATE1A = _mm_loadu_si128((const __m128i*) &state1[4]);
+    TMPB = _mm_loadu_si128((const __m128i*) &state2[0]);
+    STATE1B = _mm_loadu_si128((const __m128i*) &state2[4]);
+
+    TMPA = _mm_shuffle_epi32(TMPA, 0xB1);            /* CDAB */
+    STATE1A = _mm_shuffle_epi32(STATE1A, 0x1B);      /* EFGH */
+    STATE0A = _mm_alignr_epi8(TMPA, STATE1A, 8);     /* ABEF */
+    STATE1A = _mm_blend_epi16(STATE1A, TMPA, 0xF0);  /* CDGH */
+    TMPB = _mm_shuffle_epi32(TMPB, 0xB1);
+    STATE1B = _mm_shuffle_epi32(STATE1B, 0x1B);
+    STATE0B = _mm_alignr_epi8(TMPB, STATE1B, 8);
+    STATE1B = _mm_blend_epi16(STATE1B, TMPB, 0xF0);
+
+    while (length >= 64)
+    {
+        /* Save current state */
+        ABEF_SAVEA = STATE0A;
+        ABEF_SAVEB = STATE0B;
+        CDGH_SAVEA = STATE1A;
+        CDGH_SAVEB = STATE1B;
+
+        /* Rounds 0-3 */
+        MSGA = _mm_loadu_si128((const __m128i*) (data1+0));
+        MSGB = _mm_loadu_si128((const __m128i*) (data2+0));
+        MSG0A = _mm_shuffle_epi8(MSGA, MASK);
+        MSG0B = _mm_shuffle_epi8(MSGB, MASK);
+        MSGA = _mm_add_epi32(MSG0A, _mm_set_epi64x(0xE9B5DBA5B5C0FBCFULL, 0x71374491428A2F98ULL));
+        MSGB = _mm_add_epi32(MSG0B, _mm_set_epi64x(0xE9B5DBA5B5C0FBCFULL, 0x71374491428A2F98ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+
+        /* Rounds 4-7 */
+        MSG1A = _mm_loadu_si128((const __m128i*) (data1+16));
+        MSG1B = _mm_loadu_si128((const __m128i*) (data2+16));
+        MSG1A = _mm_shuffle_epi8(MSG1A, MASK);
+        MSG1B = _mm_shuffle_epi8(MSG1B, MASK);
+        MSGA = _mm_add_epi32(MSG1A, _mm_set_epi64x(0xAB1C5ED5923F82A4ULL, 0x59F111F13956C25BULL));
+        MSGB = _mm_add_epi32(MSG1B, _mm_set_epi64x(0xAB1C5ED5923F82A4ULL, 0x59F111F13956C25BULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG0A = _mm_sha256msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha256msg1_epu32(MSG0B, MSG1B);
+
+        /* Rounds 8-11 */
+        MSG2A = _mm_loadu_si128((const __m128i*) (data1+32));
+        MSG2B = _mm_loadu_si128((const __m128i*) (data2+32));
+        MSG2A = _mm_shuffle_epi8(MSG2A, MASK);
+        MSG2B = _mm_shuffle_epi8(MSG2B, MASK);
+        MSGA = _mm_add_epi32(MSG2A, _mm_set_epi64x(0x550C7DC3243185BEULL, 0x12835B01D807AA98ULL));
+        MSGB = _mm_add_epi32(MSG2B, _mm_set_epi64x(0x550C7DC3243185BEULL, 0x12835B01D807AA98ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG1A = _mm_sha256msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha256msg1_epu32(MSG1B, MSG2B);
+
+        /* Rounds 12-15 */
+        MSG3A = _mm_loadu_si128((const __m128i*) (data1+48));
+        MSG3B = _mm_loadu_si128((const __m128i*) (data2+48));
+        MSG3A = _mm_shuffle_epi8(MSG3A, MASK);
+        MSG3B = _mm_shuffle_epi8(MSG3B, MASK);
+        MSGA = _mm_add_epi32(MSG3A, _mm_set_epi64x(0xC19BF1749BDC06A7ULL, 0x80DEB1FE72BE5D74ULL));
+        MSGB = _mm_add_epi32(MSG3B, _mm_set_epi64x(0xC19BF1749BDC06A7ULL, 0x80DEB1FE72BE5D74ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG3A, MSG2A, 4);
+        TMPB = _mm_alignr_epi8(MSG3B, MSG2B, 4);
+        MSG0A = _mm_add_epi32(MSG0A, TMPA);
+        MSG0B = _mm_add_epi32(MSG0B, TMPB);
+        MSG0A = _mm_sha256msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha256msg2_epu32(MSG0B, MSG3B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG2A = _mm_sha256msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha256msg1_epu32(MSG2B, MSG3B);
+
+        /* Rounds 16-19 */
+        MSGA = _mm_add_epi32(MSG0A, _mm_set_epi64x(0x240CA1CC0FC19DC6ULL, 0xEFBE4786E49B69C1ULL));
+        MSGB = _mm_add_epi32(MSG0B, _mm_set_epi64x(0x240CA1CC0FC19DC6ULL, 0xEFBE4786E49B69C1ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG0A, MSG3A, 4);
+        TMPB = _mm_alignr_epi8(MSG0B, MSG3B, 4);
+        MSG1A = _mm_add_epi32(MSG1A, TMPA);
+        MSG1B = _mm_add_epi32(MSG1B, TMPB);
+        MSG1A = _mm_sha256msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha256msg2_epu32(MSG1B, MSG0B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG3A = _mm_sha256msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha256msg1_epu32(MSG3B, MSG0B);
+
+        /* Rounds 20-23 */
+        MSGA = _mm_add_epi32(MSG1A, _mm_set_epi64x(0x76F988DA5CB0A9DCULL, 0x4A7484AA2DE92C6FULL));
+        MSGB = _mm_add_epi32(MSG1B, _mm_set_epi64x(0x76F988DA5CB0A9DCULL, 0x4A7484AA2DE92C6FULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG1A, MSG0A, 4);
+        TMPB = _mm_alignr_epi8(MSG1B, MSG0B, 4);
+        MSG2A = _mm_add_epi32(MSG2A, TMPA);
+        MSG2B = _mm_add_epi32(MSG2B, TMPB);
+        MSG2A = _mm_sha256msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha256msg2_epu32(MSG2B, MSG1B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG0A = _mm_sha256msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha256msg1_epu32(MSG0B, MSG1B);
+
+        /* Rounds 24-27 */
+        MSGA = _mm_add_epi32(MSG2A, _mm_set_epi64x(0xBF597FC7B00327C8ULL, 0xA831C66D983E5152ULL));
+        MSGB = _mm_add_epi32(MSG2B, _mm_set_epi64x(0xBF597FC7B00327C8ULL, 0xA831C66D983E5152ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG2A, MSG1A, 4);
+        TMPB = _mm_alignr_epi8(MSG2B, MSG1B, 4);
+        MSG3A = _mm_add_epi32(MSG3A, TMPA);
+        MSG3B = _mm_add_epi32(MSG3B, TMPB);
+        MSG3A = _mm_sha256msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha256msg2_epu32(MSG3B, MSG2B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG1A = _mm_sha256msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha256msg1_epu32(MSG1B, MSG2B);
+
+        /* Rounds 28-31 */
+        MSGA = _mm_add_epi32(MSG3A, _mm_set_epi64x(0x1429296706CA6351ULL,  0xD5A79147C6E00BF3ULL));
+        MSGB = _mm_add_epi32(MSG3B, _mm_set_epi64x(0x1429296706CA6351ULL,  0xD5A79147C6E00BF3ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG3A, MSG2A, 4);
+        TMPB = _mm_alignr_epi8(MSG3B, MSG2B, 4);
+        MSG0A = _mm_add_epi32(MSG0A, TMPA);
+        MSG0B = _mm_add_epi32(MSG0B, TMPB);
+        MSG0A = _mm_sha256msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha256msg2_epu32(MSG0B, MSG3B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG2A = _mm_sha256msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha256msg1_epu32(MSG2B, MSG3B);
+
+        /* Rounds 32-35 */
+        MSGA = _mm_add_epi32(MSG0A, _mm_set_epi64x(0x53380D134D2C6DFCULL, 0x2E1B213827B70A85ULL));
+        MSGB = _mm_add_epi32(MSG0B, _mm_set_epi64x(0x53380D134D2C6DFCULL, 0x2E1B213827B70A85ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG0A, MSG3A, 4);
+        TMPB = _mm_alignr_epi8(MSG0B, MSG3B, 4);
+        MSG1A = _mm_add_epi32(MSG1A, TMPA);
+        MSG1B = _mm_add_epi32(MSG1B, TMPB);
+        MSG1A = _mm_sha256msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha256msg2_epu32(MSG1B, MSG0B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG3A = _mm_sha256msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha256msg1_epu32(MSG3B, MSG0B);
+
+        /* Rounds 36-39 */
+        MSGA = _mm_add_epi32(MSG1A, _mm_set_epi64x(0x92722C8581C2C92EULL, 0x766A0ABB650A7354ULL));
+        MSGB = _mm_add_epi32(MSG1B, _mm_set_epi64x(0x92722C8581C2C92EULL, 0x766A0ABB650A7354ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG1A, MSG0A, 4);
+        TMPB = _mm_alignr_epi8(MSG1B, MSG0B, 4);
+        MSG2A = _mm_add_epi32(MSG2A, TMPA);
+        MSG2B = _mm_add_epi32(MSG2B, TMPB);
+        MSG2A = _mm_sha256msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha256msg2_epu32(MSG2B, MSG1B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG0A = _mm_sha256msg1_epu32(MSG0A, MSG1A);
+        MSG0B = _mm_sha256msg1_epu32(MSG0B, MSG1B);
+
+        /* Rounds 40-43 */
+        MSGA = _mm_add_epi32(MSG2A, _mm_set_epi64x(0xC76C51A3C24B8B70ULL, 0xA81A664BA2BFE8A1ULL));
+        MSGB = _mm_add_epi32(MSG2B, _mm_set_epi64x(0xC76C51A3C24B8B70ULL, 0xA81A664BA2BFE8A1ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG2A, MSG1A, 4);
+        TMPB = _mm_alignr_epi8(MSG2B, MSG1B, 4);
+        MSG3A = _mm_add_epi32(MSG3A, TMPA);
+        MSG3B = _mm_add_epi32(MSG3B, TMPB);
+        MSG3A = _mm_sha256msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha256msg2_epu32(MSG3B, MSG2B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG1A = _mm_sha256msg1_epu32(MSG1A, MSG2A);
+        MSG1B = _mm_sha256msg1_epu32(MSG1B, MSG2B);
+
+        /* Rounds 44-47 */
+        MSGA = _mm_add_epi32(MSG3A, _mm_set_epi64x(0x106AA070F40E3585ULL, 0xD6990624D192E819ULL));
+        MSGB = _mm_add_epi32(MSG3B, _mm_set_epi64x(0x106AA070F40E3585ULL, 0xD6990624D192E819ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG3A, MSG2A, 4);
+        TMPB = _mm_alignr_epi8(MSG3B, MSG2B, 4);
+        MSG0A = _mm_add_epi32(MSG0A, TMPA);
+        MSG0B = _mm_add_epi32(MSG0B, TMPB);
+        MSG0A = _mm_sha256msg2_epu32(MSG0A, MSG3A);
+        MSG0B = _mm_sha256msg2_epu32(MSG0B, MSG3B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG2A = _mm_sha256msg1_epu32(MSG2A, MSG3A);
+        MSG2B = _mm_sha256msg1_epu32(MSG2B, MSG3B);
+
+        /* Rounds 48-51 */
+        MSGA = _mm_add_epi32(MSG0A, _mm_set_epi64x(0x34B0BCB52748774CULL, 0x1E376C0819A4C116ULL));
+        MSGB = _mm_add_epi32(MSG0B, _mm_set_epi64x(0x34B0BCB52748774CULL, 0x1E376C0819A4C116ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG0A, MSG3A, 4);
+        TMPB = _mm_alignr_epi8(MSG0B, MSG3B, 4);
+        MSG1A = _mm_add_epi32(MSG1A, TMPA);
+        MSG1B = _mm_add_epi32(MSG1B, TMPB);
+        MSG1A = _mm_sha256msg2_epu32(MSG1A, MSG0A);
+        MSG1B = _mm_sha256msg2_epu32(MSG1B, MSG0B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+        MSG3A = _mm_sha256msg1_epu32(MSG3A, MSG0A);
+        MSG3B = _mm_sha256msg1_epu32(MSG3B, MSG0B);
+
+        /* Rounds 52-55 */
+        MSGA = _mm_add_epi32(MSG1A, _mm_set_epi64x(0x682E6FF35B9CCA4FULL, 0x4ED8AA4A391C0CB3ULL));
+        MSGB = _mm_add_epi32(MSG1B, _mm_set_epi64x(0x682E6FF35B9CCA4FULL, 0x4ED8AA4A391C0CB3ULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG1A, MSG0A, 4);
+        TMPB = _mm_alignr_epi8(MSG1B, MSG0B, 4);
+        MSG2A = _mm_add_epi32(MSG2A, TMPA);
+        MSG2B = _mm_add_epi32(MSG2B, TMPB);
+        MSG2A = _mm_sha256msg2_epu32(MSG2A, MSG1A);
+        MSG2B = _mm_sha256msg2_epu32(MSG2B, MSG1B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+
+        /* Rounds 56-59 */
+        MSGA = _mm_add_epi32(MSG2A, _mm_set_epi64x(0x8CC7020884C87814ULL, 0x78A5636F748F82EEULL));
+        MSGB = _mm_add_epi32(MSG2B, _mm_set_epi64x(0x8CC7020884C87814ULL, 0x78A5636F748F82EEULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        TMPA = _mm_alignr_epi8(MSG2A, MSG1A, 4);
+        TMPB = _mm_alignr_epi8(MSG2B, MSG1B, 4);
+        MSG3A = _mm_add_epi32(MSG3A, TMPA);
+        MSG3B = _mm_add_epi32(MSG3B, TMPB);
+        MSG3A = _mm_sha256msg2_epu32(MSG3A, MSG2A);
+        MSG3B = _mm_sha256msg2_epu32(MSG3B, MSG2B);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+
+        /* Rounds 60-63 */
+        MSGA = _mm_add_epi32(MSG3A, _mm_set_epi64x(0xC67178F2BEF9A3F7ULL, 0xA4506CEB90BEFFFAULL));
+        MSGB = _mm_add_epi32(MSG3B, _mm_set_epi64x(0xC67178F2BEF9A3F7ULL, 0xA4506CEB90BEFFFAULL));
+        STATE1A = _mm_sha256rnds2_epu32(STATE1A, STATE0A, MSGA);
+        STATE1B = _mm_sha256rnds2_epu32(STATE1B, STATE0B, MSGB);
+        MSGA = _mm_shuffle_epi32(MSGA, 0x0E);
+        MSGB = _mm_shuffle_epi32(MSGB, 0x0E);
+        STATE0A = _mm_sha256rnds2_epu32(STATE0A, STATE1A, MSGA);
+        STATE0B = _mm_sha256rnds2_epu32(STATE0B, STATE1B, MSGB);
+
+        /* Combine state  */
+        STATE0A = _mm_add_epi32(STATE0A, ABEF_SAVEA);
+        STATE0B = _mm_add_epi32(STATE0B, ABEF_SAVEB);
+        STATE1A = _mm_add_epi32(STATE1A, CDGH_SAVEA);
+        STATE1B = _mm_add_epi32(STATE1B, CDGH_SAVEB);
+
+        data1 += 64;
+        data2 += 64;
+        length -= 64;
+    }
+
+    TMPA = _mm_shuffle_epi32(STATE0A, 0x1B);         /* FEBA */
+    STATE1A = _mm_shuffle_epi32(STATE1A, 0xB1);      /* DCHG */
+    STATE0A = _mm_blend_epi16(TMPA, STATE1A, 0xF0);  /* DCBA */
+    STATE1A = _mm_alignr_epi8(STATE1A, TMPA, 8);     /* ABEF */
+    TMPB = _mm_shuffle_epi32(STATE0B, 0x1B);
+    STATE1B = _mm_shuffle_epi32(STATE1B, 0xB1);
+    STATE0B = _mm_blend_epi16(TMPB, STATE1B, 0xF0);
+    STATE1B = _mm_alignr_epi8(STATE1B, TMPB, 8);
+
+    /* Save state */
+    _mm_storeu_si128((__m128i*) &state1[0], STATE0A);
+    _mm_storeu_si128((__m128i*) &state1[4], STATE1A);
+    _mm_storeu_si128((__m128i*) &state2[0], STATE0B);
+    _mm_storeu_si128((__m128i*) &state2[4], STATE1B);
+}
+
+/* SHA-256 of exactly 64 bytes, like two child digests. The first */
+/*  block is the message and the second block runs rounds only.  */
+void sha256_64_x86(uint8_t digest[32], const uint8_t data[64])
+{
+    __m128i STATE0, STATE1;
+    __m128i MSG, TMP;
+    __m128i ABEF_SAVE, CDGH_SAVE;
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    unsigned int i;
+
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_process_x86(state, data, 64);
+
+    /* Load initial values */
+    TMP = _mm_loadu_si128((const __m128i*) &state[0]);
+    STATE1 = _mm_loadu_si128((const __m128i*) &state[4]);
+
+    TMP = _mm_shuffle_epi32(TMP, 0xB1);          /* CDAB */
+    STATE1 = _mm_shuffle_epi32(STATE1, 0x1B);    /* EFGH */
+    STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);    /* ABEF */
+    STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0); /* CDGH */
+
+    /* Save current state */
+    ABEF_SAVE = STATE0;
+    CDGH_SAVE = STATE1;
+
+    /* Padding block, no message schedule */
+    for (i = 0; i < 16; ++i)
+    {
+        MSG = _mm_loadu_si128((const __m128i*) &KW_PAD64[4*i]);
+        STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+        MSG = _mm_shuffle_epi32(MSG, 0x0E);
+        STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);
+    }
+
+    /* Combine state  */
+    STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+    STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+
     TMP = _mm_shuffle_epi32(STATE0, 0x1B);       /* FEBA */
     STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);    /* DCHG */
     STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0); /* DCBA */
     STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);    /* ABEF */
 
-    /* Save state */
-    _mm_storeu_si128((__m128i*) &state[0], STATE0);
-    _mm_storeu_si128((__m128i*) &state[4], STATE1);
+    /* Save digest */
+    _mm_storeu_si128((__m128i*) &digest[0], _mm_shuffle_epi8(STATE0, MASK));
+    _mm_storeu_si128((__m128i*) &digest[16], _mm_shuffle_epi8(STATE1, MASK));
 }
 
 #if defined(TEST_MAIN)
@@ -252,6 +735,102 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xE3) && (b2 == 0xB0) && (b3 == 0xC4) && (b4 == 0x42) &&
                     (b5 == 0x98) && (b6 == 0xFC) && (b7 == 0x1C) && (b8 == 0x14));
 
+    /* Two streams. The second message is three blocks of filler */
+    /*  and its result must match the single stream kernel.       */
+    uint8_t filler[192];
+    unsigned int i;
+    for (i = 0; i < sizeof(filler); ++i)
+        filler[i] = (uint8_t)(i * 13 + 1);
+
+    uint8_t triple[192];
+    memcpy(triple, message, 64);
+    memcpy(triple+64, message, 64);
+    memcpy(triple+128, message, 64);
+
+    uint32_t x2_state1[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    uint32_t x2_state2[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    uint32_t ref_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    sha256_process_x86_x2(x2_state1, x2_state2, triple, filler, sizeof(filler));
+    sha256_process_x86(ref_state, filler, sizeof(filler));
+    success = success && (memcmp(x2_state2, ref_state, sizeof(ref_state)) == 0);
+
+    memcpy(ref_state, x2_state1, sizeof(ref_state));
+    memcpy(x2_state1, state, sizeof(x2_state1));
+    sha256_process_x86(x2_state1, message, 64);
+    sha256_process_x86(x2_state1, message, 64);
+    success = success && (memcmp(x2_state1, ref_state, sizeof(ref_state)) == 0);
+
+    /* A 64-byte message through the specialized kernel must match */
+    /*  the message and its padding block through the generic one. */
+    uint8_t blocks[128], digest[32];
+    for (i = 0; i < 64; ++i)
+        blocks[i] = (uint8_t)(i * 29 + 7);
+    memset(blocks + 64, 0x00, 64);
+    blocks[64] = 0x80;
+    blocks[126] = 0x02;
+
+    uint32_t ref64_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_process_x86(ref64_state, blocks, sizeof(blocks));
+    sha256_64_x86(digest, blocks);
+    for (i = 0; i < 8; ++i)
+    {
+        success = success && (digest[4*i+0] == (uint8_t)(ref64_state[i] >> 24));
+        success = success && (digest[4*i+1] == (uint8_t)(ref64_state[i] >> 16));
+        success = success && (digest[4*i+2] == (uint8_t)(ref64_state[i] >>  8));
+        success = success && (digest[4*i+3] == (uint8_t)(ref64_state[i] >>  0));
+    }
+
+    /* The same blocks as host-order words */
+    uint32_t words[32];
+    uint32_t words_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    for (i = 0; i < 32; ++i)
+        words[i] = ((uint32_t)blocks[4*i+0] << 24) | ((uint32_t)blocks[4*i+1] << 16) |
+                   ((uint32_t)blocks[4*i+2] <<  8) | ((uint32_t)blocks[4*i+3] <<  0);
+    sha256_process_words_x86(words_state, words, sizeof(words));
+    success = success && (memcmp(words_state, ref64_state, sizeof(ref64_state)) == 0);
+
+    /* The same blocks one call at a time in native layout */
+    uint32_t native[8];
+    sha256_to_native_x86(native, state);
+    sha256_from_native_x86(words_state, native);
+    success = success && (memcmp(words_state, state, sizeof(state)) == 0);
+
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_to_native_x86(native, iv);
+    sha256_process_native_x86(native, blocks, 64);
+    sha256_process_native_x86(native, blocks + 64, 64);
+    sha256_from_native_x86(words_state, native);
+    success = success && (memcmp(words_state, ref64_state, sizeof(ref64_state)) == 0);
+
+    /* f5a5fd42d16a2030... */
+    memset(blocks, 0x00, 64);
+    sha256_64_x86(digest, blocks);
+    printf("SHA256 hash of 64 zero bytes: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        digest[0], digest[1], digest[2], digest[3],
+        digest[4], digest[5], digest[6], digest[7]);
+    success = success && (digest[0] == 0xF5) && (digest[1] == 0xA5) &&
+                         (digest[2] == 0xFD) && (digest[3] == 0x42);
+
     if (success)
         printf("Success!\n");
     else
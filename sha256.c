@@ -28,6 +28,29 @@ static const uint32_t K256[] =
     0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
 };
 
+/* K+W for the padding block of a 64-byte message. That block  */
+/*  is the same for every 64-byte message, so its whole message */
+/*  schedule is folded into the round constants.                */
+static const uint32_t KW_PAD64[] =
+{
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
 #define ROTATE(x,y)  (((x)>>(y)) | ((x)<<(32-(y))))
 #define Sigma0(x)    (ROTATE((x), 2) ^ ROTATE((x),13) ^ ROTATE((x),22))
 #define Sigma1(x)    (ROTATE((x), 6) ^ ROTATE((x),11) ^ ROTATE((x),25))
@@ -44,77 +67,174 @@ uint32_t B2U32(uint8_t val, uint8_t sh)
     return ((uint32_t)val) << sh;
 }
 
+/* Big-endian load. GCC and Clang turn the memcpy into a plain load */
+/*  and the builtin into bswap or movbe.                           */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+static inline uint32_t LOAD32_BE(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return __builtin_bswap32(v);
+}
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+static inline uint32_t LOAD32_BE(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+#else
+# define LOAD32_BE(p) (B2U32((p)[0], 24) | B2U32((p)[1], 16) | B2U32((p)[2], 8) | B2U32((p)[3], 0))
+#endif
+
+/* One round. The caller renames the working variables instead of */
+/*  moving them: h receives the new a, and d the new e.           */
+#define ROUND(a,b,c,d,e,f,g,h,k,w)                                     \
+    h += Sigma1(e) + ((g) ^ ((e) & ((f) ^ (g)))) + (k) + (w);          \
+    d += h;                                                            \
+    h += Sigma0(a) + (((a) & (b)) | ((c) & ((a) | (b))));
+
+/* Message schedule word i, in place in the 16-word window */
+#define SCHEDULE(i)  (X[(i)&15] += sigma1(X[((i)+14)&15]) + X[((i)+9)&15] + sigma0(X[((i)+1)&15]))
+
+/* Sixteen rounds from round r. W(i) yields message word r + i. */
+#define ROUNDS16(r, W)                                                 \
+    ROUND(a,b,c,d,e,f,g,h, K256[(r)+ 0], W( 0));                       \
+    ROUND(h,a,b,c,d,e,f,g, K256[(r)+ 1], W( 1));                       \
+    ROUND(g,h,a,b,c,d,e,f, K256[(r)+ 2], W( 2));                       \
+    ROUND(f,g,h,a,b,c,d,e, K256[(r)+ 3], W( 3));                       \
+    ROUND(e,f,g,h,a,b,c,d, K256[(r)+ 4], W( 4));                       \
+    ROUND(d,e,f,g,h,a,b,c, K256[(r)+ 5], W( 5));                       \
+    ROUND(c,d,e,f,g,h,a,b, K256[(r)+ 6], W( 6));                       \
+    ROUND(b,c,d,e,f,g,h,a, K256[(r)+ 7], W( 7));                       \
+    ROUND(a,b,c,d,e,f,g,h, K256[(r)+ 8], W( 8));                       \
+    ROUND(h,a,b,c,d,e,f,g, K256[(r)+ 9], W( 9));                       \
+    ROUND(g,h,a,b,c,d,e,f, K256[(r)+10], W(10));                       \
+    ROUND(f,g,h,a,b,c,d,e, K256[(r)+11], W(11));                       \
+    ROUND(e,f,g,h,a,b,c,d, K256[(r)+12], W(12));                       \
+    ROUND(d,e,f,g,h,a,b,c, K256[(r)+13], W(13));                       \
+    ROUND(c,d,e,f,g,h,a,b, K256[(r)+14], W(14));                       \
+    ROUND(b,c,d,e,f,g,h,a, K256[(r)+15], W(15));
+
+/* Message word i of the block, already in the window */
+#define WORD(i)      (X[i])
+
+/* Compress one block whose message words are in X, in host order */
+static inline void sha256_block(uint32_t state[8], uint32_t X[16])
+{
+    uint32_t a, b, c, d, e, f, g, h;
+    unsigned int r;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    /* Sixteen rounds per step, so every window index is a constant */
+    /*  and the variables return to their names after each step.   */
+    ROUNDS16(0, WORD);
+    for (r = 16; r < 64; r += 16)
+    {
+        ROUNDS16(r, SCHEDULE);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
 /* Process multiple blocks. The caller is responsible for setting the initial */
 /*  state, and the caller is responsible for padding the final block.        */
 void sha256_process(uint32_t state[8], const uint8_t data[], uint32_t length)
 {
-    uint32_t a, b, c, d, e, f, g, h, s0, s1, T1, T2;
-    uint32_t X[16], i;
+    uint32_t X[16];
+    unsigned int i;
 
     size_t blocks = length / 64;
     while (blocks--)
     {
-        a = state[0];
-        b = state[1];
-        c = state[2];
-        d = state[3];
-        e = state[4];
-        f = state[5];
-        g = state[6];
-        h = state[7];
-
         for (i = 0; i < 16; i++)
-        {
-            X[i] = B2U32(data[0], 24) | B2U32(data[1], 16) | B2U32(data[2], 8) | B2U32(data[3], 0);
-            data += 4;
-
-            T1 = h;
-            T1 += Sigma1(e);
-            T1 += Ch(e, f, g);
-            T1 += K256[i];
-            T1 += X[i];
-
-            T2 = Sigma0(a);
-            T2 += Maj(a, b, c);
-
-            h = g;
-            g = f;
-            f = e;
-            e = d + T1;
-            d = c;
-            c = b;
-            b = a;
-            a = T1 + T2;
-        }
-
-        for (; i < 64; i++)
-        {
-            s0 = X[(i + 1) & 0x0f];
-            s0 = sigma0(s0);
-            s1 = X[(i + 14) & 0x0f];
-            s1 = sigma1(s1);
-
-            T1 = X[i & 0xf] += s0 + s1 + X[(i + 9) & 0xf];
-            T1 += h + Sigma1(e) + Ch(e, f, g) + K256[i];
-            T2 = Sigma0(a) + Maj(a, b, c);
-            h = g;
-            g = f;
-            f = e;
-            e = d + T1;
-            d = c;
-            c = b;
-            b = a;
-            a = T1 + T2;
-        }
-
-        state[0] += a;
-        state[1] += b;
-        state[2] += c;
-        state[3] += d;
-        state[4] += e;
-        state[5] += f;
-        state[6] += g;
-        state[7] += h;
+            X[i] = LOAD32_BE(data + 4*i);
+
+        sha256_block(state, X);
+        data += 64;
+    }
+}
+
+/* Process multiple blocks given as host-order message words, like */
+/*  digests kept in word form. length is in bytes, as above.       */
+void sha256_process_words(uint32_t state[8], const uint32_t data[], uint32_t length)
+{
+    uint32_t X[16];
+
+    size_t blocks = length / 64;
+    while (blocks--)
+    {
+        memcpy(X, data, 64);
+        sha256_block(state, X);
+        data += 16;
+    }
+}
+
+/* SHA-256 of exactly 64 bytes, like two child digests. The first */
+/*  block is the message and the second block runs rounds only.  */
+void sha256_64(uint8_t digest[32], const uint8_t data[64])
+{
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    uint32_t a, b, c, d, e, f, g, h, T1, T2, i;
+
+    sha256_process(state, data, 64);
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    for (i = 0; i < 64; i++)
+    {
+        T1 = h + Sigma1(e) + Ch(e, f, g) + KW_PAD64[i];
+        T2 = Sigma0(a) + Maj(a, b, c);
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+
+    for (i = 0; i < 8; i++)
+    {
+        digest[4*i+0] = (uint8_t)(state[i] >> 24);
+        digest[4*i+1] = (uint8_t)(state[i] >> 16);
+        digest[4*i+2] = (uint8_t)(state[i] >>  8);
+        digest[4*i+3] = (uint8_t)(state[i] >>  0);
     }
 }
 
@@ -154,6 +274,52 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xE3) && (b2 == 0xB0) && (b3 == 0xC4) && (b4 == 0x42) &&
                     (b5 == 0x98) && (b6 == 0xFC) && (b7 == 0x1C) && (b8 == 0x14));
 
+    /* A 64-byte message through the specialized kernel must match */
+    /*  the message and its padding block through the generic one. */
+    uint8_t blocks[128], digest[32];
+    unsigned int i;
+    for (i = 0; i < 64; ++i)
+        blocks[i] = (uint8_t)(i * 29 + 7);
+    memset(blocks + 64, 0x00, 64);
+    blocks[64] = 0x80;
+    blocks[126] = 0x02;
+
+    uint32_t ref_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    sha256_process(ref_state, blocks, sizeof(blocks));
+    sha256_64(digest, blocks);
+    for (i = 0; i < 8; ++i)
+    {
+        success = success && (digest[4*i+0] == (uint8_t)(ref_state[i] >> 24));
+        success = success && (digest[4*i+1] == (uint8_t)(ref_state[i] >> 16));
+        success = success && (digest[4*i+2] == (uint8_t)(ref_state[i] >>  8));
+        success = success && (digest[4*i+3] == (uint8_t)(ref_state[i] >>  0));
+    }
+
+    /* The same blocks as host-order words */
+    uint32_t words[32];
+    uint32_t words_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    for (i = 0; i < 32; ++i)
+        words[i] = ((uint32_t)blocks[4*i+0] << 24) | ((uint32_t)blocks[4*i+1] << 16) |
+                   ((uint32_t)blocks[4*i+2] <<  8) | ((uint32_t)blocks[4*i+3] <<  0);
+    sha256_process_words(words_state, words, sizeof(words));
+    success = success && (memcmp(words_state, ref_state, sizeof(ref_state)) == 0);
+
+    /* f5a5fd42d16a2030... */
+    memset(blocks, 0x00, 64);
+    sha256_64(digest, blocks);
+    printf("SHA256 hash of 64 zero bytes: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        digest[0], digest[1], digest[2], digest[3],
+        digest[4], digest[5], digest[6], digest[7]);
+    success = success && (digest[0] == 0xF5) && (digest[1] == 0xA5) &&
+                         (digest[2] == 0xFD) && (digest[3] == 0x42);
+
     if (success)
         printf("Success!\n");
     else
@@ -0,0 +1,308 @@
+/* sha256d-arm.c - Double SHA-256 of 64-byte and 80-byte messages */
+/*   using the ARMv8 SHA extensions                               */
+/*   Written and placed in public domain                          */
+
+/* The rounds are the same as sha256_process_arm. The state is in  */
+/* ABCD/EFGH order, which is also the order of the message words,  */
+/* so the digest of the first hash is the message of the second    */
+/* hash as is. The rounds whose message is constant take their     */
+/* K+W from a table.                                               */
+
+/* g++ -c -march=armv8-a+crypto sha256-arm.c                                    */
+/* g++ -DTEST_MAIN -march=armv8-a+crypto sha256d-arm.c sha256-arm.o -o sha256d.exe */
+
+#if defined(__arm__) || defined(__aarch32__) || defined(__arm64__) || defined(__aarch64__) || defined(_M_ARM)
+# if defined(__GNUC__)
+#  include <stdint.h>
+# endif
+# if defined(__ARM_NEON) || defined(_MSC_VER) || defined(__GNUC__)
+#  include <arm_neon.h>
+# endif
+/* GCC and LLVM Clang, but not Apple Clang */
+# if defined(__GNUC__) && !defined(__apple_build_version__)
+#  if defined(__ARM_ACLE) || defined(__ARM_FEATURE_CRYPTO)
+#   include <arm_acle.h>
+#  endif
+# endif
+#endif  /* ARM Headers */
+
+#include "sha256d.h"
+
+static const uint32_t K[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* K+W for the padding block of a 64-byte message. The whole */
+/*  schedule is constant, so the rounds need no message.     */
+static const uint32_t KW_PAD64[] =
+{
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
+/* K+W for rounds 8-15 of the second hash, whose message is */
+/*  the 32-byte digest followed by the padding.             */
+static const uint32_t KW_DIGEST[] =
+{
+    0x5807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF274
+};
+
+/* K+W for rounds 4-15 of the second block of an 80-byte message */
+static const uint32_t KW_TAIL80[] =
+{
+    0xB956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF3F4
+};
+
+/* Four rounds with K+W already added */
+#define RNDS4(KW) \
+    do { \
+        const uint32x4_t KW_ = (KW); \
+        const uint32x4_t ABCD_ = STATE0; \
+        STATE0 = vsha256hq_u32(STATE0, STATE1, KW_); \
+        STATE1 = vsha256h2q_u32(STATE1, ABCD_, KW_); \
+    } while (0)
+
+/* Schedule message words 4q to 4q+3 into MSG<a> and run their rounds */
+#define QUAD(a, b, c, d, q) \
+    do { \
+        MSG##a = vsha256su1q_u32(vsha256su0q_u32(MSG##a, MSG##b), MSG##c, MSG##d); \
+        RNDS4(vaddq_u32(MSG##a, vld1q_u32(&K[4*(q)]))); \
+    } while (0)
+
+#define ROUNDS_0_15 \
+    RNDS4(vaddq_u32(MSG0, vld1q_u32(&K[0x00]))); \
+    RNDS4(vaddq_u32(MSG1, vld1q_u32(&K[0x04]))); \
+    RNDS4(vaddq_u32(MSG2, vld1q_u32(&K[0x08]))); \
+    RNDS4(vaddq_u32(MSG3, vld1q_u32(&K[0x0c])))
+
+#define ROUNDS_16_63 \
+    QUAD(0, 1, 2, 3, 4); \
+    QUAD(1, 2, 3, 0, 5); \
+    QUAD(2, 3, 0, 1, 6); \
+    QUAD(3, 0, 1, 2, 7); \
+    QUAD(0, 1, 2, 3, 8); \
+    QUAD(1, 2, 3, 0, 9); \
+    QUAD(2, 3, 0, 1, 10); \
+    QUAD(3, 0, 1, 2, 11); \
+    QUAD(0, 1, 2, 3, 12); \
+    QUAD(1, 2, 3, 0, 13); \
+    QUAD(2, 3, 0, 1, 14); \
+    QUAD(3, 0, 1, 2, 15);
+
+#define LOAD_WORDS(p) \
+    vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)))
+
+static const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+/* Padding of the second hash, words 8-15 */
+static const uint32_t PAD_DIGEST[8] = {
+    0x80000000, 0, 0, 0, 0, 0, 0, 256
+};
+
+/* Padding of an 80-byte message, words 4-15 of the second block */
+static const uint32_t PAD_TAIL80[12] = {
+    0x80000000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 640
+};
+
+/* Run the second hash on the digest in STATE0 and STATE1, and store it */
+static inline void second_hash(uint8_t out[32], uint32x4_t STATE0, uint32x4_t STATE1)
+{
+    uint32x4_t MSG0, MSG1, MSG2, MSG3;
+    const uint32x4_t IV0 = vld1q_u32(&IV[0]);
+    const uint32x4_t IV1 = vld1q_u32(&IV[4]);
+
+    MSG0 = STATE0;
+    MSG1 = STATE1;
+    MSG2 = vld1q_u32(&PAD_DIGEST[0]);
+    MSG3 = vld1q_u32(&PAD_DIGEST[4]);
+    STATE0 = IV0;
+    STATE1 = IV1;
+
+    RNDS4(vaddq_u32(MSG0, vld1q_u32(&K[0x00])));
+    RNDS4(vaddq_u32(MSG1, vld1q_u32(&K[0x04])));
+    RNDS4(vld1q_u32(&KW_DIGEST[0]));
+    RNDS4(vld1q_u32(&KW_DIGEST[4]));
+    ROUNDS_16_63;
+
+    STATE0 = vaddq_u32(STATE0, IV0);
+    STATE1 = vaddq_u32(STATE1, IV1);
+    vst1q_u8(out +  0, vrev32q_u8(vreinterpretq_u8_u32(STATE0)));
+    vst1q_u8(out + 16, vrev32q_u8(vreinterpretq_u8_u32(STATE1)));
+}
+
+void sha256d_64_arm(uint8_t out[32], const uint8_t in[64])
+{
+    uint32x4_t STATE0, STATE1, ABCD_SAVE, EFGH_SAVE;
+    uint32x4_t MSG0, MSG1, MSG2, MSG3;
+    unsigned int i;
+
+    /* First hash, message block */
+    STATE0 = vld1q_u32(&IV[0]);
+    STATE1 = vld1q_u32(&IV[4]);
+    MSG0 = LOAD_WORDS(in +  0);
+    MSG1 = LOAD_WORDS(in + 16);
+    MSG2 = LOAD_WORDS(in + 32);
+    MSG3 = LOAD_WORDS(in + 48);
+    ROUNDS_0_15;
+    ROUNDS_16_63;
+    STATE0 = vaddq_u32(STATE0, vld1q_u32(&IV[0]));
+    STATE1 = vaddq_u32(STATE1, vld1q_u32(&IV[4]));
+
+    /* First hash, padding block. No message schedule. */
+    ABCD_SAVE = STATE0;
+    EFGH_SAVE = STATE1;
+    for (i = 0; i < 16; ++i)
+        RNDS4(vld1q_u32(&KW_PAD64[4*i]));
+    STATE0 = vaddq_u32(STATE0, ABCD_SAVE);
+    STATE1 = vaddq_u32(STATE1, EFGH_SAVE);
+
+    second_hash(out, STATE0, STATE1);
+}
+
+void sha256d_80_arm(uint8_t out[32], const uint8_t in[80])
+{
+    uint32x4_t STATE0, STATE1, ABCD_SAVE, EFGH_SAVE;
+    uint32x4_t MSG0, MSG1, MSG2, MSG3;
+
+    /* First hash, first block */
+    STATE0 = vld1q_u32(&IV[0]);
+    STATE1 = vld1q_u32(&IV[4]);
+    MSG0 = LOAD_WORDS(in +  0);
+    MSG1 = LOAD_WORDS(in + 16);
+    MSG2 = LOAD_WORDS(in + 32);
+    MSG3 = LOAD_WORDS(in + 48);
+    ROUNDS_0_15;
+    ROUNDS_16_63;
+    STATE0 = vaddq_u32(STATE0, vld1q_u32(&IV[0]));
+    STATE1 = vaddq_u32(STATE1, vld1q_u32(&IV[4]));
+
+    /* First hash, tail and padding */
+    ABCD_SAVE = STATE0;
+    EFGH_SAVE = STATE1;
+    MSG0 = LOAD_WORDS(in + 64);
+    MSG1 = vld1q_u32(&PAD_TAIL80[0]);
+    MSG2 = vld1q_u32(&PAD_TAIL80[4]);
+    MSG3 = vld1q_u32(&PAD_TAIL80[8]);
+    RNDS4(vaddq_u32(MSG0, vld1q_u32(&K[0x00])));
+    RNDS4(vld1q_u32(&KW_TAIL80[0]));
+    RNDS4(vld1q_u32(&KW_TAIL80[4]));
+    RNDS4(vld1q_u32(&KW_TAIL80[8]));
+    ROUNDS_16_63;
+    STATE0 = vaddq_u32(STATE0, ABCD_SAVE);
+    STATE1 = vaddq_u32(STATE1, EFGH_SAVE);
+
+    second_hash(out, STATE0, STATE1);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+
+void sha256_process_arm(uint32_t state[8], const uint8_t data[], uint32_t length);
+
+/* Reference SHA256d through the generic compress function */
+static void reference(uint8_t out[32], const uint8_t* in, size_t length)
+{
+    uint8_t block[192];
+    uint32_t state[8];
+    size_t padded = (length + 9 + 63) & ~(size_t)63;
+    unsigned int pass, i;
+
+    memcpy(block, in, length);
+    for (pass = 0; pass < 2; ++pass)
+    {
+        memset(block + length, 0, padded - length);
+        block[length] = 0x80;
+        block[padded-2] = (uint8_t)((length * 8) >> 8);
+        block[padded-1] = (uint8_t)(length * 8);
+
+        memcpy(state, IV, sizeof(state));
+        sha256_process_arm(state, block, (uint32_t)padded);
+        for (i = 0; i < 8; ++i)
+        {
+            block[4*i+0] = (uint8_t)(state[i] >> 24);
+            block[4*i+1] = (uint8_t)(state[i] >> 16);
+            block[4*i+2] = (uint8_t)(state[i] >>  8);
+            block[4*i+3] = (uint8_t)(state[i] >>  0);
+        }
+        length = 32;
+        padded = 64;
+    }
+    memcpy(out, block, 32);
+}
+
+int main(int argc, char* argv[])
+{
+    uint8_t in[80], out[32], ref[32];
+    unsigned int i, trial;
+    int success = 1;
+
+    for (trial = 0; trial < 32; ++trial)
+    {
+        for (i = 0; i < 80; ++i)
+            in[i] = (uint8_t)(i * 7 + trial * 131 + 3);
+
+        reference(ref, in, 64);
+        sha256d_64_arm(out, in);
+        success &= (memcmp(out, ref, 32) == 0);
+
+        reference(ref, in, 80);
+        sha256d_80_arm(out, in);
+        success &= (memcmp(out, ref, 32) == 0);
+    }
+
+    /* SHA256d of 64 zero bytes, e2f61c3f71d1defd... */
+    memset(in, 0, 64);
+    sha256d_64_arm(out, in);
+    printf("SHA256d of 64 zero bytes: ");
+    for (i = 0; i < 8; ++i)
+        printf("%02X", out[i]);
+    printf("...\n");
+    success &= (out[0] == 0xE2 && out[1] == 0xF6 && out[2] == 0x1C && out[3] == 0x3F);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
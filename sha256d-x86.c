@@ -0,0 +1,495 @@
+/* sha256d-x86.c - Double SHA-256 of 64-byte and 80-byte messages */
+/*   using the Intel SHA extensions                               */
+/*   Written and placed in public domain                          */
+
+/* The rounds are the same as sha256_process_x86. The state stays  */
+/* in ABEF/CDGH order from the first block to the last, the digest */
+/* of the first hash becomes the message of the second hash        */
+/* without a trip through memory, and the rounds whose message is  */
+/* constant take their K+W from a table.                           */
+
+/* gcc -c -msse4.1 -msha sha256-x86.c                                          */
+/* gcc -DTEST_MAIN -msse4.1 -msha sha256d-x86.c sha256-x86.o -o sha256d-x86.exe */
+
+/* Include the GCC super header */
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+/* Microsoft supports Intel SHA ACLE extensions as of Visual Studio 2015 */
+#if defined(_MSC_VER)
+# include <immintrin.h>
+# define WIN32_LEAN_AND_MEAN
+# include <Windows.h>
+typedef UINT32 uint32_t;
+typedef UINT8 uint8_t;
+#endif
+
+#include "sha256d.h"
+
+static const uint32_t K256[] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/* K+W for the padding block of a 64-byte message. The whole */
+/*  schedule is constant, so the rounds need no message.     */
+static const uint32_t KW_PAD64[] =
+{
+    0xC28A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF374,
+    0x649B69C1, 0xF0FE4786, 0x0FE1EDC6, 0x240CF254,
+    0x4FE9346F, 0x6CC984BE, 0x61B9411E, 0x16F988FA,
+    0xF2C65152, 0xA88E5A6D, 0xB019FC65, 0xB9D99EC7,
+    0x9A1231C3, 0xE70EEAA0, 0xFDB1232B, 0xC7353EB0,
+    0x3069BAD5, 0xCB976D5F, 0x5A0F118F, 0xDC1EEEFD,
+    0x0A35B689, 0xDE0B7A04, 0x58F4CA9D, 0xE15D5B16,
+    0x007F3E86, 0x37088980, 0xA507EA32, 0x6FAB9537,
+    0x17406110, 0x0D8CD6F1, 0xCDAA3B6D, 0xC0BBBE37,
+    0x83613BDA, 0xDB48A363, 0x0B02E931, 0x6FD15CA7,
+    0x521AFACA, 0x31338431, 0x6ED41A95, 0x6D437890,
+    0xC39C91F2, 0x9ECCABBD, 0xB5C9A0E6, 0x532FB63C,
+    0xD2C741C6, 0x07237EA3, 0xA4954B68, 0x4C191D76
+};
+
+/* K+W for rounds 8-15 of the second hash, whose message is */
+/*  the 32-byte digest followed by the padding.             */
+static const uint32_t KW_DIGEST[] =
+{
+    0x5807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF274
+};
+
+/* K+W for rounds 4-15 of the second block of an 80-byte message */
+static const uint32_t KW_TAIL80[] =
+{
+    0xB956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF3F4
+};
+
+#define KQ(q) _mm_loadu_si128((const __m128i*) &K256[4*(q)])
+
+/* Four rounds with K+W already added */
+#define RNDS4(S0, S1, KW) \
+    do { \
+        const __m128i KW_ = (KW); \
+        S1 = _mm_sha256rnds2_epu32(S1, S0, KW_); \
+        S0 = _mm_sha256rnds2_epu32(S0, S1, _mm_shuffle_epi32(KW_, 0x0E)); \
+    } while (0)
+
+/* Schedule message words 4q to 4q+3 into M<a> and run their rounds. */
+/*  The stream suffix s is empty for the single stream kernels.      */
+#define QUAD(s, a, b, c, d, q) \
+    do { \
+        M##a##s = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(M##a##s, M##b##s), \
+                      _mm_alignr_epi8(M##d##s, M##c##s, 4)), M##d##s); \
+        RNDS4(S0##s, S1##s, _mm_add_epi32(M##a##s, KQ(q))); \
+    } while (0)
+
+#define ROUNDS_16_63(s) \
+    QUAD(s, 0, 1, 2, 3, 4); \
+    QUAD(s, 1, 2, 3, 0, 5); \
+    QUAD(s, 2, 3, 0, 1, 6); \
+    QUAD(s, 3, 0, 1, 2, 7); \
+    QUAD(s, 0, 1, 2, 3, 8); \
+    QUAD(s, 1, 2, 3, 0, 9); \
+    QUAD(s, 2, 3, 0, 1, 10); \
+    QUAD(s, 3, 0, 1, 2, 11); \
+    QUAD(s, 0, 1, 2, 3, 12); \
+    QUAD(s, 1, 2, 3, 0, 13); \
+    QUAD(s, 2, 3, 0, 1, 14); \
+    QUAD(s, 3, 0, 1, 2, 15);
+
+#define ROUNDS_16_63_X2 \
+    QUAD(A, 0, 1, 2, 3, 4); \
+    QUAD(B, 0, 1, 2, 3, 4); \
+    QUAD(A, 1, 2, 3, 0, 5); \
+    QUAD(B, 1, 2, 3, 0, 5); \
+    QUAD(A, 2, 3, 0, 1, 6); \
+    QUAD(B, 2, 3, 0, 1, 6); \
+    QUAD(A, 3, 0, 1, 2, 7); \
+    QUAD(B, 3, 0, 1, 2, 7); \
+    QUAD(A, 0, 1, 2, 3, 8); \
+    QUAD(B, 0, 1, 2, 3, 8); \
+    QUAD(A, 1, 2, 3, 0, 9); \
+    QUAD(B, 1, 2, 3, 0, 9); \
+    QUAD(A, 2, 3, 0, 1, 10); \
+    QUAD(B, 2, 3, 0, 1, 10); \
+    QUAD(A, 3, 0, 1, 2, 11); \
+    QUAD(B, 3, 0, 1, 2, 11); \
+    QUAD(A, 0, 1, 2, 3, 12); \
+    QUAD(B, 0, 1, 2, 3, 12); \
+    QUAD(A, 1, 2, 3, 0, 13); \
+    QUAD(B, 1, 2, 3, 0, 13); \
+    QUAD(A, 2, 3, 0, 1, 14); \
+    QUAD(B, 2, 3, 0, 1, 14); \
+    QUAD(A, 3, 0, 1, 2, 15); \
+    QUAD(B, 3, 0, 1, 2, 15);
+
+/* Load and byte swap a message block */
+#define LOAD_BLOCK(s, p) \
+    do { \
+        M0##s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ((p)+ 0)), MASK); \
+        M1##s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ((p)+16)), MASK); \
+        M2##s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ((p)+32)), MASK); \
+        M3##s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ((p)+48)), MASK); \
+    } while (0)
+
+/* Move the state from ABEF/CDGH order to ABCD/EFGH order in X0 and X1 */
+#define UNPACK_STATE(s, X0, X1) \
+    do { \
+        X0 = _mm_shuffle_epi32(S0##s, 0x1B);    /* FEBA */ \
+        X1 = _mm_shuffle_epi32(S1##s, 0xB1);    /* DCHG */ \
+        M3##s = X0; \
+        X0 = _mm_blend_epi16(M3##s, X1, 0xF0);  /* DCBA */ \
+        X1 = _mm_alignr_epi8(X1, M3##s, 8);     /* HGFE */ \
+    } while (0)
+
+/* The second hash. The digest words of the first hash are the first */
+/*  eight message words, and the padding is the rest of the block.   */
+#define PAD_DIGEST(s) \
+    do { \
+        UNPACK_STATE(s, M0##s, M1##s); \
+        M2##s = _mm_set_epi32(0, 0, 0, 0x80000000); \
+        M3##s = _mm_set_epi32(256, 0, 0, 0); \
+        S0##s = IV0; \
+        S1##s = IV1; \
+    } while (0)
+
+#define STORE_DIGEST(s, p) \
+    do { \
+        S0##s = _mm_add_epi32(S0##s, IV0); \
+        S1##s = _mm_add_epi32(S1##s, IV1); \
+        UNPACK_STATE(s, M0##s, M1##s); \
+        _mm_storeu_si128((__m128i*) ((p)+ 0), _mm_shuffle_epi8(M0##s, MASK)); \
+        _mm_storeu_si128((__m128i*) ((p)+16), _mm_shuffle_epi8(M1##s, MASK)); \
+    } while (0)
+
+/* The last 16 bytes of an 80-byte message and the padding */
+#define PAD_TAIL80(s, p) \
+    do { \
+        M0##s = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) ((p)+64)), MASK); \
+        M1##s = _mm_set_epi32(0, 0, 0, 0x80000000); \
+        M2##s = _mm_setzero_si128(); \
+        M3##s = _mm_set_epi32(640, 0, 0, 0); \
+    } while (0)
+
+/* Byte swap mask and the initial state in ABEF/CDGH order */
+#define KERNEL_CONSTANTS \
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL); \
+    const __m128i IV0 = _mm_set_epi32(0x6A09E667, 0xBB67AE85, 0x510E527F, 0x9B05688C); \
+    const __m128i IV1 = _mm_set_epi32(0x3C6EF372, 0xA54FF53A, 0x1F83D9AB, 0x5BE0CD19)
+
+void sha256d_64_x86(uint8_t out[32], const uint8_t in[64])
+{
+    __m128i S0, S1, M0, M1, M2, M3;
+    __m128i ABEF_SAVE, CDGH_SAVE;
+    unsigned int i;
+    KERNEL_CONSTANTS;
+
+    /* First hash, message block */
+    S0 = IV0;
+    S1 = IV1;
+    LOAD_BLOCK(, in);
+    RNDS4(S0, S1, _mm_add_epi32(M0, KQ(0)));
+    RNDS4(S0, S1, _mm_add_epi32(M1, KQ(1)));
+    RNDS4(S0, S1, _mm_add_epi32(M2, KQ(2)));
+    RNDS4(S0, S1, _mm_add_epi32(M3, KQ(3)));
+    ROUNDS_16_63();
+    S0 = _mm_add_epi32(S0, IV0);
+    S1 = _mm_add_epi32(S1, IV1);
+
+    /* First hash, padding block. No message schedule. */
+    ABEF_SAVE = S0;
+    CDGH_SAVE = S1;
+    for (i = 0; i < 16; ++i)
+        RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_PAD64[4*i]));
+    S0 = _mm_add_epi32(S0, ABEF_SAVE);
+    S1 = _mm_add_epi32(S1, CDGH_SAVE);
+
+    /* Second hash */
+    PAD_DIGEST();
+    RNDS4(S0, S1, _mm_add_epi32(M0, KQ(0)));
+    RNDS4(S0, S1, _mm_add_epi32(M1, KQ(1)));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_DIGEST[0]));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_DIGEST[4]));
+    ROUNDS_16_63();
+    STORE_DIGEST(, out);
+}
+
+void sha256d_80_x86(uint8_t out[32], const uint8_t in[80])
+{
+    __m128i S0, S1, M0, M1, M2, M3;
+    __m128i ABEF_SAVE, CDGH_SAVE;
+    KERNEL_CONSTANTS;
+
+    /* First hash, first block */
+    S0 = IV0;
+    S1 = IV1;
+    LOAD_BLOCK(, in);
+    RNDS4(S0, S1, _mm_add_epi32(M0, KQ(0)));
+    RNDS4(S0, S1, _mm_add_epi32(M1, KQ(1)));
+    RNDS4(S0, S1, _mm_add_epi32(M2, KQ(2)));
+    RNDS4(S0, S1, _mm_add_epi32(M3, KQ(3)));
+    ROUNDS_16_63();
+    S0 = _mm_add_epi32(S0, IV0);
+    S1 = _mm_add_epi32(S1, IV1);
+
+    /* First hash, tail and padding */
+    ABEF_SAVE = S0;
+    CDGH_SAVE = S1;
+    PAD_TAIL80(, in);
+    RNDS4(S0, S1, _mm_add_epi32(M0, KQ(0)));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_TAIL80[0]));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_TAIL80[4]));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_TAIL80[8]));
+    ROUNDS_16_63();
+    S0 = _mm_add_epi32(S0, ABEF_SAVE);
+    S1 = _mm_add_epi32(S1, CDGH_SAVE);
+
+    /* Second hash */
+    PAD_DIGEST();
+    RNDS4(S0, S1, _mm_add_epi32(M0, KQ(0)));
+    RNDS4(S0, S1, _mm_add_epi32(M1, KQ(1)));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_DIGEST[0]));
+    RNDS4(S0, S1, _mm_loadu_si128((const __m128i*) &KW_DIGEST[4]));
+    ROUNDS_16_63();
+    STORE_DIGEST(, out);
+}
+
+/* Two messages with their rounds interleaved, like sha256_process_x86_x2 */
+void sha256d_64_x86_x2(uint8_t out1[32], uint8_t out2[32],
+                       const uint8_t in1[64], const uint8_t in2[64])
+{
+    __m128i S0A, S1A, M0A, M1A, M2A, M3A;
+    __m128i S0B, S1B, M0B, M1B, M2B, M3B;
+    __m128i KW;
+    unsigned int i;
+    KERNEL_CONSTANTS;
+
+    /* First hash, message blocks */
+    S0A = S0B = IV0;
+    S1A = S1B = IV1;
+    LOAD_BLOCK(A, in1);
+    LOAD_BLOCK(B, in2);
+    RNDS4(S0A, S1A, _mm_add_epi32(M0A, KQ(0)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M0B, KQ(0)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M1A, KQ(1)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M1B, KQ(1)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M2A, KQ(2)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M2B, KQ(2)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M3A, KQ(3)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M3B, KQ(3)));
+    ROUNDS_16_63_X2;
+    S0A = _mm_add_epi32(S0A, IV0);
+    S1A = _mm_add_epi32(S1A, IV1);
+    S0B = _mm_add_epi32(S0B, IV0);
+    S1B = _mm_add_epi32(S1B, IV1);
+
+    /* First hash, padding blocks. The message registers hold the */
+    /*  saved state since the padding needs no schedule.          */
+    M0A = S0A; M1A = S1A;
+    M0B = S0B; M1B = S1B;
+    for (i = 0; i < 16; ++i)
+    {
+        KW = _mm_loadu_si128((const __m128i*) &KW_PAD64[4*i]);
+        RNDS4(S0A, S1A, KW);
+        RNDS4(S0B, S1B, KW);
+    }
+    S0A = _mm_add_epi32(S0A, M0A);
+    S1A = _mm_add_epi32(S1A, M1A);
+    S0B = _mm_add_epi32(S0B, M0B);
+    S1B = _mm_add_epi32(S1B, M1B);
+
+    /* Second hashes */
+    PAD_DIGEST(A);
+    PAD_DIGEST(B);
+    RNDS4(S0A, S1A, _mm_add_epi32(M0A, KQ(0)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M0B, KQ(0)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M1A, KQ(1)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M1B, KQ(1)));
+    KW = _mm_loadu_si128((const __m128i*) &KW_DIGEST[0]);
+    RNDS4(S0A, S1A, KW);
+    RNDS4(S0B, S1B, KW);
+    KW = _mm_loadu_si128((const __m128i*) &KW_DIGEST[4]);
+    RNDS4(S0A, S1A, KW);
+    RNDS4(S0B, S1B, KW);
+    ROUNDS_16_63_X2;
+    STORE_DIGEST(A, out1);
+    STORE_DIGEST(B, out2);
+}
+
+void sha256d_80_x86_x2(uint8_t out1[32], uint8_t out2[32],
+                       const uint8_t in1[80], const uint8_t in2[80])
+{
+    __m128i S0A, S1A, M0A, M1A, M2A, M3A;
+    __m128i S0B, S1B, M0B, M1B, M2B, M3B;
+    __m128i ABEF_SAVEA, CDGH_SAVEA, ABEF_SAVEB, CDGH_SAVEB;
+    __m128i KW;
+    unsigned int i;
+    KERNEL_CONSTANTS;
+
+    /* First hash, first blocks */
+    S0A = S0B = IV0;
+    S1A = S1B = IV1;
+    LOAD_BLOCK(A, in1);
+    LOAD_BLOCK(B, in2);
+    RNDS4(S0A, S1A, _mm_add_epi32(M0A, KQ(0)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M0B, KQ(0)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M1A, KQ(1)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M1B, KQ(1)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M2A, KQ(2)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M2B, KQ(2)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M3A, KQ(3)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M3B, KQ(3)));
+    ROUNDS_16_63_X2;
+    S0A = _mm_add_epi32(S0A, IV0);
+    S1A = _mm_add_epi32(S1A, IV1);
+    S0B = _mm_add_epi32(S0B, IV0);
+    S1B = _mm_add_epi32(S1B, IV1);
+
+    /* First hash, tails and padding */
+    ABEF_SAVEA = S0A; CDGH_SAVEA = S1A;
+    ABEF_SAVEB = S0B; CDGH_SAVEB = S1B;
+    PAD_TAIL80(A, in1);
+    PAD_TAIL80(B, in2);
+    RNDS4(S0A, S1A, _mm_add_epi32(M0A, KQ(0)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M0B, KQ(0)));
+    for (i = 0; i < 3; ++i)
+    {
+        KW = _mm_loadu_si128((const __m128i*) &KW_TAIL80[4*i]);
+        RNDS4(S0A, S1A, KW);
+        RNDS4(S0B, S1B, KW);
+    }
+    ROUNDS_16_63_X2;
+    S0A = _mm_add_epi32(S0A, ABEF_SAVEA);
+    S1A = _mm_add_epi32(S1A, CDGH_SAVEA);
+    S0B = _mm_add_epi32(S0B, ABEF_SAVEB);
+    S1B = _mm_add_epi32(S1B, CDGH_SAVEB);
+
+    /* Second hashes */
+    PAD_DIGEST(A);
+    PAD_DIGEST(B);
+    RNDS4(S0A, S1A, _mm_add_epi32(M0A, KQ(0)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M0B, KQ(0)));
+    RNDS4(S0A, S1A, _mm_add_epi32(M1A, KQ(1)));
+    RNDS4(S0B, S1B, _mm_add_epi32(M1B, KQ(1)));
+    KW = _mm_loadu_si128((const __m128i*) &KW_DIGEST[0]);
+    RNDS4(S0A, S1A, KW);
+    RNDS4(S0B, S1B, KW);
+    KW = _mm_loadu_si128((const __m128i*) &KW_DIGEST[4]);
+    RNDS4(S0A, S1A, KW);
+    RNDS4(S0B, S1B, KW);
+    ROUNDS_16_63_X2;
+    STORE_DIGEST(A, out1);
+    STORE_DIGEST(B, out2);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+
+void sha256_process_x86(uint32_t state[8], const uint8_t data[], uint32_t length);
+
+/* Reference SHA256d through the generic compress function */
+static void reference(uint8_t out[32], const uint8_t* in, size_t length)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    uint8_t block[192];
+    uint32_t state[8];
+    size_t padded = (length + 9 + 63) & ~(size_t)63;
+    unsigned int pass, i;
+
+    memcpy(block, in, length);
+    for (pass = 0; pass < 2; ++pass)
+    {
+        memset(block + length, 0, padded - length);
+        block[length] = 0x80;
+        block[padded-2] = (uint8_t)((length * 8) >> 8);
+        block[padded-1] = (uint8_t)(length * 8);
+
+        memcpy(state, iv, sizeof(state));
+        sha256_process_x86(state, block, (uint32_t)padded);
+        for (i = 0; i < 8; ++i)
+        {
+            block[4*i+0] = (uint8_t)(state[i] >> 24);
+            block[4*i+1] = (uint8_t)(state[i] >> 16);
+            block[4*i+2] = (uint8_t)(state[i] >>  8);
+            block[4*i+3] = (uint8_t)(state[i] >>  0);
+        }
+        length = 32;
+        padded = 64;
+    }
+    memcpy(out, block, 32);
+}
+
+int main(int argc, char* argv[])
+{
+    uint8_t in[2][80], out[2][32], ref[2][32];
+    unsigned int i, trial;
+    int success = 1;
+
+    for (trial = 0; trial < 32; ++trial)
+    {
+        for (i = 0; i < 80; ++i)
+        {
+            in[0][i] = (uint8_t)(i * 7 + trial * 131 + 3);
+            in[1][i] = (uint8_t)(i * 29 + trial * 17 + 101);
+        }
+
+        reference(ref[0], in[0], 64);
+        reference(ref[1], in[1], 64);
+        sha256d_64_x86(out[0], in[0]);
+        success &= (memcmp(out[0], ref[0], 32) == 0);
+        sha256d_64_x86_x2(out[0], out[1], in[0], in[1]);
+        success &= (memcmp(out, ref, sizeof(ref)) == 0);
+
+        reference(ref[0], in[0], 80);
+        reference(ref[1], in[1], 80);
+        sha256d_80_x86(out[0], in[0]);
+        success &= (memcmp(out[0], ref[0], 32) == 0);
+        sha256d_80_x86_x2(out[0], out[1], in[0], in[1]);
+        success &= (memcmp(out, ref, sizeof(ref)) == 0);
+    }
+
+    /* SHA256d of 64 zero bytes, e2f61c3f71d1defd... */
+    memset(in[0], 0, 64);
+    sha256d_64_x86(out[0], in[0]);
+    printf("SHA256d of 64 zero bytes: ");
+    for (i = 0; i < 8; ++i)
+        printf("%02X", out[0][i]);
+    printf("...\n");
+    success &= (out[0][0] == 0xE2 && out[0][1] == 0xF6 && out[0][2] == 0x1C && out[0][3] == 0x3F);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
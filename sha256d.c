@@ -0,0 +1,359 @@
+/* sha256d.c - Double SHA-256 of 64-byte and 80-byte messages */
+/*   Written and placed in public domain                     */
+
+/* The portable kernels run the dispatched compress function over   */
+/* constant padding blocks, so they skip the length and padding     */
+/* logic of sha256_ctx. The drivers bind the SHA-NI or ARMv8 kernel */
+/* on first use. Batches go two at a time through the interleaved   */
+/* SHA-NI kernel, or a full vector of lanes at a time through the   */
+/* multi-buffer kernels.                                            */
+
+/* Build the dispatcher and its ISA objects as shown in sha-dispatch.c */
+/* gcc -c -msse4.1 -msha sha256d-x86.c                                  */
+/* gcc -c -mavx2 sha256-mb-avx2.c                                       */
+/* gcc -c -mavx512f -mavx512bw sha256-mb-avx512.c                       */
+/* gcc -DTEST_MAIN sha256d.c sha256d-x86.o sha256-mb-avx2.o \          */
+/*     sha256-mb-avx512.o sha-ctx.o sha-dispatch.o <ISA objects> \     */
+/*     -o sha256d.exe                                                   */
+
+#include <string.h>
+
+#include "sha256d.h"
+#include "sha256-mb.h"
+#include "sha-dispatch.h"
+
+static const uint32_t IV256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* Padding block of a 64-byte message */
+static const uint8_t PAD64[64] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00
+};
+
+/* Padding after the 32-byte digest in the second hash */
+static const uint8_t PAD_DIGEST[32] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x00
+};
+
+/* Padding after the last 16 bytes of an 80-byte message */
+static const uint8_t PAD_TAIL80[48] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x80
+};
+
+static inline void store_be32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >>  8);
+    p[3] = (uint8_t)(v >>  0);
+}
+
+/* Second hash of the digest in state. Leaves the result in out. */
+static void second_hash(uint8_t out[32], const uint32_t state[8])
+{
+    uint32_t inner[8];
+    uint8_t block[64];
+    unsigned int i;
+
+    for (i = 0; i < 8; ++i)
+        store_be32(block + 4*i, state[i]);
+    memcpy(block + 32, PAD_DIGEST, sizeof(PAD_DIGEST));
+
+    memcpy(inner, IV256, sizeof(inner));
+    sha256_process_dispatch(inner, block, 64);
+    for (i = 0; i < 8; ++i)
+        store_be32(out + 4*i, inner[i]);
+}
+
+static void sha256d_64_portable(uint8_t out[32], const uint8_t in[64])
+{
+    uint32_t state[8];
+    memcpy(state, IV256, sizeof(state));
+    sha256_process_dispatch(state, in, 64);
+    sha256_process_dispatch(state, PAD64, 64);
+    second_hash(out, state);
+}
+
+static void sha256d_80_portable(uint8_t out[32], const uint8_t in[80])
+{
+    uint32_t state[8];
+    uint8_t block[64];
+
+    memcpy(block, in + 64, 16);
+    memcpy(block + 16, PAD_TAIL80, sizeof(PAD_TAIL80));
+
+    memcpy(state, IV256, sizeof(state));
+    sha256_process_dispatch(state, in, 64);
+    sha256_process_dispatch(state, block, 64);
+    second_hash(out, state);
+}
+
+typedef void (*sha256d_64_fn)(uint8_t out[32], const uint8_t in[64]);
+typedef void (*sha256d_80_fn)(uint8_t out[32], const uint8_t in[80]);
+
+static sha256d_64_fn s_sha256d_64;
+static sha256d_80_fn s_sha256d_80;
+static sha256_mb_fn s_mb;
+static unsigned int s_lanes;
+static int s_x2;
+static sha_once_flag s_once = SHA_ONCE_INIT;
+
+/* Picks the kernels on first use, under the dispatcher's sha_once */
+static void resolve(void)
+{
+    const unsigned int features = sha_cpu_features();
+
+    s_sha256d_64 = sha256d_64_portable;
+    s_sha256d_80 = sha256d_80_portable;
+    s_mb = NULL;
+    s_lanes = 1;
+    s_x2 = 0;
+
+#if defined(SHA_DISPATCH_X86)
+    /* Two interleaved SHA-NI streams beat the vector lanes, like */
+    /*  SHA256_MB_AUTO.                                           */
+    if (features & SHA_CPU_X86_SHA)
+    {
+        s_sha256d_64 = sha256d_64_x86;
+        s_sha256d_80 = sha256d_80_x86;
+        s_x2 = 1;
+    }
+    else if (features & SHA_CPU_X86_AVX512)
+    {
+        s_mb = sha256_mb_avx512;
+        s_lanes = 16;
+    }
+    else if (features & SHA_CPU_X86_AVX2)
+    {
+        s_mb = sha256_mb_avx2;
+        s_lanes = 8;
+    }
+#elif defined(SHA_DISPATCH_ARM)
+    if (features & SHA_CPU_ARM_SHA2)
+    {
+        s_sha256d_64 = sha256d_64_arm;
+        s_sha256d_80 = sha256d_80_arm;
+    }
+#else
+    (void)features;
+#endif
+}
+
+void sha256d_64(uint8_t out[32], const uint8_t in[64])
+{
+    sha_once(&s_once, resolve);
+    s_sha256d_64(out, in);
+}
+
+void sha256d_80(uint8_t out[32], const uint8_t in[80])
+{
+    sha_once(&s_once, resolve);
+    s_sha256d_80(out, in);
+}
+
+/* Run count messages of size bytes through the multi-buffer kernel, */
+/*  one vector of lanes at a time. The first block of each message   */
+/*  is read in place and the padded blocks are built per lane.       */
+static void sha256d_mb(uint8_t out[], const uint8_t in[], size_t count, size_t size)
+{
+    sha256_mb_args args;
+    uint8_t block[SHA256_MB_MAX_LANES][64];
+    size_t n;
+    unsigned int w, l;
+
+    for (n = 0; n < count; n += s_lanes)
+    {
+        const unsigned int lanes = (count - n < s_lanes) ? (unsigned int)(count - n) : s_lanes;
+        const uint32_t mask = (1u << lanes) - 1;
+
+        /* First hash */
+        for (l = 0; l < lanes; ++l)
+        {
+            for (w = 0; w < 8; ++w)
+                args.digest[w][l] = IV256[w];
+            args.data[l] = in + (n + l) * size;
+
+            if (size == 80)
+            {
+                memcpy(block[l], args.data[l] + 64, 16);
+                memcpy(block[l] + 16, PAD_TAIL80, sizeof(PAD_TAIL80));
+            }
+        }
+        s_mb(&args, mask, 1);
+        for (l = 0; l < lanes; ++l)
+            args.data[l] = (size == 80) ? block[l] : PAD64;
+        s_mb(&args, mask, 1);
+
+        /* Second hash */
+        for (l = 0; l < lanes; ++l)
+        {
+            for (w = 0; w < 8; ++w)
+            {
+                store_be32(block[l] + 4*w, args.digest[w][l]);
+                args.digest[w][l] = IV256[w];
+            }
+            memcpy(block[l] + 32, PAD_DIGEST, sizeof(PAD_DIGEST));
+            args.data[l] = block[l];
+        }
+        s_mb(&args, mask, 1);
+
+        for (l = 0; l < lanes; ++l)
+            for (w = 0; w < 8; ++w)
+                store_be32(out + (n + l) * 32 + 4*w, args.digest[w][l]);
+    }
+}
+
+void sha256d_64_many(uint8_t out[], const uint8_t in[], size_t count)
+{
+    size_t i = 0;
+
+    sha_once(&s_once, resolve);
+
+#if defined(SHA_DISPATCH_X86)
+    if (s_x2)
+    {
+        for (; i + 2 <= count; i += 2)
+            sha256d_64_x86_x2(out + 32*i, out + 32*(i+1), in + 64*i, in + 64*(i+1));
+    }
+#endif
+    if (s_mb)
+    {
+        sha256d_mb(out, in, count, 64);
+        return;
+    }
+
+    for (; i < count; ++i)
+        s_sha256d_64(out + 32*i, in + 64*i);
+}
+
+void sha256d_80_many(uint8_t out[], const uint8_t in[], size_t count)
+{
+    size_t i = 0;
+
+    sha_once(&s_once, resolve);
+
+#if defined(SHA_DISPATCH_X86)
+    if (s_x2)
+    {
+        for (; i + 2 <= count; i += 2)
+            sha256d_80_x86_x2(out + 32*i, out + 32*(i+1), in + 80*i, in + 80*(i+1));
+    }
+#endif
+    if (s_mb)
+    {
+        sha256d_mb(out, in, count, 80);
+        return;
+    }
+
+    for (; i < count; ++i)
+        s_sha256d_80(out + 32*i, in + 80*i);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sha-ctx.h"
+
+static void reference(uint8_t out[32], const uint8_t* in, size_t length)
+{
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, in, length);
+    sha256_final(&ctx, out);
+    sha256_init(&ctx);
+    sha256_update(&ctx, out, 32);
+    sha256_final(&ctx, out);
+}
+
+static int test_path(const char* name, int x2, sha256_mb_fn mb, unsigned int lanes)
+{
+    enum { COUNT = 37 };
+    uint8_t* in = (uint8_t*)malloc(COUNT * 80);
+    uint8_t* out = (uint8_t*)malloc(COUNT * 32);
+    uint8_t ref[32];
+    size_t i;
+    int success = 1;
+
+    for (i = 0; i < COUNT * 80; ++i)
+        in[i] = (uint8_t)(i * 7 + (i >> 8) * 13 + 1);
+
+    s_x2 = x2;
+    s_mb = mb;
+    s_lanes = lanes;
+
+    sha256d_64_many(out, in, COUNT);
+    for (i = 0; i < COUNT; ++i)
+    {
+        reference(ref, in + 64*i, 64);
+        success &= (memcmp(out + 32*i, ref, 32) == 0);
+    }
+
+    sha256d_80_many(out, in, COUNT);
+    for (i = 0; i < COUNT; ++i)
+    {
+        reference(ref, in + 80*i, 80);
+        success &= (memcmp(out + 32*i, ref, 32) == 0);
+    }
+
+    printf("%-10s %s\n", name, success ? "passed" : "failed");
+
+    free(in);
+    free(out);
+    return success;
+}
+
+int main(int argc, char* argv[])
+{
+    uint8_t in[80], out[32], ref[32];
+    unsigned int i;
+    int success = 1;
+
+    for (i = 0; i < sizeof(in); ++i)
+        in[i] = (uint8_t)(i * 11 + 5);
+
+    reference(ref, in, 64);
+    sha256d_64(out, in);
+    success &= (memcmp(out, ref, 32) == 0);
+    sha256d_64_portable(out, in);
+    success &= (memcmp(out, ref, 32) == 0);
+
+    reference(ref, in, 80);
+    sha256d_80(out, in);
+    success &= (memcmp(out, ref, 32) == 0);
+    sha256d_80_portable(out, in);
+    success &= (memcmp(out, ref, 32) == 0);
+
+    printf("%-10s %s\n", "single", success ? "passed" : "failed");
+
+    /* Each multi-message path the host supports */
+    const unsigned int features = sha_cpu_features();
+    success &= test_path("one", 0, NULL, 1);
+#if defined(SHA_DISPATCH_X86)
+    if (features & SHA_CPU_X86_SHA)
+        success &= test_path("x2", 1, NULL, 1);
+    if (features & SHA_CPU_X86_AVX2)
+        success &= test_path("avx2", 0, sha256_mb_avx2, 8);
+    if (features & SHA_CPU_X86_AVX512)
+        success &= test_path("avx512", 0, sha256_mb_avx512, 16);
+#else
+    (void)features;
+#endif
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
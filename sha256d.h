@@ -0,0 +1,44 @@
+/* sha256d.h - Double SHA-256 of 64-byte and 80-byte messages */
+/*   Written and placed in public domain                     */
+
+/* SHA256d(m) is SHA-256(SHA-256(m)). Merkle nodes hash a 64-byte     */
+/* pair of child digests and block headers are 80 bytes, so both      */
+/* sizes have a fixed shape. The padding block of a 64-byte message   */
+/* and most of the second hash are constant. Their message schedules  */
+/* are folded into K+W tables, and those rounds run without any       */
+/* schedule or padding work.                                          */
+
+#ifndef SHA256D_H
+#define SHA256D_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Dispatched SHA256d of one message */
+void sha256d_64(uint8_t out[32], const uint8_t in[64]);
+void sha256d_80(uint8_t out[32], const uint8_t in[80]);
+
+/* SHA256d of count messages stored back to back. The lanes of the */
+/*  fastest multi-message kernel on the host are kept full.         */
+void sha256d_64_many(uint8_t out[], const uint8_t in[], size_t count);
+void sha256d_80_many(uint8_t out[], const uint8_t in[], size_t count);
+
+/* Kernels provided by the ISA source files */
+void sha256d_64_x86(uint8_t out[32], const uint8_t in[64]);
+void sha256d_80_x86(uint8_t out[32], const uint8_t in[80]);
+void sha256d_64_x86_x2(uint8_t out1[32], uint8_t out2[32],
+                       const uint8_t in1[64], const uint8_t in2[64]);
+void sha256d_80_x86_x2(uint8_t out1[32], uint8_t out2[32],
+                       const uint8_t in1[80], const uint8_t in2[80]);
+void sha256d_64_arm(uint8_t out[32], const uint8_t in[64]);
+void sha256d_80_arm(uint8_t out[32], const uint8_t in[80]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* SHA256D_H */
@@ -0,0 +1,271 @@
+/* sha512-avx2.c - SHA-512 using AVX2 and BMI2                */
+/*   Written and placed in public domain                     */
+
+/* The message schedule for two blocks is computed at once.    */
+/* The low 128-bit half of a YMM register holds two words of    */
+/* the first block and the high half the same two words of the  */
+/* second block. _mm256_alignr_epi8 works within each half, so  */
+/* both blocks are expanded in lockstep. W+K is written to the  */
+/* stack and the rounds run in general purpose registers, where */
+/* BMI2 rorx rotates without touching the flags or the source.  */
+
+/* gcc -DTEST_MAIN -mavx2 -mbmi2 sha512-avx2.c -o sha512-avx2.exe */
+
+#if defined(__GNUC__)
+# include <stdint.h>
+# include <x86intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+# include <immintrin.h>
+#endif
+
+static const uint64_t K512[] =
+{
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+    0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+    0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+    0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+    0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+    0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+    0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+    0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+    0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+    0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+    0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+    0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+    0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+    0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/* Vector message schedule */
+#define VROTR(x,n)   _mm256_or_si256(_mm256_srli_epi64((x),(n)), _mm256_slli_epi64((x),64-(n)))
+#define VXOR3(x,y,z) _mm256_xor_si256(_mm256_xor_si256((x),(y)),(z))
+#define vsigma0(x)   VXOR3(VROTR((x), 1), VROTR((x), 8), _mm256_srli_epi64((x), 7))
+#define vsigma1(x)   VXOR3(VROTR((x),19), VROTR((x),61), _mm256_srli_epi64((x), 6))
+
+/* Scalar rounds. GCC and Clang emit rorx for ROTR with -mbmi2. */
+#define ROTR(x,n)    (((x)>>(n)) | ((x)<<(64-(n))))
+#define Sigma0(x)    (ROTR((x),28) ^ ROTR((x),34) ^ ROTR((x),39))
+#define Sigma1(x)    (ROTR((x),14) ^ ROTR((x),18) ^ ROTR((x),41))
+#define Ch(x,y,z)    ((((y) ^ (z)) & (x)) ^ (z))
+#define Maj(x,y,z)   ((((x) | (y)) & (z)) | ((x) & (y)))
+
+#define ROUND(a,b,c,d,e,f,g,h,i) do { \
+    const uint64_t T1 = h + Sigma1(e) + Ch(e,f,g) + WK[i]; \
+    d += T1; \
+    h = T1 + Sigma0(a) + Maj(a,b,c); \
+} while (0)
+
+/* Expand the schedules of two blocks and store W+K for each. */
+/*  block1 may equal block0 when there is an odd block out.   */
+/*  swap is 0 when the blocks are host-order message words.   */
+static inline void schedule_x2(uint64_t WK0[80], uint64_t WK1[80],
+                               const uint8_t* block0, const uint8_t* block1, const int swap)
+{
+    const __m256i MASK = _mm256_set_epi64x(
+        0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL,
+        0x08090a0b0c0d0e0fULL, 0x0001020304050607ULL);
+
+    __m256i X[8];
+    unsigned int j;
+
+    for (j = 0; j < 8; ++j)
+    {
+        const __m128i lo = _mm_loadu_si128((const __m128i*)(block0 + 16*j));
+        const __m128i hi = _mm_loadu_si128((const __m128i*)(block1 + 16*j));
+        X[j] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        if (swap)
+            X[j] = _mm256_shuffle_epi8(X[j], MASK);
+
+        const __m256i K = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(K512 + 2*j)));
+        const __m256i T = _mm256_add_epi64(X[j], K);
+        _mm_storeu_si128((__m128i*)(WK0 + 2*j), _mm256_castsi256_si128(T));
+        _mm_storeu_si128((__m128i*)(WK1 + 2*j), _mm256_extracti128_si256(T, 1));
+    }
+
+    /* X[j&7] holds W[2j-16] and W[2j-15] on entry */
+    for (j = 8; j < 40; ++j)
+    {
+        const __m256i W16 = X[(j-8)&7];
+        const __m256i W15 = _mm256_alignr_epi8(X[(j-7)&7], X[(j-8)&7], 8);
+        const __m256i W7  = _mm256_alignr_epi8(X[(j-3)&7], X[(j-4)&7], 8);
+        const __m256i W2  = X[(j-1)&7];
+
+        X[j&7] = _mm256_add_epi64(_mm256_add_epi64(vsigma1(W2), W7), _mm256_add_epi64(vsigma0(W15), W16));
+
+        const __m256i K = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(K512 + 2*j)));
+        const __m256i T = _mm256_add_epi64(X[j&7], K);
+        _mm_storeu_si128((__m128i*)(WK0 + 2*j), _mm256_castsi256_si128(T));
+        _mm_storeu_si128((__m128i*)(WK1 + 2*j), _mm256_extracti128_si256(T, 1));
+    }
+}
+
+static inline void rounds(uint64_t state[8], const uint64_t WK[80])
+{
+    uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+    unsigned int i;
+
+    for (i = 0; i < 80; i += 8)
+    {
+        ROUND(a,b,c,d,e,f,g,h,i+0);
+        ROUND(h,a,b,c,d,e,f,g,i+1);
+        ROUND(g,h,a,b,c,d,e,f,i+2);
+        ROUND(f,g,h,a,b,c,d,e,i+3);
+        ROUND(e,f,g,h,a,b,c,d,i+4);
+        ROUND(d,e,f,g,h,a,b,c,i+5);
+        ROUND(c,d,e,f,g,h,a,b,i+6);
+        ROUND(b,c,d,e,f,g,h,a,i+7);
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#if defined(_MSC_VER)
+# define SHA_FORCE_INLINE __forceinline
+#else
+# define SHA_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+static SHA_FORCE_INLINE void sha512_avx2_blocks(uint64_t state[8], const uint8_t data[],
+                                                uint64_t length, const int swap)
+{
+    uint64_t WK0[80], WK1[80];
+
+    while (length >= 256)
+    {
+        schedule_x2(WK0, WK1, data, data+128, swap);
+        rounds(state, WK0);
+        rounds(state, WK1);
+
+        data += 256;
+        length -= 256;
+    }
+
+    if (length >= 128)
+    {
+        schedule_x2(WK0, WK1, data, data, swap);
+        rounds(state, WK0);
+    }
+}
+
+/* Process multiple blocks. The caller is responsible for setting the initial */
+/*  state, and the caller is responsible for padding the final block.        */
+void sha512_process_avx2(uint64_t state[8], const uint8_t data[], uint64_t length)
+{
+    sha512_avx2_blocks(state, data, length, 1);
+}
+
+/* Process multiple blocks given as host-order message words */
+void sha512_process_words_avx2(uint64_t state[8], const uint64_t data[], uint64_t length)
+{
+    sha512_avx2_blocks(state, (const uint8_t*) data, length, 0);
+}
+
+#if defined(TEST_MAIN)
+
+#include <stdio.h>
+#include <string.h>
+int main(int argc, char* argv[])
+{
+    /* empty message with padding */
+    uint8_t message[128];
+    memset(message, 0x00, sizeof(message));
+    message[0] = 0x80;
+
+    /* initial state */
+    static const uint64_t iv[8] = {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+        0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+        0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+    };
+
+    uint64_t state[8];
+    memcpy(state, iv, sizeof(state));
+    sha512_process_avx2(state, message, sizeof(message));
+
+    const uint8_t b1 = (uint8_t)(state[0] >> 56);
+    const uint8_t b2 = (uint8_t)(state[0] >> 48);
+    const uint8_t b3 = (uint8_t)(state[0] >> 40);
+    const uint8_t b4 = (uint8_t)(state[0] >> 32);
+    const uint8_t b5 = (uint8_t)(state[0] >> 24);
+    const uint8_t b6 = (uint8_t)(state[0] >> 16);
+    const uint8_t b7 = (uint8_t)(state[0] >>  8);
+    const uint8_t b8 = (uint8_t)(state[0] >>  0);
+
+    /* cf83e1357eefb8bd... */
+    printf("SHA512 hash of empty message: ");
+    printf("%02X%02X%02X%02X%02X%02X%02X%02X...\n",
+        b1, b2, b3, b4, b5, b6, b7, b8);
+
+    int success = ((b1 == 0xCF) && (b2 == 0x83) && (b3 == 0xE1) && (b4 == 0x35) &&
+                    (b5 == 0x7E) && (b6 == 0xEF) && (b7 == 0xB8) && (b8 == 0xBD));
+
+    /* 300 bytes of 'a' pad to three blocks: one pair and one odd block */
+    static const uint64_t expected[8] = {
+        0xa6a77010dd9696c2ULL, 0x3831e6549de51724ULL,
+        0xdf332c2075039b75ULL, 0xfcfe6c2e6de42fbdULL,
+        0x3c80ed4073267e00ULL, 0xc8c320712c3cdd9dULL,
+        0x65a96f90a3fe4a58ULL, 0xa6b70a103be08e83ULL
+    };
+
+    uint8_t longer[384];
+    memset(longer, 0x00, sizeof(longer));
+    memset(longer, 'a', 300);
+    longer[300] = 0x80;
+    longer[382] = (uint8_t)((300*8) >> 8);
+    longer[383] = (uint8_t)((300*8) >> 0);
+
+    memcpy(state, iv, sizeof(state));
+    sha512_process_avx2(state, longer, sizeof(longer));
+    success = success && (memcmp(state, expected, sizeof(expected)) == 0);
+
+    /* The same blocks as host-order words */
+    uint64_t words[48];
+    unsigned int i, j;
+    for (i = 0; i < 48; ++i)
+        for (words[i] = 0, j = 0; j < 8; ++j)
+            words[i] = (words[i] << 8) | longer[8*i+j];
+
+    memcpy(state, iv, sizeof(state));
+    sha512_process_words_avx2(state, words, sizeof(words));
+    success = success && (memcmp(state, expected, sizeof(expected)) == 0);
+
+    if (success)
+        printf("Success!\n");
+    else
+        printf("Failure!\n");
+
+    return (success != 0 ? 0 : 1);
+}
+
+#endif
@@ -248,9 +248,11 @@ void SHA512_ROUND2(uint64x2_p8 X[16], uint64x2_p8 S[8], const uint64x2_p8 K)
 
 /* Process multiple blocks. The caller is responsible for setting the initial */
 /*  state, and the caller is responsible for padding the final block.        */
-void sha512_process_p8(uint64_t state[8], const uint8_t data[], uint32_t length)
+/*  C linkage so the C dispatcher can bind the function.                     */
+extern "C"
+void sha512_process_p8(uint64_t state[8], const uint8_t data[], uint64_t length)
 {
-    uint32_t blocks = length / 128;
+    uint64_t blocks = length / 128;
     if (blocks == 0) return;
 
     const uint64_t* k = reinterpret_cast<const uint64_t*>(KEY512);
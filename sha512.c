@@ -68,80 +68,106 @@ uint64_t B2U64(uint8_t val, uint8_t sh)
     return ((uint64_t)val) << sh;
 }
 
+/* Compress one block whose message words are in X, in host order */
+static void sha512_block(uint64_t state[8], uint64_t X[16])
+{
+    uint64_t a, b, c, d, e, f, g, h, s0, s1, T1, T2;
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    f = state[5];
+    g = state[6];
+    h = state[7];
+
+    unsigned int i;
+    for (i = 0; i < 16; i++)
+    {
+        T1 = h;
+        T1 += Sigma1(e);
+        T1 += Ch(e, f, g);
+        T1 += K512[i];
+        T1 += X[i];
+
+        T2 = Sigma0(a);
+        T2 += Maj(a, b, c);
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    for (i = 16; i < 80; i++)
+    {
+        s0 = X[(i + 1) & 0x0f];
+        s0 = sigma0(s0);
+        s1 = X[(i + 14) & 0x0f];
+        s1 = sigma1(s1);
+
+        T1 = X[i & 0xf] += s0 + s1 + X[(i + 9) & 0xf];
+        T1 += h + Sigma1(e) + Ch(e, f, g) + K512[i];
+        T2 = Sigma0(a) + Maj(a, b, c);
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + T1;
+        d = c;
+        c = b;
+        b = a;
+        a = T1 + T2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
 /* Process multiple blocks. The caller is responsible for setting the initial */
 /*  state, and the caller is responsible for padding the final block.        */
 void sha512_process(uint64_t state[8], const uint8_t data[], uint64_t length)
 {
-    uint64_t a, b, c, d, e, f, g, h, s0, s1, T1, T2;
     uint64_t X[16];
+    unsigned int i;
 
     size_t blocks = length / 128;
     while (blocks--)
     {
-        a = state[0];
-        b = state[1];
-        c = state[2];
-        d = state[3];
-        e = state[4];
-        f = state[5];
-        g = state[6];
-        h = state[7];
-
-        unsigned int i;
         for (i = 0; i < 16; i++)
         {
             X[i] = B2U64(data[0], 56) | B2U64(data[1], 48) | B2U64(data[2], 40) | B2U64(data[3], 32) |
                     B2U64(data[4], 24) | B2U64(data[5], 16) | B2U64(data[6], 8) | B2U64(data[7], 0);
             data += 8;
-
-            T1 = h;
-            T1 += Sigma1(e);
-            T1 += Ch(e, f, g);
-            T1 += K512[i];
-            T1 += X[i];
-
-            T2 = Sigma0(a);
-            T2 += Maj(a, b, c);
-
-            h = g;
-            g = f;
-            f = e;
-            e = d + T1;
-            d = c;
-            c = b;
-            b = a;
-            a = T1 + T2;
         }
 
-        for (i = 16; i < 80; i++)
-        {
-            s0 = X[(i + 1) & 0x0f];
-            s0 = sigma0(s0);
-            s1 = X[(i + 14) & 0x0f];
-            s1 = sigma1(s1);
-
-            T1 = X[i & 0xf] += s0 + s1 + X[(i + 9) & 0xf];
-            T1 += h + Sigma1(e) + Ch(e, f, g) + K512[i];
-            T2 = Sigma0(a) + Maj(a, b, c);
-
-            h = g;
-            g = f;
-            f = e;
-            e = d + T1;
-            d = c;
-            c = b;
-            b = a;
-            a = T1 + T2;
-        }
+        sha512_block(state, X);
+    }
+}
 
-        state[0] += a;
-        state[1] += b;
-        state[2] += c;
-        state[3] += d;
-        state[4] += e;
-        state[5] += f;
-        state[6] += g;
-        state[7] += h;
+/* Process multiple blocks given as host-order message words, like */
+/*  digests kept in word form. length is in bytes, as above.       */
+void sha512_process_words(uint64_t state[8], const uint64_t data[], uint64_t length)
+{
+    uint64_t X[16];
+
+    size_t blocks = length / 128;
+    while (blocks--)
+    {
+        memcpy(X, data, 128);
+        sha512_block(state, X);
+        data += 16;
     }
 }
 
@@ -183,6 +209,19 @@ int main(int argc, char* argv[])
     int success = ((b1 == 0xCF) && (b2 == 0x83) && (b3 == 0xE1) && (b4 == 0x35) &&
                     (b5 == 0x7E) && (b6 == 0xEF) && (b7 == 0xB8) && (b8 == 0xBD));
 
+    /* The same block as host-order words */
+    uint64_t words[16];
+    uint64_t words_state[8] = {
+        0x6a09e667f3bcc908, 0xbb67ae8584caa73b,
+        0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+        0x510e527fade682d1, 0x9b05688c2b3e6c1f,
+        0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+    };
+    memset(words, 0x00, sizeof(words));
+    words[0] = 0x8000000000000000;
+    sha512_process_words(words_state, words, sizeof(words));
+    success = success && (memcmp(words_state, state, sizeof(state)) == 0);
+
     if (success)
         printf("Success!\n");
     else